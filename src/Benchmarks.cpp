@@ -0,0 +1,828 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "BinaryFeed.hpp"
+#include "BookManager.hpp"
+#include "DecimalParser.hpp"
+#include "DepthPublisher.hpp"
+#include "FeedGenerator.hpp"
+#include "FeedHandler.hpp"
+#include "LadderPriceLevelMap.hpp"
+#include "OrderBook.hpp"
+#include "OrderIdIndex.hpp"
+#include "OutputWriter.hpp"
+#include "ParallelParser.hpp"
+#include "Pipeline.hpp"
+#include "PriceLevelMap.hpp"
+#include "SlabAllocator.hpp"
+
+using namespace RgmInterview::OrderBook;
+
+/*
+* Every benchmark prints one comma separated line, so the output can be collected and compared over time:
+* benchmark,variant,operations,ns_per_op,ops_per_sec,instructions_per_op
+*
+* Instructions are counted where the kernel lets us ( perf_event_open ), the column stays empty where it doesn't.
+*
+* Give it an argument and only the benchmarks with that in their name run.
+*/
+namespace {
+
+	// keeps the optimizer from throwing away the work we're timing
+	volatile uint64_t g_sink;
+	std::string g_filter;
+
+	/* User space instructions retired by this thread, while it's running */
+	class InstructionCounter
+	{
+	public:
+		InstructionCounter() : m_fd ( -1 )
+		{
+#ifdef __linux__
+			perf_event_attr attr;
+			memset ( &attr, 0, sizeof ( attr ) );
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof ( attr );
+			attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			m_fd = syscall ( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+#endif
+		}
+
+		~InstructionCounter()
+		{
+			if ( m_fd >= 0 )
+				close ( m_fd );
+		}
+
+		bool available() const
+		{
+			return m_fd >= 0;
+		}
+
+		void start()
+		{
+#ifdef __linux__
+			if ( m_fd >= 0 )
+			{
+				ioctl ( m_fd, PERF_EVENT_IOC_RESET, 0 );
+				ioctl ( m_fd, PERF_EVENT_IOC_ENABLE, 0 );
+			}
+#endif
+		}
+
+		uint64_t stop()
+		{
+			uint64_t count ( 0 );
+#ifdef __linux__
+			if ( m_fd >= 0 )
+			{
+				ioctl ( m_fd, PERF_EVENT_IOC_DISABLE, 0 );
+				if ( read ( m_fd, &count, sizeof ( count ) ) != sizeof ( count ) )
+					count = 0;
+			}
+#endif
+			return count;
+		}
+	private:
+		int m_fd;
+	};
+
+	template <class F>
+	void run ( std::string const & benchmark, std::string const & variant, uint64_t operations, F f )
+	{
+		if ( benchmark.find ( g_filter ) == std::string::npos )
+			return;
+		InstructionCounter instructions;
+		instructions.start();
+		std::chrono::steady_clock::time_point begin ( std::chrono::steady_clock::now() );
+		g_sink = f();
+		std::chrono::steady_clock::time_point end ( std::chrono::steady_clock::now() );
+		uint64_t retired ( instructions.stop() );
+		double ns ( std::chrono::duration < double, std::nano > ( end - begin ).count() );
+		double ns_per_op ( ns / operations );
+		printf ( "%s,%s,%llu,%.3f,%.0f,",
+				 benchmark.c_str(),
+				 variant.c_str(),
+				 static_cast < unsigned long long > ( operations ),
+				 ns_per_op,
+				 1e9 / ns_per_op );
+		if ( instructions.available() )
+			printf ( "%.1f", static_cast < double > ( retired ) / operations );
+		printf ( "\n" );
+	}
+
+	/* Prices and sizes the way they show up in the feed */
+	void parseFields ( uint64_t rounds )
+	{
+		std::mt19937 rng ( 42 );
+		std::vector<std::string> prices;
+		std::vector<std::string> sizes;
+		for ( size_t i = 0; i < 4096; i++ )
+		{
+			char buf[32];
+			unsigned dollars ( 40 + rng() % 10 );
+			unsigned cents ( rng() % 100 );
+			unsigned size ( 1 + rng() % 2000 );
+			snprintf ( buf, sizeof ( buf ), "%u.%02u", dollars, cents );
+			prices.push_back ( buf );
+			snprintf ( buf, sizeof ( buf ), "%u", size );
+			sizes.push_back ( buf );
+		}
+		uint64_t operations ( rounds * prices.size() );
+		run ( "parse_price", "strtod", operations, [&]()
+		{
+			uint64_t sum ( 0 );
+			for ( uint64_t r = 0; r < rounds; r++ )
+				for ( std::string const & field : prices )
+				{
+					uint32_t out;
+					if ( DecimalParser::parsePriceLegacy ( field.data(), field.size(), out ) )
+						sum += out;
+				}
+			return sum;
+		} );
+		run ( "parse_price", "fixed_point", operations, [&]()
+		{
+			uint64_t sum ( 0 );
+			for ( uint64_t r = 0; r < rounds; r++ )
+				for ( std::string const & field : prices )
+				{
+					uint32_t out;
+					if ( DecimalParser::parsePrice ( field.data(), field.size(), out ) )
+						sum += out;
+				}
+			return sum;
+		} );
+		run ( "parse_size", "strtoul", operations, [&]()
+		{
+			uint64_t sum ( 0 );
+			for ( uint64_t r = 0; r < rounds; r++ )
+				for ( std::string const & field : sizes )
+				{
+					uint32_t out;
+					if ( DecimalParser::parseSizeLegacy ( field.data(), field.size(), out ) )
+						sum += out;
+				}
+			return sum;
+		} );
+		run ( "parse_size", "fixed_point", operations, [&]()
+		{
+			uint64_t sum ( 0 );
+			for ( uint64_t r = 0; r < rounds; r++ )
+				for ( std::string const & field : sizes )
+				{
+					uint32_t out;
+					if ( DecimalParser::parseSize ( field.data(), field.size(), out ) )
+						sum += out;
+				}
+			return sum;
+		} );
+	}
+
+	/* Whole lines taken apart into messages, without touching a book */
+	void parseMessages ( uint64_t rounds )
+	{
+		std::mt19937 rng ( 21 );
+		std::vector<std::string> lines;
+		char line[128];
+		for ( size_t i = 0; i < 4096; i++ )
+		{
+			if ( rng() % 2 )
+				snprintf ( line, sizeof ( line ), "%u A %u %c 44.%02u %u",
+						   static_cast < unsigned > ( 28800000 + i ),
+						   static_cast < unsigned > ( rng() % 100000 ),
+						   rng() % 2 ? 'B' : 'S',
+						   static_cast < unsigned > ( rng() % 100 ),
+						   static_cast < unsigned > ( 1 + rng() % 300 ) );
+			else
+				snprintf ( line, sizeof ( line ), "%u R %u %u",
+						   static_cast < unsigned > ( 28800000 + i ),
+						   static_cast < unsigned > ( rng() % 100000 ),
+						   static_cast < unsigned > ( 1 + rng() % 300 ) );
+			lines.push_back ( line );
+		}
+		run ( "parse_message", "feed_handler", rounds * lines.size(), [&]()
+		{
+			uint64_t sum ( 0 );
+			Message message;
+			for ( uint64_t r = 0; r < rounds; r++ )
+				for ( std::string const & field : lines )
+				{
+					FeedHandler::parseMessage ( field, message );
+					sum += message.size + message.order_id.size();
+				}
+			return sum;
+		} );
+	}
+
+	/* Add every id, look every one up and take them all out again, like a book that fills up and drains */
+	void orderIds ( size_t orders )
+	{
+		std::vector<std::string> ids;
+		for ( size_t i = 0; i < orders; i++ )
+			ids.push_back ( std::to_string ( i * 2654435761u % 4294967291u ) );
+		std::string variant ( std::to_string ( orders ) );
+		run ( "order_ids_unordered_map", variant, orders * 3, [&]()
+		{
+			std::unordered_map<std::string, uint32_t> map;
+			uint64_t sum ( 0 );
+			for ( size_t i = 0; i < ids.size(); i++ )
+				map.insert ( std::make_pair ( ids[i], i ) );
+			for ( std::string const & id : ids )
+				sum += map.find ( id )->second;
+			for ( std::string const & id : ids )
+				map.erase ( id );
+			return sum;
+		} );
+		run ( "order_ids_open_addressing", variant, orders * 3, [&]()
+		{
+			OrderIdIndex<uint32_t> index;
+			uint64_t sum ( 0 );
+			for ( size_t i = 0; i < ids.size(); i++ )
+				index.value ( index.insert ( ids[i] ).first ) = i;
+			for ( std::string const & id : ids )
+				sum += index.value ( index.find ( id ) );
+			for ( std::string const & id : ids )
+				index.erase ( id );
+			return sum;
+		} );
+	}
+
+	/* Output lines the way the book prints them, formatted into memory */
+	void outputLines ( size_t lines )
+	{
+		std::mt19937 rng ( 3 );
+		std::vector<uint32_t> values;
+		for ( size_t i = 0; i < 4096; i++ )
+			values.push_back ( 4000000 + rng() % 1000000 );
+		run ( "output_lines", "snprintf", lines, [&]()
+		{
+			uint64_t sum ( 0 );
+			char line[64];
+			for ( size_t i = 0; i < lines; i++ )
+				sum += snprintf ( line, sizeof ( line ), "%u %c %0.2f\n", static_cast < unsigned > ( 28800000 + i ), 'B', values[i % values.size()] / 1000.0 );
+			return sum;
+		} );
+		run ( "output_lines", "output_writer", lines, [&]()
+		{
+			MemorySink sink;
+			{
+				OutputWriter out ( sink );
+				for ( size_t i = 0; i < lines; i++ )
+					out.writeCost ( 28800000 + i, 'B', values[i % values.size()] );
+			}
+			return sink.str().size();
+		} );
+	}
+
+	/* Throws the output away, but still has to take it */
+	class CountingSink : public OutputSink
+	{
+	public:
+		CountingSink() : bytes ( 0 ) {}
+		void write ( const char * /* data */, size_t size )
+		{
+			bytes += size;
+		}
+		std::atomic<uint64_t> bytes;
+	};
+
+	/*
+	* A feed of many symbols going through BookManager with 1 up to ( at least 4 or ) as many threads as we have cores.
+	* Every symbol has its own little book that fills up and drains.
+	*/
+	void symbolScaling ( size_t symbols, size_t lines )
+	{
+		std::mt19937 rng ( 9 );
+		std::string feed;
+		std::vector<std::vector<uint32_t> > live ( symbols );
+		std::vector<uint32_t> next_id ( symbols, 0 );
+		char line[128];
+		for ( size_t i = 0; i < lines; i++ )
+		{
+			size_t symbol ( rng() % symbols );
+			std::vector<uint32_t> & orders ( live[symbol] );
+			if ( orders.size() < 50 || ( orders.size() < 500 && rng() % 2 ) )
+			{
+				orders.push_back ( next_id[symbol]++ );
+				snprintf ( line, sizeof ( line ), "SYM%u %u A %u %c 44.%02u %u\n",
+						   static_cast < unsigned > ( symbol ),
+						   static_cast < unsigned > ( 28800000 + i ),
+						   orders.back(),
+						   rng() % 2 ? 'B' : 'S',
+						   static_cast < unsigned > ( rng() % 100 ),
+						   static_cast < unsigned > ( 1 + rng() % 300 ) );
+			}
+			else
+			{
+				size_t index ( rng() % orders.size() );
+				snprintf ( line, sizeof ( line ), "SYM%u %u R %u 1000\n",
+						   static_cast < unsigned > ( symbol ),
+						   static_cast < unsigned > ( 28800000 + i ),
+						   orders[index] );
+				orders[index] = orders.back();
+				orders.pop_back();
+			}
+			feed += line;
+		}
+		size_t max_threads ( std::max ( 4u, std::thread::hardware_concurrency() ) );
+		for ( size_t threads = 1; threads <= max_threads; threads++ )
+		{
+			std::string variant ( "symbols=" + std::to_string ( symbols ) + "/threads=" + std::to_string ( threads ) );
+			run ( "symbol_scaling", variant, lines, [&]()
+			{
+				CountingSink sink;
+				BookManager manager ( std::vector<uint32_t> ( 1, 200 ), threads, sink );
+				manager.routeLines ( feed );
+				manager.finish();
+				return sink.bytes.load();
+			} );
+		}
+	}
+
+	/*
+	* One book replaying the same feed from text, and from the binary file converter would make of it.
+	* Both print through the same writer into a sink that throws it away.
+	*/
+	void feedFormats ( size_t lines )
+	{
+		std::mt19937 rng ( 11 );
+		std::string feed;
+		std::vector<uint32_t> live;
+		uint32_t next_id ( 0 );
+		char line[128];
+		for ( size_t i = 0; i < lines; i++ )
+		{
+			if ( live.size() < 50 || ( live.size() < 2000 && rng() % 2 ) )
+			{
+				live.push_back ( next_id++ );
+				snprintf ( line, sizeof ( line ), "%u A %u %c 44.%02u %u\n",
+						   static_cast < unsigned > ( 28800000 + i ),
+						   live.back(),
+						   rng() % 2 ? 'B' : 'S',
+						   static_cast < unsigned > ( rng() % 100 ),
+						   static_cast < unsigned > ( 1 + rng() % 300 ) );
+			}
+			else
+			{
+				size_t index ( rng() % live.size() );
+				snprintf ( line, sizeof ( line ), "%u R %u 1000\n",
+						   static_cast < unsigned > ( 28800000 + i ),
+						   live[index] );
+				live[index] = live.back();
+				live.pop_back();
+			}
+			feed += line;
+		}
+		char path[] = "/tmp/rgm-benchmark-feed-XXXXXX";
+		int fd ( mkstemp ( path ) );
+		if ( fd < 0 )
+			return;
+		close ( fd );
+		{
+			BinaryFeedWriter writer ( path );
+			Message message;
+			size_t begin ( 0 );
+			for ( size_t end = feed.find ( '\n' ); end != std::string::npos; begin = end + 1, end = feed.find ( '\n', begin ) )
+			{
+				FeedHandler::parseMessage ( std::string_view ( feed ).substr ( begin, end - begin ), message );
+				writer.append ( message );
+			}
+			writer.finish();
+		}
+		for ( uint32_t target_size : { 1, 200 } )
+		{
+			std::string variant ( "target=" + std::to_string ( target_size ) );
+			run ( "feed_text", variant, lines, [&]()
+			{
+				CountingSink sink;
+				FeedHandler handler ( target_size );
+				{
+					OutputWriter out ( sink );
+					handler.processLines ( feed, out );
+				}
+				return sink.bytes.load();
+			} );
+			run ( "feed_binary", variant, lines, [&]()
+			{
+				CountingSink sink;
+				FeedHandler handler ( target_size );
+				{
+					BinaryFeedReader reader ( path );
+					OutputWriter out ( sink );
+					reader.replay ( handler, out );
+				}
+				return sink.bytes.load();
+			} );
+		}
+		unlink ( path );
+	}
+
+	/*
+	* A whole feed through FeedHandler, parsing included, like pricer does it. The feed is made up
+	* by FeedGenerator, so it's the same every time.
+	*/
+	void replay ( uint64_t messages, uint32_t orders, uint32_t levels )
+	{
+		FeedGenerator::Parameters parameters;
+		parameters.messages = messages;
+		parameters.orders = orders;
+		parameters.levels = levels;
+		FeedGenerator generator ( parameters );
+		std::string feed;
+		while ( generator.next ( feed ) );
+		for ( uint32_t target_size : { 1, 200, 10000 } )
+		{
+			std::string variant ( "orders=" + std::to_string ( orders ) + "/levels=" + std::to_string ( levels ) + "/target=" + std::to_string ( target_size ) );
+			run ( "replay", variant, messages, [&]()
+			{
+				CountingSink sink;
+				FeedHandler handler ( target_size );
+				{
+					OutputWriter out ( sink );
+					handler.processLines ( feed, out );
+				}
+				return sink.bytes.load();
+			} );
+			// parsing on a thread of its own
+			run ( "replay_pipelined", variant, messages, [&]()
+			{
+				CountingSink sink;
+				FeedHandler handler ( target_size );
+				{
+					OutputWriter out ( sink );
+					Pipeline pipeline ( handler, out );
+					pipeline.processLines ( feed );
+				}
+				return sink.bytes.load();
+			} );
+			// parsing in chunks on a pool
+			run ( "replay_parallel", variant, messages, [&]()
+			{
+				CountingSink sink;
+				FeedHandler handler ( target_size );
+				{
+					OutputWriter out ( sink );
+					ParallelParser parser ( handler, out, std::max ( 2u, std::thread::hardware_concurrency() ) - 1 );
+					parser.processLines ( feed );
+				}
+				return sink.bytes.load();
+			} );
+		}
+	}
+
+	/*
+	* Same, with a book a lot bigger than the last level cache so most messages miss on the order dict, the order store
+	* and the level, for a few batch sizes. 1 is one message at a time without prefetching.
+	*/
+	void replayBatched ( uint64_t messages, uint32_t orders, uint32_t levels )
+	{
+		// the feed takes a while to make, don't bother if nobody wants it
+		if ( std::string ( "replay_batched" ).find ( g_filter ) == std::string::npos )
+			return;
+		FeedGenerator::Parameters parameters;
+		parameters.messages = messages;
+		parameters.orders = orders;
+		parameters.levels = levels;
+		parameters.id_length = 16;
+		FeedGenerator generator ( parameters );
+		std::string feed;
+		while ( generator.next ( feed ) );
+		for ( size_t batch_size : { 1, 8, 32, 128 } )
+		{
+			std::string variant ( "orders=" + std::to_string ( orders ) + "/levels=" + std::to_string ( levels ) + "/batch=" + std::to_string ( batch_size ) );
+			run ( "replay_batched", variant, messages, [&]()
+			{
+				CountingSink sink;
+				FeedHandler handler ( 200 );
+				handler.setBatchSize ( batch_size );
+				{
+					OutputWriter out ( sink );
+					handler.processLines ( feed, out );
+				}
+				return sink.bytes.load();
+			} );
+		}
+	}
+
+	/*
+	* What publishing the top of the book costs the thread running it. depth_publish is filling in a snapshot and
+	* publishing it on its own, depth_replay the replay with a snapshot after every batch ( batch=32 ) or every message
+	* ( batch=1 ), with nobody reading and with another thread reading as fast as it can.
+	*/
+	void depthPublishing ( uint64_t messages, uint32_t orders, uint32_t levels )
+	{
+		FeedGenerator::Parameters parameters;
+		parameters.messages = messages;
+		parameters.orders = orders;
+		parameters.levels = levels;
+		FeedGenerator generator ( parameters );
+		std::string feed;
+		while ( generator.next ( feed ) );
+		for ( size_t depth : { 5, 20 } )
+		{
+			std::string variant ( "orders=" + std::to_string ( orders ) + "/levels=" + std::to_string ( levels ) + "/depth=" + std::to_string ( depth ) );
+			FeedHandler handler ( 200 );
+			{
+				CountingSink sink;
+				OutputWriter out ( sink );
+				handler.processLines ( feed, out );
+			}
+			DepthPublisher publisher ( depth, 1 );
+			BookDepth snapshot ( depth, 1 );
+			run ( "depth_publish", variant, 1000000, [&]()
+			{
+				for ( size_t i = 0; i < 1000000; i++ )
+				{
+					handler.book().depth ( snapshot );
+					snapshot.time = i;
+					publisher.publish ( snapshot );
+				}
+				return publisher.version();
+			} );
+			for ( size_t batch_size : { 1, 32 } )
+				for ( bool reader : { false, true } )
+				{
+					std::string replay_variant ( variant + "/batch=" + std::to_string ( batch_size ) + ( reader ? "/reader" : "" ) );
+					run ( "depth_replay", replay_variant, messages, [&]()
+					{
+						CountingSink sink;
+						FeedHandler publishing ( 200 );
+						DepthPublisher replay_publisher ( depth, 1 );
+						publishing.setBatchSize ( batch_size );
+						publishing.setDepthPublisher ( &replay_publisher );
+						std::atomic<bool> done ( false );
+						std::thread reading;
+						if ( reader )
+							reading = std::thread ( [&]()
+						{
+							BookDepth seen ( depth, 1 );
+							while ( !done.load ( std::memory_order_relaxed ) )
+								replay_publisher.read ( seen );
+						} );
+						{
+							OutputWriter out ( sink );
+							publishing.processLines ( feed, out );
+						}
+						done = true;
+						if ( reading.joinable() )
+							reading.join();
+						return sink.bytes.load();
+					} );
+				}
+		}
+	}
+
+	/*
+	* OrderBook::add and reduce on their own: fill a book up to depth orders spread over 'levels' ticks of 0.01
+	* on either side of the spread, then take all of them out again in some other order.
+	* Whatever the book prints goes through the writer into a sink that throws it away.
+	*/
+	void orderBook ( size_t depth, uint32_t levels, uint32_t target_size )
+	{
+		std::mt19937 rng ( 17 );
+		std::vector<std::string> ids;
+		std::vector<Order> orders;
+		for ( size_t i = 0; i < depth; i++ )
+		{
+			ids.push_back ( std::to_string ( i * 2654435761u % 4294967291u ) );
+			bool buy ( rng() % 2 );
+			uint32_t tick ( rng() % levels * 10 );
+			orders.push_back ( Order ( buy ? OrderSide::BUY : OrderSide::SELL, 1 + rng() % 300, buy ? 44000 - tick : 44010 + tick ) );
+		}
+		std::vector<size_t> reduce_order ( depth );
+		for ( size_t i = 0; i < depth; i++ )
+			reduce_order[i] = i;
+		std::shuffle ( reduce_order.begin(), reduce_order.end(), rng );
+		std::string variant ( "depth=" + std::to_string ( depth ) + "/levels=" + std::to_string ( levels ) + "/target=" + std::to_string ( target_size ) );
+		CountingSink sink;
+		OutputWriter out ( sink );
+		ErrorSummary errors;
+		// the reduces need the book the adds left behind
+		OrderBook book ( errors, target_size );
+		run ( "order_book_add", variant, depth, [&]()
+		{
+			uint64_t added ( 0 );
+			for ( size_t i = 0; i < depth; i++ )
+				added += book.add ( orders[i], ids[i], 28800000 + i, out );
+			return added;
+		} );
+		run ( "order_book_reduce", variant, depth, [&]()
+		{
+			for ( size_t i : reduce_order )
+				book.reduce ( ids[i], orders[i].volume(), 28800000 + depth + i, out );
+			return book.orders().size();
+		} );
+	}
+
+	struct Node
+	{
+		uint64_t words[6];
+	};
+
+	/*
+	* Allocator churn like a busy book: grow to 'live' objects, then keep freeing a random one and allocating another.
+	*/
+	void slabAllocator ( size_t live, size_t operations )
+	{
+		std::mt19937 rng ( 19 );
+		std::vector<uint32_t> victims;
+		for ( size_t i = 0; i < operations; i++ )
+			victims.push_back ( rng() % live );
+		std::string variant ( "live=" + std::to_string ( live ) );
+		run ( "allocator", "new_delete/" + variant, live + operations, [&]()
+		{
+			std::vector<Node *> nodes;
+			for ( size_t i = 0; i < live; i++ )
+				nodes.push_back ( new Node() );
+			for ( uint32_t victim : victims )
+			{
+				delete nodes[victim];
+				nodes[victim] = new Node();
+			}
+			uint64_t sum ( reinterpret_cast < uintptr_t > ( nodes[0] ) );
+			for ( Node * node : nodes )
+				delete node;
+			return sum;
+		} );
+		run ( "allocator", "slab/" + variant, live + operations, [&]()
+		{
+			SlabAllocator<Node> slab;
+			std::vector<Node *> nodes;
+			for ( size_t i = 0; i < live; i++ )
+				nodes.push_back ( new ( slab.allocate() ) Node() );
+			for ( uint32_t victim : victims )
+			{
+				slab.deallocate ( nodes[victim] );
+				nodes[victim] = new ( slab.allocate() ) Node();
+			}
+			uint64_t sum ( reinterpret_cast < uintptr_t > ( nodes[0] ) );
+			for ( Node * node : nodes )
+				slab.deallocate ( node );
+			return sum;
+		} );
+	}
+
+	/*
+	* Adds and reduces on one side of the book, levels spread over 'levels' ticks of 0.01 around a mid that drifts
+	* within a dollar of where it started, keeping the book around 'depth' orders,
+	* and the total value asked for after every change like OrderBook does.
+	*/
+	template <class Map>
+	void priceLevels ( std::string const & name, uint32_t levels, uint32_t target_size, size_t depth, size_t operations )
+	{
+		std::mt19937 rng ( 7 );
+		std::vector<uint32_t> prices;
+		std::vector<uint32_t> volumes;
+		std::vector<uint32_t> actions;
+		uint32_t mid ( 44000 );
+		for ( size_t i = 0; i < operations; i++ )
+		{
+			mid += rng() % 3 * 10 - 10;
+			mid = std::max ( 43000u, std::min ( 45000u, mid ) );
+			prices.push_back ( mid + rng() % levels * 10 );
+			volumes.push_back ( 1 + rng() % 300 );
+			actions.push_back ( rng() );
+		}
+		std::string variant ( name + "/depth=" + std::to_string ( depth ) + "/levels=" + std::to_string ( levels ) + "/target=" + std::to_string ( target_size ) );
+		run ( "price_levels", variant, operations, [&]()
+		{
+			Map map ( target_size );
+			OrderStore store;
+			std::vector<OrderHandle> orders;
+			uint64_t sum ( 0 );
+			for ( size_t i = 0; i < operations; i++ )
+			{
+				// keep the book around depth orders
+				if ( orders.empty() || actions[i] % ( 2 * depth ) >= orders.size() )
+				{
+					OrderHandle order ( store.allocate ( Order ( OrderSide::BUY, volumes[i], prices[i] ) ) );
+					map.add ( store, order );
+					orders.push_back ( order );
+				}
+				else
+				{
+					size_t index ( actions[i] % orders.size() );
+					if ( map.reduce ( store, orders[index], volumes[i] ) )
+					{
+						orders[index] = orders.back();
+						orders.pop_back();
+					}
+				}
+				sum += map.get_total_value();
+			}
+			map.clear();
+			return sum;
+		} );
+	}
+
+	/*
+	* A risk check after every change: what sweeping 8 sizes anywhere up to the whole side costs, and how much a budget buys,
+	* on the same kind of book as price_levels. walk goes through the levels for every one of them, sums asks the
+	* prefix sums ( and pays for keeping them up to date on every add and reduce ).
+	*/
+	void sweepCosts ( uint32_t levels, size_t depth, size_t operations )
+	{
+		std::mt19937 rng ( 9 );
+		std::vector<uint32_t> prices;
+		std::vector<uint32_t> volumes;
+		std::vector<uint32_t> actions;
+		uint32_t mid ( 44000 );
+		for ( size_t i = 0; i < operations; i++ )
+		{
+			mid += rng() % 3 * 10 - 10;
+			mid = std::max ( 43000u, std::min ( 45000u, mid ) );
+			prices.push_back ( mid - rng() % levels * 10 );
+			volumes.push_back ( 1 + rng() % 300 );
+			actions.push_back ( rng() );
+		}
+		for ( bool sums : { false, true } )
+		{
+			std::string variant ( std::string ( sums ? "sums" : "walk" ) + "/depth=" + std::to_string ( depth ) + "/levels=" + std::to_string ( levels ) );
+			run ( "sweep_costs", variant, operations, [&]()
+			{
+				PriceLevelMap < std::greater<uint32_t> > map ( 200 );
+				if ( sums )
+					map.enable_sweeps();
+				OrderStore store;
+				std::vector<OrderHandle> orders;
+				uint64_t sum ( 0 );
+				for ( size_t i = 0; i < operations; i++ )
+				{
+					if ( orders.empty() || actions[i] % ( 2 * depth ) >= orders.size() )
+					{
+						OrderHandle order ( store.allocate ( Order ( OrderSide::BUY, volumes[i], prices[i] ) ) );
+						map.add ( store, order );
+						orders.push_back ( order );
+					}
+					else
+					{
+						size_t index ( actions[i] % orders.size() );
+						if ( map.reduce ( store, orders[index], volumes[i] ) )
+						{
+							orders[index] = orders.back();
+							orders.pop_back();
+						}
+					}
+					for ( uint32_t query = 1; query <= 8; query++ )
+						sum += map.cost_for ( static_cast < uint32_t > ( map.total_volume * uint64_t ( query ) / 8 ) );
+					sum += map.size_for_budget ( uint64_t ( map.total_volume ) * 20000 );
+				}
+				map.clear();
+				return sum;
+			} );
+		}
+	}
+}
+
+int main ( int argc, char **argv )
+{
+	if ( argc > 1 )
+		g_filter = argv[1];
+	printf ( "benchmark,variant,operations,ns_per_op,ops_per_sec,instructions_per_op\n" );
+	parseFields ( 1000 );
+	parseMessages ( 250 );
+	orderIds ( 10000 );
+	orderIds ( 1000000 );
+	outputLines ( 1000000 );
+	symbolScaling ( 64, 2000000 );
+	feedFormats ( 2000000 );
+	replay ( 2000000, 1000, 20 );
+	replay ( 2000000, 10000, 200 );
+	replayBatched ( 12000000, 3000000, 2000 );
+	depthPublishing ( 2000000, 10000, 200 );
+	for ( size_t live : { 1000, 100000 } )
+		slabAllocator ( live, 2000000 );
+	for ( size_t depth : { 1000, 10000, 100000 } )
+		for ( uint32_t levels : { 20, 200 } )
+			for ( uint32_t target_size : { 1, 200, 10000 } )
+				orderBook ( depth, levels, target_size );
+	for ( size_t depth : { 200, 2000, 20000 } )
+		for ( uint32_t levels : { 20, 200 } )
+			for ( uint32_t target_size : { 1, 200, 10000 } )
+			{
+				priceLevels < PriceLevelMap < std::greater<uint32_t> > > ( "tree", levels, target_size, depth, 1000000 );
+				priceLevels < LadderPriceLevelMap < std::greater<uint32_t> > > ( "ladder", levels, target_size, depth, 1000000 );
+			}
+	for ( uint32_t levels : { 20, 200, 2000 } )
+		sweepCosts ( levels, 20000, 1000000 );
+	return 0;
+}
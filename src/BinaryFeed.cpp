@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <string.h>
+#include <stdexcept>
+
+#include "BinaryFeed.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		static_assert ( sizeof ( BinaryFeed::Header ) == 32, "header layout changed" );
+		static_assert ( sizeof ( BinaryFeed::Record ) == 24, "record layout changed" );
+
+		bool BinaryFeed::matches ( std::string_view data )
+		{
+			return data.size() >= sizeof ( f_magic ) && memcmp ( data.data(), f_magic, sizeof ( f_magic ) ) == 0;
+		}
+
+		BinaryFeedWriter::BinaryFeedWriter ( std::string const & path ) :
+			m_path ( path ),
+			m_file ( fopen ( path.c_str(), "wb" ) ),
+			m_records ( 0 ),
+			m_id_offsets ( 1, 0 )
+		{
+			if ( !m_file )
+				throw std::runtime_error ( "Unable to open " + path );
+			// all zeroes until we're done, so a half written file never looks like a feed
+			BinaryFeed::Header header;
+			memset ( &header, 0, sizeof ( header ) );
+			write ( &header, sizeof ( header ) );
+		}
+
+		BinaryFeedWriter::~BinaryFeedWriter()
+		{
+			if ( m_file )
+				fclose ( m_file );
+		}
+
+		void BinaryFeedWriter::append ( Message const & message )
+		{
+			BinaryFeed::Record record;
+			memset ( &record, 0, sizeof ( record ) );
+			record.time = message.time.value;
+			record.time_digits = message.time.digits;
+			record.order_id = BinaryFeed::f_no_order_id;
+			record.price = message.price;
+			record.size = message.size;
+			record.type = message.type;
+			record.side = message.side;
+			if ( message.type == MessageType::ADD || message.type == MessageType::REDUCE )
+			{
+				std::pair<size_t, bool> pos ( m_ids.insert ( message.order_id ) );
+				if ( pos.second )
+				{
+					m_ids.value ( pos.first ) = m_id_offsets.size() - 1;
+					m_id_chars.append ( message.order_id );
+					m_id_offsets.push_back ( m_id_chars.size() );
+				}
+				record.order_id = m_ids.value ( pos.first );
+			}
+			write ( &record, sizeof ( record ) );
+			m_records++;
+		}
+
+		void BinaryFeedWriter::finish()
+		{
+			write ( m_id_offsets.data(), m_id_offsets.size() * sizeof ( uint64_t ) );
+			write ( m_id_chars.data(), m_id_chars.size() );
+			BinaryFeed::Header header;
+			memset ( &header, 0, sizeof ( header ) );
+			memcpy ( header.magic, BinaryFeed::f_magic, sizeof ( header.magic ) );
+			header.version = BinaryFeed::f_version;
+			header.record_size = sizeof ( BinaryFeed::Record );
+			header.records = m_records;
+			header.ids = m_id_offsets.size() - 1;
+			if ( fseek ( m_file, 0, SEEK_SET ) != 0 )
+				throw std::runtime_error ( "Unable to seek in " + m_path );
+			write ( &header, sizeof ( header ) );
+			FILE * file ( m_file );
+			m_file = 0;
+			if ( fclose ( file ) != 0 )
+				throw std::runtime_error ( "Unable to write " + m_path );
+		}
+
+		uint64_t BinaryFeedWriter::records() const
+		{
+			return m_records;
+		}
+
+		uint64_t BinaryFeedWriter::ids() const
+		{
+			return m_id_offsets.size() - 1;
+		}
+
+		void BinaryFeedWriter::write ( const void * data, size_t size )
+		{
+			if ( size > 0 && fwrite ( data, size, 1, m_file ) != 1 )
+				throw std::runtime_error ( "Unable to write " + m_path );
+		}
+
+		BinaryFeedReader::BinaryFeedReader ( std::string const & path ) :
+			m_file ( path ),
+			m_records ( 0 ),
+			m_size ( 0 ),
+			m_id_offsets ( 0 ),
+			m_ids ( 0 ),
+			m_id_chars ( 0 )
+		{
+			const char * data ( m_file.data() );
+			size_t size ( m_file.size() );
+			if ( size < sizeof ( BinaryFeed::Header ) || !BinaryFeed::matches ( m_file.view() ) )
+				throw std::runtime_error ( "Not a binary feed: " + path );
+			const BinaryFeed::Header * header ( reinterpret_cast < const BinaryFeed::Header * > ( data ) );
+			if ( header->version != BinaryFeed::f_version || header->record_size != sizeof ( BinaryFeed::Record ) )
+				throw std::runtime_error ( "Unsupported binary feed: " + path );
+			// sizes are checked one step at a time, so a broken header can't make us overflow
+			size_t left ( size - sizeof ( BinaryFeed::Header ) );
+			if ( header->records > left / sizeof ( BinaryFeed::Record ) )
+				throw std::runtime_error ( "Truncated binary feed: " + path );
+			left -= header->records * sizeof ( BinaryFeed::Record );
+			if ( header->ids >= left / sizeof ( uint64_t ) )
+				throw std::runtime_error ( "Truncated binary feed: " + path );
+			left -= ( header->ids + 1 ) * sizeof ( uint64_t );
+			m_records = reinterpret_cast < const BinaryFeed::Record * > ( data + sizeof ( BinaryFeed::Header ) );
+			m_size = header->records;
+			m_id_offsets = reinterpret_cast < const uint64_t * > ( m_records + m_size );
+			m_ids = header->ids;
+			m_id_chars = reinterpret_cast < const char * > ( m_id_offsets + m_ids + 1 );
+			if ( m_id_offsets[m_ids] > left )
+				throw std::runtime_error ( "Truncated binary feed: " + path );
+		}
+
+		uint64_t BinaryFeedReader::size() const
+		{
+			return m_size;
+		}
+
+		std::string_view BinaryFeedReader::records ( uint64_t first, uint64_t last ) const
+		{
+			return std::string_view ( reinterpret_cast < const char * > ( m_records + first ), ( last - first ) * sizeof ( BinaryFeed::Record ) );
+		}
+
+		void BinaryFeedReader::message ( uint64_t index, Message & message ) const
+		{
+			BinaryFeed::Record const & record ( m_records[index] );
+			// whatever we don't know counts as corrupted, same as a line we couldn't parse
+			message.type = record.type <= MessageType::WEIRD_NUMBERS ? static_cast < MessageType::Type > ( record.type ) : MessageType::CORRUPTED;
+			message.side = record.side == OrderSide::SELL ? OrderSide::SELL : OrderSide::BUY;
+			message.time = Timestamp ( record.time, record.time_digits );
+			message.price = record.price;
+			message.size = record.size;
+			if ( record.order_id < m_ids )
+				message.order_id = std::string_view ( m_id_chars + m_id_offsets[record.order_id],
+													  m_id_offsets[record.order_id + 1] - m_id_offsets[record.order_id] );
+			else
+				message.order_id = std::string_view();
+		}
+
+		void BinaryFeedReader::replay ( FeedHandler & feed, OutputWriter & out, uint64_t first ) const
+		{
+			std::vector<Message> batch ( feed.batchSize() );
+			for ( uint64_t i = first; i < m_size; i += batch.size() )
+			{
+				size_t count ( std::min<uint64_t> ( batch.size(), m_size - i ) );
+				for ( size_t j = 0; j < count; j++ )
+					this->message ( i + j, batch[j] );
+				feed.processBatch ( batch.data(), count, out );
+			}
+			out.endBatch();
+		}
+	}
+}
@@ -0,0 +1,120 @@
+#ifndef __BINARY_FEED_HPP__
+#define __BINARY_FEED_HPP__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "FeedHandler.hpp"
+#include "MappedFile.hpp"
+#include "Message.hpp"
+#include "OrderIdIndex.hpp"
+#include "OutputWriter.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* The feed after it's been parsed once, so replaying it doesn't have to parse it again.
+		*
+		* A file is a header, one fixed size record per line of the text feed ( errors included, so a replay counts
+		* them the same ), and a table with every distinct order id. Records refer to their order id by its index
+		* in that table. Everything is in native byte order and 8 byte aligned, it's meant to be read back where it was made.
+		*
+		*   Header | Record * records | uint64_t offset * ( ids + 1 ) | id characters
+		*/
+		namespace BinaryFeed
+		{
+			static const char f_magic[8] = { 'R', 'G', 'M', 'F', 'E', 'E', 'D', '1' };
+			static const uint32_t f_version = 1;
+			// reduces that didn't parse don't have an order id we'd want to keep
+			static const uint32_t f_no_order_id = UINT32_MAX;
+
+			struct Header
+			{
+				char magic[8];
+				uint32_t version;
+				uint32_t record_size;
+				uint64_t records;
+				uint64_t ids;
+			};
+
+			struct Record
+			{
+				uint64_t time;
+				uint32_t order_id;
+				// ticks of 1/Constants::round_size
+				uint32_t price;
+				uint32_t size;
+				// MessageType and OrderSide
+				uint8_t type;
+				uint8_t side;
+				// digits the timestamp came in with, 0 in files from before we kept them
+				uint8_t time_digits;
+				uint8_t padding;
+			};
+
+			/* Whether the data starts out like one of ours */
+			bool matches ( std::string_view data );
+		}
+
+		/*
+		* Writes a binary feed, message by message. Nothing is usable until finish() wrote the id table and the header.
+		*/
+		class BinaryFeedWriter
+		{
+		public:
+			BinaryFeedWriter ( std::string const & path );
+			~BinaryFeedWriter();
+
+			void append ( Message const & message );
+			void finish();
+
+			uint64_t records() const;
+			uint64_t ids() const;
+		private:
+			BinaryFeedWriter ( BinaryFeedWriter const & rhs );
+			BinaryFeedWriter & operator= ( BinaryFeedWriter const & rhs );
+
+			std::string m_path;
+			FILE * m_file;
+			uint64_t m_records;
+			OrderIdIndex<uint32_t> m_ids;
+			std::vector<uint64_t> m_id_offsets;
+			std::string m_id_chars;
+
+			void write ( const void * data, size_t size );
+		};
+
+		/*
+		* A binary feed mapped into memory. Messages come straight out of the records, their order ids
+		* are views into the mapped id table.
+		*/
+		class BinaryFeedReader
+		{
+		public:
+			BinaryFeedReader ( std::string const & path );
+
+			uint64_t size() const;
+			void message ( uint64_t index, Message & message ) const;
+			/* The records of messages first up to last as they are in the file, to checksum */
+			std::string_view records ( uint64_t first, uint64_t last ) const;
+			/* Every message from first on into the feed, in order, batchSize() of them at a time */
+			void replay ( FeedHandler & feed, OutputWriter & out, uint64_t first = 0 ) const;
+		private:
+			BinaryFeedReader ( BinaryFeedReader const & rhs );
+			BinaryFeedReader & operator= ( BinaryFeedReader const & rhs );
+
+			MappedFile m_file;
+			const BinaryFeed::Record * m_records;
+			uint64_t m_size;
+			const uint64_t * m_id_offsets;
+			uint64_t m_ids;
+			const char * m_id_chars;
+		};
+	}
+}
+
+#endif
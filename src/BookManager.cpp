@@ -0,0 +1,181 @@
+#include "BookManager.hpp"
+#include "CpuSet.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		BookManager::Worker::Worker ( size_t queue_capacity, OutputSink & sink, FlushPolicy::Policy policy ) :
+			queue ( queue_capacity ),
+			out ( sink, policy ),
+			pushed ( 0 ),
+			done ( 0 ),
+			stop ( false )
+		{
+		}
+
+		BookManager::BookManager ( std::vector<uint32_t> const & target_sizes,
+								   size_t threads,
+								   OutputSink & sink,
+								   FlushPolicy::Policy policy,
+								   size_t queue_capacity ) :
+			m_target_sizes ( target_sizes ),
+			m_sink ( sink ),
+			m_pinned ( 0 )
+		{
+			for ( size_t i = 0; i < std::max < size_t > ( 1, threads ); i++ )
+				m_workers.push_back ( std::unique_ptr<Worker> ( new Worker ( queue_capacity, m_sink, policy ) ) );
+			CpuSet cpus;
+			for ( size_t i = 0; i < m_workers.size(); i++ )
+			{
+				m_workers[i]->thread = std::thread ( &BookManager::run, this, i );
+				// if we can't have a core to ourselves, we'll just have to share
+				if ( cpus.pin ( m_workers[i]->thread, i ) )
+					m_pinned++;
+			}
+		}
+
+		/* The workers get to finish what's queued, and take their books with them */
+		BookManager::~BookManager()
+		{
+			for ( std::unique_ptr<Worker> & worker : m_workers )
+				worker->stop.store ( true, std::memory_order_release );
+			for ( std::unique_ptr<Worker> & worker : m_workers )
+				worker->thread.join();
+		}
+
+		void BookManager::route ( std::string_view line )
+		{
+			size_t symbol_end ( line.find ( ' ' ) );
+			if ( symbol_end == std::string_view::npos || symbol_end == 0 || symbol_end > f_max_symbol )
+			{
+				m_routing_errors.corrupted_messages++;
+				return;
+			}
+			Book & target ( book ( line.substr ( 0, symbol_end ) ) );
+			Task task = { &target, line.substr ( symbol_end + 1 ) };
+			push ( *m_workers[target.worker], task );
+		}
+
+		size_t BookManager::routeLines ( std::string_view buffer )
+		{
+			size_t line_begin ( 0 );
+			size_t line_end ( buffer.find ( '\n' ) );
+			while ( line_end != std::string_view::npos )
+			{
+				route ( buffer.substr ( line_begin, line_end - line_begin ) );
+				line_begin = line_end + 1;
+				line_end = buffer.find ( '\n', line_begin );
+			}
+			return line_begin;
+		}
+
+		void BookManager::finish()
+		{
+			Task flush = { 0, std::string_view() };
+			for ( std::unique_ptr<Worker> & worker : m_workers )
+				push ( *worker, flush );
+			for ( std::unique_ptr<Worker> & worker : m_workers )
+				while ( worker->done.load ( std::memory_order_acquire ) < worker->pushed )
+					std::this_thread::yield();
+		}
+
+		size_t BookManager::threads() const
+		{
+			return m_workers.size();
+		}
+
+		size_t BookManager::pinned() const
+		{
+			return m_pinned;
+		}
+
+		size_t BookManager::symbols() const
+		{
+			return m_books.size();
+		}
+
+		FeedHandler const * BookManager::handler ( std::string_view symbol ) const
+		{
+			size_t pos ( m_symbols.find ( symbol ) );
+			return pos == OrderIdIndex<size_t>::npos ? 0 : m_books[m_symbols.value ( pos )]->handler;
+		}
+
+		ErrorSummary BookManager::errors() const
+		{
+			ErrorSummary errors ( m_routing_errors );
+			for ( std::unique_ptr<Book> const & book : m_books )
+				if ( book->handler )
+					errors += book->handler->errors();
+			return errors;
+		}
+
+		void BookManager::printErrorSummary ( std::ostream & os ) const
+		{
+			os << "Errors:" << std::endl;
+			os << errors();
+		}
+
+		/* Find the symbol's book, a new one goes to the next worker in line */
+		BookManager::Book & BookManager::book ( std::string_view symbol )
+		{
+			std::pair<size_t, bool> entry ( m_symbols.insert ( symbol ) );
+			if ( entry.second )
+			{
+				Book * book ( new Book );
+				book->symbol = std::string ( symbol );
+				book->worker = m_books.size() % m_workers.size();
+				book->handler = 0;
+				m_symbols.value ( entry.first ) = m_books.size();
+				m_books.push_back ( std::unique_ptr<Book> ( book ) );
+			}
+			return *m_books[m_symbols.value ( entry.first )];
+		}
+
+		void BookManager::push ( Worker & worker, Task const & task )
+		{
+			while ( !worker.queue.push ( task ) )
+				std::this_thread::yield();
+			worker.pushed++;
+		}
+
+		void BookManager::run ( size_t index )
+		{
+			Worker & worker ( *m_workers[index] );
+			Task task;
+			size_t idle ( 0 );
+			for ( ;; )
+			{
+				if ( worker.queue.pop ( task ) )
+				{
+					if ( task.book )
+					{
+						Book & book ( *task.book );
+						if ( !book.handler )
+						{
+							book.handler = new FeedHandler ( m_target_sizes );
+							worker.handlers.push_back ( book.handler );
+						}
+						worker.out.setPrefix ( book.symbol );
+						book.handler->processMessage ( task.message, worker.out );
+					}
+					else
+						worker.out.flush();
+					worker.done.store ( worker.done.load ( std::memory_order_relaxed ) + 1, std::memory_order_release );
+					idle = 0;
+				}
+				// anything pushed before stop is visible once we've seen it
+				else if ( worker.stop.load ( std::memory_order_acquire ) )
+				{
+					if ( worker.queue.empty() )
+						break;
+				}
+				// spin a little before we give up the core
+				else if ( ++idle > 64 )
+					std::this_thread::yield();
+			}
+			worker.out.flush();
+			for ( FeedHandler * handler : worker.handlers )
+				delete handler;
+		}
+	}
+}
@@ -0,0 +1,113 @@
+#ifndef __BOOK_MANAGER_HPP__
+#define __BOOK_MANAGER_HPP__
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "ErrorSummary.hpp"
+#include "FeedHandler.hpp"
+#include "OrderIdIndex.hpp"
+#include "OutputWriter.hpp"
+#include "SpscQueue.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* One book per symbol, for a feed where every line starts with the symbol: "<symbol> <message>".
+		*
+		* Symbols are spread over a fixed number of worker threads, each pinned to its own core where we can ( one of the
+		* cores we're allowed on, see CpuSet ).
+		* The thread calling route() is the only producer, and every worker has its own single producer / single consumer
+		* queue. A symbol always goes to the same worker, so its messages are handled in the order they came in.
+		*
+		* Only views of the lines are queued, the text has to stay put until finish() returns.
+		* Output lines get the symbol in front, every worker buffers its own and hands the sink whole lines only.
+		*
+		* Books are made and destroyed on their worker ( their memory comes from that thread's allocators ), so they're only
+		* for looking at between finish() and the end of the manager.
+		*/
+		class BookManager
+		{
+		public:
+			static const size_t f_default_queue_capacity = 64 * 1024;
+
+			BookManager ( std::vector<uint32_t> const & target_sizes,
+						  size_t threads,
+						  OutputSink & sink,
+						  FlushPolicy::Policy policy = FlushPolicy::ON_EXIT,
+						  size_t queue_capacity = f_default_queue_capacity );
+			~BookManager();
+
+			void route ( std::string_view line );
+			/* Every complete line in the buffer, returns the number of bytes consumed */
+			size_t routeLines ( std::string_view buffer );
+			/* Wait until everything routed so far is handled and its output is in the sink */
+			void finish();
+
+			size_t threads() const;
+			/* Workers we managed to pin */
+			size_t pinned() const;
+			size_t symbols() const;
+			/* The symbol's handler, 0 if we haven't seen it */
+			FeedHandler const * handler ( std::string_view symbol ) const;
+			/* Lines we couldn't even route, plus whatever the books ran into */
+			ErrorSummary errors() const;
+			void printErrorSummary ( std::ostream & os ) const;
+		private:
+			// longest symbol we accept, it ends up in front of every output line
+			static const size_t f_max_symbol = OutputWriter::f_max_prefix - 1;
+
+			struct Book
+			{
+				std::string symbol;
+				size_t worker;
+				// the worker makes it when the first message comes in
+				FeedHandler * handler;
+			};
+
+			/* A message for a worker, no book means flush the output */
+			struct Task
+			{
+				Book * book;
+				std::string_view message;
+			};
+
+			struct Worker
+			{
+				Worker ( size_t queue_capacity, OutputSink & sink, FlushPolicy::Policy policy );
+
+				SpscQueue<Task> queue;
+				OutputWriter out;
+				std::vector<FeedHandler *> handlers;
+				// tasks pushed is the producer's, tasks done is the worker's
+				size_t pushed;
+				std::atomic<size_t> done;
+				std::atomic<bool> stop;
+				std::thread thread;
+			};
+
+			BookManager ( BookManager const & rhs );
+			BookManager & operator= ( BookManager const & rhs );
+
+			std::vector<uint32_t> m_target_sizes;
+			SynchronizedSink m_sink;
+			ErrorSummary m_routing_errors;
+			OrderIdIndex<size_t> m_symbols;
+			std::vector<std::unique_ptr<Book> > m_books;
+			std::vector<std::unique_ptr<Worker> > m_workers;
+			size_t m_pinned;
+
+			Book & book ( std::string_view symbol );
+			void push ( Worker & worker, Task const & task );
+			void run ( size_t index );
+		};
+	}
+}
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef __CONSTANTS_HPP__
 #define __CONSTANTS_HPP__
 
+#include <stdint.h>
+
 namespace RgmInterview {
 	namespace OrderBook {
 		namespace Constants	{
@@ -9,7 +11,14 @@ namespace RgmInterview {
 			// * Prices are always positive ( not neccessarily the case, for instance a put spread or irs can have a negative price )
 			// * The tick size is more than 0.001.
 			// If that's not the case, this number should be higher.
-			static const double round_size ( 1000.0 );
+			static constexpr double round_size ( 1000.0 );
+			// round_size expressed as a number of decimals, this is what the price parser works with
+			static constexpr uint32_t round_decimals ( 3 );
+
+			static constexpr uint32_t pow10 ( uint32_t decimals )
+			{
+				return decimals == 0 ? 1 : 10 * pow10 ( decimals - 1 );
+			}
 		}
 	}
 }
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <iostream>
+#include <string>
+
+#include "BinaryFeed.hpp"
+#include "FeedHandler.hpp"
+#include "MappedFile.hpp"
+
+using namespace RgmInterview::OrderBook;
+
+static void usage()
+{
+	std::cerr << "Usage: converter [-i input-file] output-file" << std::endl;
+	std::cerr << "  -i  memory map the feed from input-file instead of reading stdin" << std::endl;
+	std::cerr << "Parses a text feed once and writes it as a binary feed, for pricer -b" << std::endl;
+}
+
+static void convertLine ( std::string_view line, BinaryFeedWriter & out )
+{
+	Message message;
+	FeedHandler::parseMessage ( line, message );
+	out.append ( message );
+}
+
+static void convertMappedFile ( std::string const & path, BinaryFeedWriter & out )
+{
+	MappedFile file ( path );
+	std::string_view data ( file.view() );
+	size_t line_begin ( 0 );
+	size_t line_end ( data.find ( '\n' ) );
+	while ( line_end != std::string_view::npos )
+	{
+		convertLine ( data.substr ( line_begin, line_end - line_begin ), out );
+		line_begin = line_end + 1;
+		line_end = data.find ( '\n', line_begin );
+	}
+	// last line without a newline
+	if ( line_begin < data.size() )
+		convertLine ( data.substr ( line_begin ), out );
+}
+
+static void convertStream ( FILE * input, BinaryFeedWriter & out )
+{
+	char * line ( 0 );
+	size_t capacity ( 0 );
+	ssize_t len;
+	while ( ( len = getline ( &line, &capacity, input ) ) >= 0 )
+	{
+		if ( len > 0 && line[len - 1] == '\n' )
+			--len;
+		convertLine ( std::string_view ( line, len ), out );
+	}
+	free ( line );
+}
+
+int main ( int argc, char **argv )
+{
+	try
+	{
+		std::string input_file;
+		int opt;
+		while ( ( opt = getopt ( argc, argv, "i:" ) ) != -1 )
+		{
+			switch ( opt )
+			{
+			case 'i':
+				input_file = optarg;
+				break;
+			default:
+				usage();
+				return 1;
+			}
+		}
+		if ( optind + 1 != argc )
+		{
+			usage();
+			return 1;
+		}
+		BinaryFeedWriter out ( argv[optind] );
+		if ( input_file.empty() )
+			convertStream ( stdin, out );
+		else
+			convertMappedFile ( input_file, out );
+		out.finish();
+		std::cerr << out.records() << " messages, " << out.ids() << " order ids" << std::endl;
+		return 0;
+	}
+	catch ( std::exception & ex )
+	{
+		std::cerr << "Exception caught: " << ex.what() << std::endl;
+		return 1;
+	}
+}
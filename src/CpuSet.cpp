@@ -0,0 +1,42 @@
+#include <pthread.h>
+#include <sched.h>
+
+#include "CpuSet.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		CpuSet::CpuSet()
+		{
+			cpu_set_t allowed;
+			CPU_ZERO ( &allowed );
+			if ( sched_getaffinity ( 0, sizeof ( allowed ), &allowed ) != 0 )
+				return;
+			for ( int cpu = 0; cpu < CPU_SETSIZE; cpu++ )
+			{
+				if ( CPU_ISSET ( cpu, &allowed ) )
+					m_cpus.push_back ( cpu );
+			}
+		}
+
+		size_t CpuSet::size() const
+		{
+			return m_cpus.size();
+		}
+
+		int CpuSet::cpu ( size_t n ) const
+		{
+			return m_cpus.empty() ? -1 : m_cpus[n % m_cpus.size()];
+		}
+
+		bool CpuSet::pin ( std::thread & thread, size_t n ) const
+		{
+			if ( m_cpus.empty() )
+				return false;
+			cpu_set_t cpus;
+			CPU_ZERO ( &cpus );
+			CPU_SET ( cpu ( n ), &cpus );
+			return pthread_setaffinity_np ( thread.native_handle(), sizeof ( cpus ), &cpus ) == 0;
+		}
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef __CPU_SET_HPP__
+#define __CPU_SET_HPP__
+
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* The CPUs we're allowed on ( taskset, a cgroup cpuset, .. ), as they were when we were made, so threads can be
+		* handed one each in turn and only share once every one of them is taken.
+		*/
+		class CpuSet
+		{
+		public:
+			CpuSet();
+
+			size_t size() const;
+			/* The n-th CPU we're allowed on, round the set again past the end */
+			int cpu ( size_t n ) const;
+			/* Keeps thread on cpu ( n ). False if we couldn't, it runs wherever the scheduler puts it then */
+			bool pin ( std::thread & thread, size_t n ) const;
+		private:
+			std::vector<int> m_cpus;
+		};
+	}
+}
+
+#endif
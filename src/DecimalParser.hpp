@@ -0,0 +1,206 @@
+#ifndef __DECIMAL_PARSER_HPP__
+#define __DECIMAL_PARSER_HPP__
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "Constants.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* Turns price and size fields straight into integers in a single pass, no libc.
+		*
+		* The fast path only knows plain decimals ( "44.26", "100" ). Anything else ( whitespace, signs, exponents, .. )
+		* goes through the old strtod/strtoul code, so we accept and reject exactly the same fields as before.
+		*/
+		class DecimalParser
+		{
+		public:
+			/*
+			* Price in ticks of 1/Constants::round_size, exactly the ticks floor ( strtod * round_size ) gave us, down
+			* to the prices that come out a tick short ( 8.12 is 8119 ). Has to be > 0.
+			*
+			* Digits that fit in a double's 53 bits over a power of ten that does too is one division, which rounds
+			* the same way strtod does. Anything longer goes through strtod itself.
+			*/
+			static inline bool parsePrice ( const char * input, size_t len, uint32_t & out )
+			{
+				const char * end ( input + len );
+				const char * p ( input );
+				uint64_t digits ( 0 );
+				while ( p != end && isDigit ( *p ) )
+				{
+					digits = digits * 10 + ( *p - '0' );
+					if ( digits > max_exact_digits )
+						return parsePriceLegacy ( input, len, out );
+					++p;
+				}
+				bool has_digits ( p != input );
+				size_t decimals ( 0 );
+				if ( p != end && *p == '.' )
+				{
+					++p;
+					const char * fraction ( p );
+					while ( p != end && isDigit ( *p ) )
+					{
+						digits = digits * 10 + ( *p - '0' );
+						if ( digits > max_exact_digits || ++decimals > max_exact_decimals )
+							return parsePriceLegacy ( input, len, out );
+						++p;
+					}
+					has_digits = has_digits || p != fraction;
+				}
+				if ( p != end || !has_digits )
+					return parsePriceLegacy ( input, len, out );
+				return toTicks ( static_cast < double > ( digits ) / powerOfTen ( decimals ), out );
+			}
+
+			/* Unsigned 32 bit volume */
+			static inline bool parseSize ( const char * input, size_t len, uint32_t & out )
+			{
+				static const uint64_t max_size ( std::numeric_limits<uint32_t>::max() );
+				// empty or more than 10 characters, this isn't going to be a plain number that fits
+				if ( len == 0 || len > 10 )
+					return parseSizeLegacy ( input, len, out );
+				uint64_t value ( 0 );
+				for ( size_t i = 0; i < len; i++ )
+				{
+					if ( !isDigit ( input[i] ) )
+						return parseSizeLegacy ( input, len, out );
+					value = value * 10 + ( input[i] - '0' );
+				}
+				if ( value > max_size )
+					return false;
+				out = static_cast < uint32_t > ( value );
+				return true;
+			}
+
+			/* Timestamps are plain unsigned integers, at most 19 digits so anything goes in 64 bits */
+			static inline bool parseTimestamp ( const char * input, size_t len, uint64_t & out )
+			{
+				if ( len == 0 || len > 19 )
+					return false;
+				uint64_t value ( 0 );
+				for ( size_t i = 0; i < len; i++ )
+				{
+					if ( !isDigit ( input[i] ) )
+						return false;
+					value = value * 10 + ( input[i] - '0' );
+				}
+				out = value;
+				return true;
+			}
+
+			/* The strtod based conversion we used to have */
+			static bool parsePriceLegacy ( const char * input, size_t len, uint32_t & out )
+			{
+				double price;
+				return strtodField ( input, len, price ) && toTicks ( price, out );
+			}
+
+			/* The strtoul based conversion we used to have */
+			static bool parseSizeLegacy ( const char * input, size_t len, uint32_t & out )
+			{
+				char field[max_field_length];
+				if ( len >= max_field_length )
+					return false;
+				std::copy ( input, input + len, field );
+				field[len] = '\0';
+				char * endptr;
+				out = strtoul ( field, &endptr, 10 );
+				// success if we processed exactly the number of characters we expected and there's no '-' in there
+				return ( std::find ( field, field + len, '-' ) == field + len &&
+						 endptr == field + len &&
+						 ( len < 10 || !isUIntOverflow ( field, len ) ) );
+			}
+
+		private:
+			// fields shorter than this are copied onto the stack
+			static const size_t max_field_length = 64;
+			// as far as a double holds every integer, and every power of ten
+			static const uint64_t max_exact_digits = 1ULL << 53;
+			static const size_t max_exact_decimals = 22;
+
+			static inline bool isDigit ( char c )
+			{
+				return c >= '0' && c <= '9';
+			}
+
+			static inline double powerOfTen ( size_t n )
+			{
+				static const double powers[max_exact_decimals + 1] =
+				{
+					1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+					1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+				};
+				return powers[n];
+			}
+
+			/*
+			* What the old code did with a price: above 0 or it's no price, then floor ( price * round_size ) cast to a uint32_t.
+			* Past uint32_t that cast went through 64 bits on x86-64 and kept the low 32 ( or 0 from 2^63 up ), so that's
+			* what we do too.
+			*/
+			static inline bool toTicks ( double price, uint32_t & out )
+			{
+				if ( !( price > 0 ) )
+					return false;
+				double ticks ( std::floor ( price * Constants::round_size ) );
+				out = ticks < 9223372036854775808.0 ? static_cast < uint32_t > ( static_cast < int64_t > ( ticks ) ) : 0;
+				return true;
+			}
+
+			/*
+			* Fields are views that aren't necessarily null terminated ( think memory mapped files ),
+			* so they get copied onto the stack before going through strtod.
+			*/
+			static bool strtodField ( const char * input, size_t len, double & out )
+			{
+				char buffer[max_field_length];
+				// strtod never minded how long a field was
+				std::string long_field;
+				char * field ( buffer );
+				if ( len >= max_field_length )
+				{
+					long_field.assign ( input, len );
+					field = &long_field[0];
+				}
+				else
+				{
+					std::copy ( input, input + len, field );
+					field[len] = '\0';
+				}
+				char* endptr;
+				out = strtod ( field, &endptr );
+				// success if we processed exactly the number of characters we expected
+				return ( endptr == field + len && out > 0 );
+			}
+
+			/*
+			* A not so quick check to see if the value's bigger than uint32_t::max
+			*/
+			static bool isUIntOverflow ( const char * input, size_t len )
+			{
+				static const char * max_size ( "4294967295" );
+				if ( len <= 10 )
+				{
+					for ( size_t i = 0; i < len && input[i] >= max_size[i] ; i++ )
+					{
+						if ( input[i] > max_size[i] )
+							return true;
+					}
+					return false;
+				}
+				return true;
+			}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <assert.h>
+
+#include "DepthPublisher.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		BookDepth::BookDepth ( size_t depth, size_t targets ) :
+			depth ( depth ),
+			time ( 0 ),
+			version ( 0 )
+		{
+			for ( size_t side = 0; side < 2; side++ )
+			{
+				levels[side].reserve ( depth );
+				costs[side].reserve ( targets );
+			}
+		}
+
+		DepthPublisher::DepthPublisher ( size_t depth, size_t targets ) :
+			m_depth ( depth ),
+			m_targets ( targets ),
+			m_slot_words ( f_header_words + 2 * depth * f_level_words + 2 * targets ),
+			m_words ( 2 * m_slot_words ),
+			m_sequence ( 0 )
+		{
+		}
+
+		size_t DepthPublisher::depth() const
+		{
+			return m_depth;
+		}
+
+		size_t DepthPublisher::targets() const
+		{
+			return m_targets;
+		}
+
+		/*
+		* Publish n goes into copy n & 1, readers stay on the other one until the sequence is even again.
+		* The fence keeps the copy we're about to write from showing up before the odd sequence that says we're at it.
+		*/
+		void DepthPublisher::publish ( BookDepth const & depth )
+		{
+			assert ( depth.levels[0].size() <= m_depth && depth.levels[1].size() <= m_depth );
+			assert ( depth.costs[0].size() == m_targets && depth.costs[1].size() == m_targets );
+			uint64_t sequence ( m_sequence.load ( std::memory_order_relaxed ) );
+			uint64_t version ( sequence / 2 + 1 );
+			m_sequence.store ( ++sequence, std::memory_order_release );
+			std::atomic_thread_fence ( std::memory_order_release );
+			write ( &m_words[ ( version & 1 ) * m_slot_words], depth, version );
+			m_sequence.store ( ++sequence, std::memory_order_release );
+		}
+
+		void DepthPublisher::write ( std::atomic<uint64_t> * slot, BookDepth const & depth, uint64_t version )
+		{
+			slot[0].store ( depth.time.value, std::memory_order_relaxed );
+			slot[1].store ( version, std::memory_order_relaxed );
+			slot[4].store ( depth.time.digits, std::memory_order_relaxed );
+			std::atomic<uint64_t> * word ( slot + f_header_words );
+			for ( size_t side = 0; side < 2; side++ )
+			{
+				slot[2 + side].store ( depth.levels[side].size(), std::memory_order_relaxed );
+				for ( DepthLevel const & level : depth.levels[side] )
+				{
+					word[0].store ( level.price, std::memory_order_relaxed );
+					word[1].store ( level.volume, std::memory_order_relaxed );
+					word[2].store ( level.orders, std::memory_order_relaxed );
+					word += f_level_words;
+				}
+				word += ( m_depth - depth.levels[side].size() ) * f_level_words;
+			}
+			for ( size_t side = 0; side < 2; side++ )
+				for ( uint64_t cost : depth.costs[side] )
+					( word++ )->store ( cost, std::memory_order_relaxed );
+		}
+
+		bool DepthPublisher::read ( BookDepth & depth ) const
+		{
+			assert ( depth.depth == m_depth );
+			for ( ;; )
+			{
+				uint64_t sequence ( m_sequence.load ( std::memory_order_acquire ) );
+				// the first publish isn't done yet
+				if ( sequence < 2 )
+					return false;
+				uint64_t version ( sequence / 2 );
+				std::atomic<uint64_t> const * slot ( &m_words[ ( version & 1 ) * m_slot_words] );
+				depth.time = Timestamp ( slot[0].load ( std::memory_order_relaxed ), slot[4].load ( std::memory_order_relaxed ) );
+				depth.version = slot[1].load ( std::memory_order_relaxed );
+				std::atomic<uint64_t> const * word ( slot + f_header_words );
+				for ( size_t side = 0; side < 2; side++ )
+				{
+					// a torn count is thrown away below, it just mustn't take us past the slot
+					size_t count ( std::min<uint64_t> ( slot[2 + side].load ( std::memory_order_relaxed ), m_depth ) );
+					depth.levels[side].resize ( count );
+					for ( DepthLevel & level : depth.levels[side] )
+					{
+						level.price = word[0].load ( std::memory_order_relaxed );
+						level.volume = word[1].load ( std::memory_order_relaxed );
+						level.orders = word[2].load ( std::memory_order_relaxed );
+						word += f_level_words;
+					}
+					word += ( m_depth - count ) * f_level_words;
+				}
+				for ( size_t side = 0; side < 2; side++ )
+				{
+					depth.costs[side].resize ( m_targets );
+					for ( uint64_t & cost : depth.costs[side] )
+						cost = ( word++ )->load ( std::memory_order_relaxed );
+				}
+				// the next publish writes the other copy, the one after it ours
+				std::atomic_thread_fence ( std::memory_order_acquire );
+				if ( m_sequence.load ( std::memory_order_relaxed ) <= 2 * version + 2 )
+					return true;
+			}
+		}
+
+		uint64_t DepthPublisher::version() const
+		{
+			return m_sequence.load ( std::memory_order_acquire ) / 2;
+		}
+	}
+}
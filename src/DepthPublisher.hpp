@@ -0,0 +1,86 @@
+#ifndef __DEPTH_PUBLISHER_HPP__
+#define __DEPTH_PUBLISHER_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include "Message.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/* A level the way the feed has it: price in ticks of 1/Constants::round_size, its volume and how many orders that is */
+		struct DepthLevel
+		{
+			uint64_t price;
+			uint64_t volume;
+			uint64_t orders;
+		};
+
+		/*
+		* The top of the book: per side ( indexed by OrderSide ) up to depth levels, best first, and what taking out every
+		* target size costs from that side, in ticks of 1/Constants::round_size ( OutputWriter::f_no_cost if there isn't enough ).
+		* The costs of the buys are the ones the book prints as S.
+		*
+		* Everything is sized up front, filling one in or reading into it doesn't allocate.
+		*/
+		struct BookDepth
+		{
+			BookDepth ( size_t depth = 0, size_t targets = 0 );
+
+			size_t depth;
+			// time of the last message that made it in
+			Timestamp time;
+			// how many snapshots were published up to and including this one
+			uint64_t version;
+			std::vector<DepthLevel> levels[2];
+			std::vector<uint64_t> costs[2];
+		};
+
+		/*
+		* Hands BookDepths from the thread running the book to any number of readers. The book never waits for them,
+		* a reader may have to go again but never waits for the book either.
+		*
+		* A seqlock over two copies. Each publish writes only the copy readers aren't being sent to and then flips them
+		* over to it. The sequence goes up once before that write and once after, so half of it is how many publishes are
+		* done and the last done one's copy is the one to read. A reader copies it out and checks that the publish after
+		* next, which writes that copy again, hasn't started; it only goes again if two publishes overtook it.
+		* Both copies are relaxed atomic words, a read that raced a write is simply thrown away.
+		*/
+		class DepthPublisher
+		{
+		public:
+			DepthPublisher ( size_t depth, size_t targets );
+
+			size_t depth() const;
+			size_t targets() const;
+
+			/* Only ever from one thread, depth has to be sized like we are */
+			void publish ( BookDepth const & depth );
+			/* From any thread, false if nothing was published yet */
+			bool read ( BookDepth & depth ) const;
+			/* Snapshots published so far, cheap enough to poll */
+			uint64_t version() const;
+		private:
+			static const size_t f_cache_line = 64;
+			// time, version, the level count of either side and the time's digits go first
+			static const size_t f_header_words = 5;
+			static const size_t f_level_words = 3;
+
+			DepthPublisher ( DepthPublisher const & rhs );
+			DepthPublisher & operator= ( DepthPublisher const & rhs );
+
+			size_t m_depth;
+			size_t m_targets;
+			size_t m_slot_words;
+			std::vector<std::atomic<uint64_t> > m_words;
+			alignas ( f_cache_line ) std::atomic<uint64_t> m_sequence;
+
+			void write ( std::atomic<uint64_t> * slot, BookDepth const & depth, uint64_t version );
+		};
+	}
+}
+
+#endif
@@ -30,5 +30,15 @@ namespace RgmInterview {
 				   !order_modify_on_order_i_dont_know &&
 				   !unexpected_exception;
 		}
+
+		ErrorSummary & ErrorSummary::operator+= ( ErrorSummary const & rhs )
+		{
+			corrupted_messages += rhs.corrupted_messages;
+			out_of_bounds_or_weird_numbers += rhs.out_of_bounds_or_weird_numbers;
+			order_modify_on_order_i_dont_know += rhs.order_modify_on_order_i_dont_know;
+			duplicate_order_id += rhs.duplicate_order_id;
+			unexpected_exception += rhs.unexpected_exception;
+			return *this;
+		}
 	}
 }
\ No newline at end of file
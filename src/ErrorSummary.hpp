@@ -22,6 +22,7 @@ namespace RgmInterview {
 			uint32_t unexpected_exception;
 
 			bool empty() const;
+			ErrorSummary & operator+= ( ErrorSummary const & rhs );
 		};
 		std::ostream& operator<< ( std::ostream& os, const ErrorSummary& sum );
 	}
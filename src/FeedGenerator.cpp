@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <assert.h>
+
+#include "FeedGenerator.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		FeedGenerator::Parameters::Parameters() :
+			seed ( 1 ),
+			messages ( 1000000 ),
+			orders ( 1000 ),
+			levels ( 100 ),
+			mid ( 4420 ),
+			drift ( 0.01 ),
+			add_ratio ( 0.5 ),
+			full_reduce_ratio ( 0.5 ),
+			id_length ( 0 ),
+			max_size ( 500 ),
+			error_ratio ( 0 )
+		{
+		}
+
+		FeedGenerator::FeedGenerator ( Parameters const & parameters ) :
+			m_parameters ( parameters ),
+			m_rng ( parameters.seed ),
+			m_generated ( 0 ),
+			m_next_id ( 1 ),
+			// 8 in the morning, like the real thing
+			m_time ( 28800000 ),
+			m_mid ( parameters.mid )
+		{
+			m_parameters.levels = std::max<uint32_t> ( 1, m_parameters.levels );
+			m_parameters.orders = std::max<uint32_t> ( 1, m_parameters.orders );
+			m_parameters.max_size = std::max<uint32_t> ( 1, m_parameters.max_size );
+			// the bids have to stay above 0
+			m_mid = std::max ( m_mid, m_parameters.levels + 1 );
+			m_live.reserve ( 2 * m_parameters.orders );
+		}
+
+		bool FeedGenerator::next ( std::string & out )
+		{
+			if ( m_generated == m_parameters.messages )
+				return false;
+			m_generated++;
+			m_time += below ( 50 );
+			if ( uniform() < m_parameters.drift )
+			{
+				if ( below ( 2 ) )
+					m_mid++;
+				else if ( m_mid > m_parameters.levels + 1 )
+					m_mid--;
+			}
+			if ( uniform() < m_parameters.error_ratio )
+			{
+				// an action we don't know, or an add that's missing its size
+				appendUInt ( out, m_time );
+				out += below ( 2 ) ? " X 1 10\n" : " A 1 B 44.00\n";
+				return true;
+			}
+			bool add ( m_live.empty() || ( m_live.size() < 2 * static_cast < size_t > ( m_parameters.orders ) && uniform() < m_parameters.add_ratio ) );
+			if ( add )
+				appendAdd ( out );
+			else
+				appendReduce ( out );
+			return true;
+		}
+
+		uint64_t FeedGenerator::generated() const
+		{
+			return m_generated;
+		}
+
+		size_t FeedGenerator::live() const
+		{
+			return m_live.size();
+		}
+
+		double FeedGenerator::uniform()
+		{
+			return ( m_rng() >> 11 ) * ( 1.0 / 9007199254740992.0 );
+		}
+
+		uint32_t FeedGenerator::below ( uint32_t bound )
+		{
+			return static_cast < uint32_t > ( ( ( m_rng() >> 32 ) * bound ) >> 32 );
+		}
+
+		/* Mostly round lots, like the real thing */
+		uint32_t FeedGenerator::size()
+		{
+			uint32_t max_size ( m_parameters.max_size );
+			if ( max_size >= 100 && below ( 4 ) )
+				return 100 * ( 1 + below ( max_size / 100 ) );
+			return 1 + below ( max_size );
+		}
+
+		void FeedGenerator::appendUInt ( std::string & out, uint64_t value, uint32_t width )
+		{
+			char digits[24];
+			char * end ( digits + sizeof ( digits ) );
+			char * begin ( end );
+			do
+			{
+				*--begin = '0' + value % 10;
+				value /= 10;
+			}
+			while ( value );
+			for ( size_t length = end - begin; length < width; length++ )
+				out += '0';
+			out.append ( begin, end );
+		}
+
+		void FeedGenerator::appendPrice ( std::string & out, uint32_t ticks )
+		{
+			appendUInt ( out, ticks / 100 );
+			out += '.';
+			appendUInt ( out, ticks % 100, 2 );
+		}
+
+		void FeedGenerator::appendAdd ( std::string & out )
+		{
+			LiveOrder order;
+			order.id = m_next_id++;
+			order.volume = size();
+			m_live.push_back ( order );
+			bool buy ( below ( 2 ) );
+			// geometric, mean levels / 4
+			double p ( std::min ( 1.0, 4.0 / m_parameters.levels ) );
+			uint32_t distance ( 0 );
+			while ( distance + 1 < m_parameters.levels && uniform() >= p )
+				distance++;
+			uint32_t price ( buy ? m_mid - 1 - distance : m_mid + 1 + distance );
+			appendUInt ( out, m_time );
+			out += " A ";
+			appendUInt ( out, order.id, m_parameters.id_length );
+			out += buy ? " B " : " S ";
+			appendPrice ( out, price );
+			out += ' ';
+			appendUInt ( out, order.volume );
+			out += '\n';
+		}
+
+		void FeedGenerator::appendReduce ( std::string & out )
+		{
+			assert ( !m_live.empty() );
+			size_t index ( below ( m_live.size() ) );
+			LiveOrder & order ( m_live[index] );
+			bool full ( order.volume == 1 ||
+						m_live.size() > m_parameters.orders ||
+						uniform() < m_parameters.full_reduce_ratio );
+			uint32_t volume ( full ? order.volume : 1 + below ( order.volume - 1 ) );
+			appendUInt ( out, m_time );
+			out += " R ";
+			appendUInt ( out, order.id, m_parameters.id_length );
+			out += ' ';
+			appendUInt ( out, volume );
+			out += '\n';
+			if ( full )
+			{
+				order = m_live.back();
+				m_live.pop_back();
+			}
+			else
+				order.volume -= volume;
+		}
+	}
+}
@@ -0,0 +1,87 @@
+#ifndef __FEED_GENERATOR_HPP__
+#define __FEED_GENERATOR_HPP__
+
+#include <stdint.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* Makes up a feed in the same A/R grammar pricer.in uses, the same one every time for the same seed.
+		*
+		* Adds go on either side of a mid that wanders a tick at a time, most of them close to it: the distance from
+		* the best price in ticks is geometric with a mean of a quarter of the levels, cut off at the number of levels.
+		* Reduces pick a live order at random and either take all of it or part of it. The live orders grow until
+		* there are 'orders' of them, after that every reduce takes out the whole order, so the book hovers around
+		* that size as long as there are at least as many reduces as adds ( and never gets past twice that ).
+		*
+		* Only raw numbers out of the random engine are used, no std distributions, so a feed comes out the same
+		* whatever standard library it's built with.
+		*/
+		class FeedGenerator
+		{
+		public:
+			struct Parameters
+			{
+				Parameters();
+
+				uint64_t seed;
+				uint64_t messages;
+				// live orders we grow the book to
+				uint32_t orders;
+				// how far from the best price an add can go, in ticks of 0.01
+				uint32_t levels;
+				// where the mid starts out, in ticks of 0.01
+				uint32_t mid;
+				// chance the mid moves a tick up or down, per message
+				double drift;
+				// share of the messages that are adds
+				double add_ratio;
+				// share of the reduces that take out the whole order ( before we're at 'orders' )
+				double full_reduce_ratio;
+				// order ids are a counter, padded with zeroes up to this length
+				uint32_t id_length;
+				// order sizes go up to this
+				uint32_t max_size;
+				// share of the lines that come out mangled, to keep the error handling busy
+				double error_ratio;
+			};
+
+			FeedGenerator ( Parameters const & parameters );
+
+			/* Appends the next line ( with its newline ), false once all messages are out */
+			bool next ( std::string & out );
+
+			uint64_t generated() const;
+			size_t live() const;
+		private:
+			struct LiveOrder
+			{
+				uint64_t id;
+				uint32_t volume;
+			};
+
+			Parameters m_parameters;
+			std::mt19937_64 m_rng;
+			uint64_t m_generated;
+			uint64_t m_next_id;
+			uint64_t m_time;
+			uint32_t m_mid;
+			std::vector<LiveOrder> m_live;
+
+			// [0, 1)
+			double uniform();
+			uint32_t below ( uint32_t bound );
+			uint32_t size();
+			void appendUInt ( std::string & out, uint64_t value, uint32_t width = 0 );
+			void appendPrice ( std::string & out, uint32_t ticks );
+			void appendAdd ( std::string & out );
+			void appendReduce ( std::string & out );
+		};
+	}
+}
+
+#endif
@@ -6,7 +6,9 @@
 #include <stdexcept>
 #include <cmath>
 
+#include "DecimalParser.hpp"
 #include "FeedHandler.hpp"
+#include "LatencyStats.hpp"
 
 namespace RgmInterview {
 	namespace OrderBook {
@@ -26,8 +28,30 @@ namespace RgmInterview {
 		const char FeedHandler::f_return ( '\r' );
 
 		FeedHandler::FeedHandler ( uint32_t target_size ) :
-			m_target_size ( target_size ),
-			m_book ( m_error_summary, target_size )
+			m_target_sizes ( 1, target_size ),
+			m_book ( m_error_summary, m_target_sizes ),
+			m_batch ( f_default_batch_size ),
+			m_depth_publisher ( 0 ),
+			m_memory_sampling ( 0 ),
+			m_memory_os ( 0 ),
+			m_memory_messages ( 0 ),
+			m_memory_sampled ( 0 ),
+			m_stream_sink ( std::cout ),
+			m_stream_writer ( m_stream_sink, FlushPolicy::PER_MESSAGE, 4096 )
+		{
+		}
+
+		FeedHandler::FeedHandler ( std::vector<uint32_t> const & target_sizes ) :
+			m_target_sizes ( target_sizes ),
+			m_book ( m_error_summary, m_target_sizes ),
+			m_batch ( f_default_batch_size ),
+			m_depth_publisher ( 0 ),
+			m_memory_sampling ( 0 ),
+			m_memory_os ( 0 ),
+			m_memory_messages ( 0 ),
+			m_memory_sampled ( 0 ),
+			m_stream_sink ( std::cout ),
+			m_stream_writer ( m_stream_sink, FlushPolicy::PER_MESSAGE, 4096 )
 		{
 		}
 
@@ -35,164 +59,281 @@ namespace RgmInterview {
 		{
 		}
 
-		void FeedHandler::processMessage ( const std::string &line, std::ostream &os )
+		/*
+		* The line is only ever looked at through views; the order id in the message points into it,
+		* so this works straight on top of a memory mapped file.
+		*/
+		void FeedHandler::parseMessage ( std::string_view line, Message & message )
 		{
-			try
+			message.type = MessageType::CORRUPTED;
+			message.side = OrderSide::BUY;
+			message.time = Timestamp();
+			message.price = 0;
+			message.size = 0;
+			size_t timestamp_begin ( 0 );
+			size_t timestamp_end ( line.find ( f_whitespace ) );
+			size_t action_begin ( timestamp_end + 1 );
+			size_t action_end ( line.find ( f_whitespace, action_begin ) );
+			size_t order_id_begin ( action_end + 1 );
+			size_t order_id_end ( line.find ( f_whitespace, order_id_begin ) );
+			if ( timestamp_end == std::string_view::npos ||
+					action_end != action_begin + 1 ||
+					order_id_end == std::string_view::npos ||
+					!DecimalParser::parseTimestamp ( &line[timestamp_begin], timestamp_end - timestamp_begin, message.time.value ) )
+				return;
+			message.time.digits = timestamp_end - timestamp_begin;
+			message.order_id = line.substr ( order_id_begin, order_id_end - order_id_begin );
+			switch ( line[action_begin] )
 			{
-				size_t timestamp_begin ( 0 );
-				size_t timestamp_end ( line.find ( f_whitespace ) );
-				size_t action_begin ( timestamp_end + 1 );
-				size_t action_end ( line.find ( f_whitespace, action_begin ) );
-				size_t order_id_begin ( action_end + 1 );
-				size_t order_id_end ( line.find ( f_whitespace, order_id_begin ) );
-				if ( timestamp_end != std::string::npos &&
-						action_end == action_begin + 1 &&
-						order_id_end != std::string::npos )
+			case f_add:
+			{
+				size_t side_begin ( order_id_end + 1 );
+				size_t side_end ( line.find ( f_whitespace, side_begin ) );
+				size_t price_begin ( side_end + 1 );
+				size_t price_end ( line.find ( f_whitespace, price_begin ) );
+				size_t size_begin ( price_end + 1 );
+				size_t size_end ( line.size() );
+				if ( price_end != std::string_view::npos &&
+						side_end == side_begin + 1 &&
+						( line[side_begin] == f_buy || line[side_begin] == f_sell ) &&
+						DecimalParser::parsePrice ( &line[price_begin], price_end - price_begin, message.price ) &&
+						DecimalParser::parseSize ( &line[size_begin], size_end - size_begin, message.size ) )
 				{
-					char action ( line[action_begin] );
-					std::string time ( line.substr ( timestamp_begin, timestamp_end ) );
-					switch ( action )
-					{
-					case f_add:
-					{
-						size_t side_begin ( order_id_end + 1 );
-						size_t side_end ( line.find ( f_whitespace, side_begin ) );
-						size_t price_begin ( side_end + 1 );
-						size_t price_end ( line.find ( f_whitespace, price_begin ) );
-						size_t size_begin ( price_end + 1 );
-						size_t size_end ( line.size() );
-						uint32_t size;
-						double price;
-						if ( price_end != std::string::npos &&
-								side_end == side_begin + 1 &&
-								( line[side_begin] == f_buy || line[side_begin] == f_sell ) &&
-								tryParse ( &line[price_begin], price_end - price_begin, price ) &&
-								tryParse ( &line[size_begin], size_end - size_begin, size ) )
-							processAddOrderMessage ( line.substr ( order_id_begin, order_id_end - order_id_begin ),
-													 ( line[side_begin] == f_buy ? OrderSide::BUY : OrderSide::SELL ),
-													 size,
-													 price,
-													 time,
-													 os );
-						else
-							m_error_summary.corrupted_messages++;
-						break;
-					}
-					case f_reduce:
-					{
-						uint32_t size;
-						size_t size_begin ( order_id_end + 1 );
-						size_t size_end ( line.size() );
-						if ( tryParse ( &line[size_begin], size_end - size_begin, size ) )
-							processReduceOrderMessage ( line.substr ( order_id_begin, order_id_end - order_id_begin ),
-														size,
-														time,
-														os );
-						else
-						{
-							m_error_summary.out_of_bounds_or_weird_numbers++;
-						}
-						break;
-					}
-					default:
-						m_error_summary.corrupted_messages++;
-						return;
-					}
+					message.side = ( line[side_begin] == f_buy ? OrderSide::BUY : OrderSide::SELL );
+					message.type = MessageType::ADD;
 				}
+				break;
+			}
+			case f_reduce:
+			{
+				size_t size_begin ( order_id_end + 1 );
+				size_t size_end ( line.size() );
+				if ( DecimalParser::parseSize ( &line[size_begin], size_end - size_begin, message.size ) )
+					message.type = MessageType::REDUCE;
 				else
+					message.type = MessageType::WEIRD_NUMBERS;
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		void FeedHandler::processMessage ( Message const & message, OutputWriter & out )
+		{
+			LATENCY_TIMER ( timer );
+			try
+			{
+				switch ( message.type )
 				{
+				case MessageType::ADD:
+					processAddOrderMessage ( message.order_id, message.side, message.size, message.price, message.time, out );
+					break;
+				case MessageType::REDUCE:
+					processReduceOrderMessage ( message.order_id, message.size, message.time, out );
+					break;
+				case MessageType::WEIRD_NUMBERS:
+					m_error_summary.out_of_bounds_or_weird_numbers++;
+					break;
+				case MessageType::CORRUPTED:
 					m_error_summary.corrupted_messages++;
-					return;
+					break;
 				}
 			} catch ( std::runtime_error & )
 			{
 				// ouch - I really shouldn't get here
 				m_error_summary.unexpected_exception++;
 			}
+			out.endMessage();
+			LATENCY_COUNT ( LatencyStats::MESSAGES );
+			LATENCY_LAP ( message.type == MessageType::ADD ? LatencyStats::PROCESS_ADD :
+						  message.type == MessageType::REDUCE ? LatencyStats::PROCESS_REDUCE : LatencyStats::PROCESS_ERROR, timer );
+		}
+
+		void FeedHandler::processMessage ( std::string_view line, OutputWriter & out )
+		{
+			LATENCY_TIMER ( timer );
+			Message message;
+			parseMessage ( line, message );
+			LATENCY_LAP ( LatencyStats::PARSE, timer );
+			processMessage ( message, out );
+			if ( m_depth_publisher )
+			{
+				if ( message.type == MessageType::ADD || message.type == MessageType::REDUCE )
+					m_depth.time = message.time;
+				publishDepth();
+			}
+			if ( m_memory_sampling )
+				sampleMemory ( 1 );
+		}
+
+		void FeedHandler::processMessage ( std::string_view line, std::ostream &os )
+		{
+			m_stream_sink.reset ( os );
+			processMessage ( line, m_stream_writer );
+			m_stream_writer.flush();
+		}
+
+		void FeedHandler::processBatch ( Message const * messages, size_t count, OutputWriter & out )
+		{
+			if ( count > 1 )
+				m_book.prefetch ( messages, count );
+			for ( size_t i = 0; i < count; i++ )
+				processMessage ( messages[i], out );
+			if ( m_depth_publisher && count > 0 )
+			{
+				for ( size_t i = count; i-- > 0; )
+					if ( messages[i].type == MessageType::ADD || messages[i].type == MessageType::REDUCE )
+					{
+						m_depth.time = messages[i].time;
+						break;
+					}
+				publishDepth();
+			}
+			if ( m_memory_sampling )
+				sampleMemory ( count );
+		}
+
+		void FeedHandler::publishDepth()
+		{
+			m_book.depth ( m_depth );
+			m_depth_publisher->publish ( m_depth );
+		}
+
+		void FeedHandler::sampleMemory ( size_t messages )
+		{
+			m_memory_messages += messages;
+			if ( m_memory_messages - m_memory_sampled < m_memory_sampling )
+				return;
+			m_memory_sampled = m_memory_messages;
+			MemoryStats stats ( memoryStats() );
+			MemoryUsage total ( stats.total() );
+			*m_memory_os << "[ MEMORY] After " << m_memory_messages << " messages: " << stats.orders << " orders, "
+						 << stats.levels << " levels, " << total.bytes << " bytes ( " << total.live << " live )" << std::endl;
+		}
+
+		/*
+		* Process every complete line in the buffer, returns the number of bytes consumed.
+		* Whatever is left after the last newline is up to the caller.
+		*/
+		size_t FeedHandler::processLines ( std::string_view buffer, OutputWriter & out )
+		{
+			size_t line_begin ( 0 );
+			size_t line_end ( buffer.find ( '\n' ) );
+			size_t batched ( 0 );
+			while ( line_end != std::string_view::npos )
+			{
+				LATENCY_TIMER ( timer );
+				parseMessage ( buffer.substr ( line_begin, line_end - line_begin ), m_batch[batched] );
+				LATENCY_LAP ( LatencyStats::PARSE, timer );
+				if ( ++batched == m_batch.size() )
+				{
+					processBatch ( m_batch.data(), batched, out );
+					batched = 0;
+				}
+				line_begin = line_end + 1;
+				line_end = buffer.find ( '\n', line_begin );
+			}
+			processBatch ( m_batch.data(), batched, out );
+			out.endBatch();
+			return line_begin;
+		}
+
+		size_t FeedHandler::processLines ( std::string_view buffer, std::ostream &os )
+		{
+			m_stream_sink.reset ( os );
+			size_t consumed ( processLines ( buffer, m_stream_writer ) );
+			m_stream_writer.flush();
+			return consumed;
 		}
 
-		void FeedHandler::processAddOrderMessage ( std::string const & order_id,
+		void FeedHandler::processAddOrderMessage ( std::string_view order_id,
 				OrderSide::Side side,
 				uint32_t size,
-				double price,
-				std::string const & time,
-				std::ostream & os )
+				uint32_t price,
+				Timestamp time,
+				OutputWriter & out )
 		{
-			Order_ptr order ( new Order  (
-								  side,
-								  size,
-								  static_cast < uint32_t > ( std::floor ( price * Constants::round_size ) ) ) );
-			// if we can't add this order, we have to dispose it ourselves
-			if ( !m_book.add ( order, order_id, side, time, os ) )
-				delete ( order );
+			// the feed's numbers, in the book's units; digits the book doesn't keep are cut off
+			OrderBook::Price book_price;
+			OrderBook::Volume book_size;
+			if ( !BookFixedPoint::fromFeedPrice ( price, book_price ) || !BookFixedPoint::fromFeedVolume ( size, book_size ) )
+			{
+				m_error_summary.out_of_bounds_or_weird_numbers++;
+				return;
+			}
+			m_book.add ( Order ( side, book_size, book_price ), order_id, time, out );
 		}
 
-		void FeedHandler::processReduceOrderMessage ( std::string const & order_id,
+		void FeedHandler::processReduceOrderMessage ( std::string_view order_id,
 				uint32_t size,
-				std::string const & time,
-				std::ostream & os )
+				Timestamp time,
+				OutputWriter & out )
 		{
+			// taking out more than the book can hold takes out everything
 			m_book.reduce ( order_id,
-							size,
+							static_cast < OrderBook::Volume > ( std::min<uint64_t> ( size, std::numeric_limits<OrderBook::Volume>::max() ) ),
 							time,
-							os );
+							out );
 		}
 
-		void FeedHandler::printErrorSummary ( std::ostream & os ) const
+		void FeedHandler::setBatchSize ( size_t batch_size )
 		{
-			os << "Errors:" << std::endl;
-			os << m_error_summary;
+			m_batch.resize ( std::max<size_t> ( 1, batch_size ) );
 		}
 
-		OrderBook const & FeedHandler::book() const
+		size_t FeedHandler::batchSize() const
 		{
-			return m_book;
+			return m_batch.size();
 		}
 
-		ErrorSummary const & FeedHandler::errors() const
+		void FeedHandler::setDepthPublisher ( DepthPublisher * publisher )
 		{
-			return m_error_summary;
+			assert ( !publisher || publisher->targets() == m_target_sizes.size() );
+			m_depth_publisher = publisher;
+			if ( publisher )
+				m_depth = BookDepth ( publisher->depth(), publisher->targets() );
 		}
 
-		bool FeedHandler::tryParse ( const char * input, size_t len, double & out )
+		void FeedHandler::setMemorySampling ( size_t messages, std::ostream * os )
 		{
-			char* endptr;
-			out = strtod ( input, &endptr );
-			// success if we processed exactly the number of characters we expected
-			return ( endptr == input + len && out > 0 );
+			assert ( !messages || os );
+			m_memory_sampling = messages;
+			m_memory_os = os;
+			m_memory_messages = 0;
+			m_memory_sampled = 0;
 		}
 
-		bool FeedHandler::tryParse ( const char * input, size_t len, uint32_t & out )
+		MemoryStats FeedHandler::memoryStats() const
 		{
-			char * endptr;
-			out = strtoul ( input, &endptr, 10 );
-			// success if we processed exactly the number of characters we expected and there's no '-' in there
-			return ( std::find ( input, input + len, '-' ) == input + len &&
-					 endptr == input + len &&
-					 ( len < 10 || !isUIntOverflow ( input, len ) ) );
+			MemoryStats stats ( m_book.memoryStats() );
+			size_t bytes ( m_batch.capacity() * sizeof ( Message ) );
+			for ( size_t side = 0; side < 2; side++ )
+				bytes += m_depth.levels[side].capacity() * sizeof ( DepthLevel ) + m_depth.costs[side].capacity() * sizeof ( uint64_t );
+			stats.buffers = MemoryUsage ( bytes, bytes );
+			return stats;
 		}
 
-		/*
-		* A not so quick check to see if the value's bigger than uint32_t::max
-		*/
-		bool FeedHandler::isUIntOverflow ( const char * input, size_t len )
+		void FeedHandler::printErrorSummary ( std::ostream & os ) const
 		{
-			static const char * max_size ( "4294967295" );
-			if ( len <= 10 )
-			{
-				for ( size_t i = 0; i < len && input[i] >= max_size[i] ; i++ )
-				{
-					if ( input[i] > max_size[i] )
-						return true;
-				}
-				return false;
-			}
-			return true;
+			os << "Errors:" << std::endl;
+			os << m_error_summary;
 		}
 
-		CE double FeedHandler::maxPrice()
+		void FeedHandler::printMemorySummary ( std::ostream & os ) const
 		{
-			return std::floor ( std::numeric_limits<uint32_t>::max() / Constants::round_size );
+			os << "Memory:" << std::endl;
+			os << memoryStats();
+		}
+
+		OrderBook const & FeedHandler::book() const
+		{
+			return m_book;
+		}
+
+		ErrorSummary const & FeedHandler::errors() const
+		{
+			return m_error_summary;
 		}
 	}
 }
@@ -1,16 +1,17 @@
 #ifndef __FEED_HANDLER_HPP
 #define __FEED_HANDLER_HPP
 
-#ifdef _WIN32
-#define CE
-#else
-#define CE constexpr
-#endif
+#include <string_view>
+#include <vector>
 
 #include "Constants.hpp"
+#include "DepthPublisher.hpp"
 #include "Order.hpp"
 #include "OrderBook.hpp"
 #include "ErrorSummary.hpp"
+#include "MemoryStats.hpp"
+#include "Message.hpp"
+#include "OutputWriter.hpp"
 
 namespace RgmInterview {
 	namespace OrderBook {
@@ -18,13 +19,48 @@ namespace RgmInterview {
 		class FeedHandler
 		{
 		public:
+			static const size_t f_default_batch_size = 32;
+
 			FeedHandler ( uint32_t target_size );
+			FeedHandler ( std::vector<uint32_t> const & target_sizes );
 			~FeedHandler();
-			void processMessage ( const std::string &line, std::ostream &os );
+			/* Takes a line apart without touching the book, anything that doesn't parse comes back as an error type */
+			static void parseMessage ( std::string_view line, Message & message );
+			/* Hands a parsed message to the book, or counts it as an error */
+			void processMessage ( Message const & message, OutputWriter & out );
+			void processMessage ( std::string_view line, OutputWriter & out );
+			/*
+			* Same as processMessage on every one of them in order, but whatever they're going to touch in the book is
+			* prefetched first, so the cache misses of the whole batch overlap instead of coming one after the other
+			*/
+			void processBatch ( Message const * messages, size_t count, OutputWriter & out );
+			/* Parses batchSize() lines at a time and hands them to processBatch */
+			size_t processLines ( std::string_view buffer, OutputWriter & out );
+			/* Same, with whatever they print flushed to os before we return */
+			void processMessage ( std::string_view line, std::ostream &os );
+			size_t processLines ( std::string_view buffer, std::ostream &os );
+			/* 1 handles every line on its own, without prefetching */
+			void setBatchSize ( size_t batch_size );
+			size_t batchSize() const;
+			/*
+			* After every batch ( and every message handled on its own ) the top of the book goes to publisher, for other
+			* threads to read. It has to be sized for our target sizes and outlive us, 0 stops it.
+			*/
+			void setDepthPublisher ( DepthPublisher * publisher );
+			/*
+			* Every messages messages ( counted in whole batches ) a line with how much the book holds goes to os,
+			* 0 stops it. os has to outlive us.
+			*/
+			void setMemorySampling ( size_t messages, std::ostream * os );
+			/* The book's, plus our own buffers */
+			MemoryStats memoryStats() const;
 			void printErrorSummary ( std::ostream & os ) const;
+			void printMemorySummary ( std::ostream & os ) const;
 			OrderBook const & book() const;
 			ErrorSummary const & errors() const;
 		private:
+			friend class Snapshot;
+
 			static const char f_add ;
 			static const char f_reduce;
 
@@ -33,29 +69,39 @@ namespace RgmInterview {
 			static const char f_whitespace;
 
 			static const char f_return;
-			FeedHandler ( FeedHandler const & rhs ) : m_book ( m_error_summary, rhs.m_target_size ) {}
+			FeedHandler ( FeedHandler const & rhs );
+			FeedHandler & operator= ( FeedHandler const & rhs );
 
-			void processAddOrderMessage ( std::string const & order_id,
+			void processAddOrderMessage ( std::string_view order_id,
 										  OrderSide::Side side,
 										  uint32_t size,
-										  double price,
-										  std::string const & time,
-										  std::ostream & os );
+										  uint32_t price,
+										  Timestamp time,
+										  OutputWriter & out );
 
-			void processReduceOrderMessage ( std::string const & order_id,
+			void processReduceOrderMessage ( std::string_view order_id,
 											 uint32_t size,
-											 std::string const & time,
-											 std::ostream & os );
-
-			static bool tryParse ( const char * input, size_t len, double & out );
-			static bool tryParse ( const char * input, size_t len, uint32_t & out );
-			static bool isUIntOverflow ( const char * input, size_t len );
+											 Timestamp time,
+											 OutputWriter & out );
 
-			static CE double maxPrice();
+			void publishDepth();
+			void sampleMemory ( size_t messages );
 
 			ErrorSummary m_error_summary;
-			uint32_t m_target_size;
+			std::vector<uint32_t> m_target_sizes;
 			OrderBook m_book;
+			std::vector<Message> m_batch;
+			DepthPublisher * m_depth_publisher;
+			// what we fill in and hand to the publisher, time is the last message that wasn't broken
+			BookDepth m_depth;
+			size_t m_memory_sampling;
+			std::ostream * m_memory_os;
+			// handled since sampling started, and when we last sampled
+			size_t m_memory_messages;
+			size_t m_memory_sampled;
+			// for the ostream flavours
+			StreamSink m_stream_sink;
+			OutputWriter m_stream_writer;
 		};
 	}
 }
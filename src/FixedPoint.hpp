@@ -0,0 +1,90 @@
+#ifndef __FIXED_POINT_HPP__
+#define __FIXED_POINT_HPP__
+
+#include <stdint.h>
+#include <limits>
+#include <type_traits>
+
+#include "Constants.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* How the book holds its numbers: prices in ticks of 1/10^Decimals as Price, volumes ( an order's, a level's
+		* and a whole side's ) as Volume, and costs ( price times volume, added up ) as Value.
+		*
+		* The feed comes in, and costs go out, in ticks of 1/Constants::round_size. A book can hold coarser ticks than that,
+		* digits it doesn't have room for get cut off on the way in, the way the parser cuts off the ones it doesn't have.
+		* Everything here is known at compile time, a book in the feed's ticks doesn't convert anything at all.
+		*
+		* Value has to hold the biggest cost we're going to print: 10000 shares at $500 is 5e9 ticks of 0.001, too much
+		* for 32 bits. Volume has to hold what a side adds up to, and the target sizes.
+		*/
+		template <uint32_t Decimals, class Price, class Volume, class Value>
+		struct FixedPoint
+		{
+			static_assert ( std::is_unsigned<Price>::value && std::is_unsigned<Volume>::value && std::is_unsigned<Value>::value,
+							"prices, volumes and costs are never negative" );
+			static_assert ( sizeof ( Value ) >= sizeof ( Price ) && sizeof ( Value ) >= sizeof ( Volume ), "a cost is at least a price" );
+			static_assert ( Decimals <= Constants::round_decimals, "can't have finer ticks than the feed" );
+
+			typedef Price price_type;
+			typedef Volume volume_type;
+			typedef Value value_type;
+
+			static constexpr uint32_t decimals = Decimals;
+			// what one of our ticks is in the feed's
+			static constexpr uint32_t feed_ticks = Constants::pow10 ( Constants::round_decimals - Decimals );
+			// a cost when there's not enough volume
+			static constexpr Value unknown = std::numeric_limits<Value>::max();
+
+			static Value cost ( Price price, Volume volume )
+			{
+				return static_cast < Value > ( price ) * volume;
+			}
+
+			/* From the feed's ticks, false if it doesn't fit or cutting it down left nothing of it. A price of 0 stays 0, same as before */
+			static bool fromFeedPrice ( uint32_t feed_price, Price & price )
+			{
+				uint32_t ticks ( feed_price / feed_ticks );
+				if ( ( ticks == 0 && feed_price != 0 ) || ticks > std::numeric_limits<Price>::max() )
+					return false;
+				price = static_cast < Price > ( ticks );
+				return true;
+			}
+
+			static bool fromFeedVolume ( uint32_t feed_volume, Volume & volume )
+			{
+				if ( feed_volume > std::numeric_limits<Volume>::max() )
+					return false;
+				volume = static_cast < Volume > ( feed_volume );
+				return true;
+			}
+
+			static uint64_t toFeedPrice ( Price price )
+			{
+				return static_cast < uint64_t > ( price ) * feed_ticks;
+			}
+
+			/* In the feed's ticks, for printing */
+			static uint64_t toFeedValue ( Value value )
+			{
+				return static_cast < uint64_t > ( value ) * feed_ticks;
+			}
+		};
+
+		// costs of anything we're going to see, in the feed's own ticks
+		typedef FixedPoint < Constants::round_decimals, uint32_t, uint32_t, uint64_t > WideFixedPoint;
+		// cents, and costs that fit in 32 bits ( up to $42.9M )
+		typedef FixedPoint < 2, uint32_t, uint32_t, uint32_t > NarrowFixedPoint;
+
+#ifdef NARROW_FIXED_POINT
+		typedef NarrowFixedPoint BookFixedPoint;
+#else
+		typedef WideFixedPoint BookFixedPoint;
+#endif
+	}
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+#include <string>
+
+#include "DecimalParser.hpp"
+#include "FeedGenerator.hpp"
+
+using namespace RgmInterview::OrderBook;
+
+static void usage()
+{
+	FeedGenerator::Parameters defaults;
+	char mid[32];
+	snprintf ( mid, sizeof ( mid ), "%u.%02u", defaults.mid / 100, defaults.mid % 100 );
+	std::cerr << "Usage: generator [options] > feed" << std::endl;
+	std::cerr << "  -n  messages ( " << defaults.messages << " )" << std::endl;
+	std::cerr << "  -s  seed, the same seed and options always give the same feed ( " << defaults.seed << " )" << std::endl;
+	std::cerr << "  -o  live orders to grow the book to ( " << defaults.orders << " )" << std::endl;
+	std::cerr << "  -l  levels, how far from the best price an add can go in ticks of 0.01 ( " << defaults.levels << " )" << std::endl;
+	std::cerr << "  -m  price the mid starts out at ( " << mid << " )" << std::endl;
+	std::cerr << "  -d  chance the mid moves a tick, per message ( " << defaults.drift << " )" << std::endl;
+	std::cerr << "  -a  share of the messages that are adds ( " << defaults.add_ratio << " )" << std::endl;
+	std::cerr << "  -r  share of the reduces that take out the whole order ( " << defaults.full_reduce_ratio << " )" << std::endl;
+	std::cerr << "  -i  pad order ids with zeroes up to this length ( " << defaults.id_length << " )" << std::endl;
+	std::cerr << "  -z  largest order size ( " << defaults.max_size << " )" << std::endl;
+	std::cerr << "  -e  share of the lines that come out mangled ( " << defaults.error_ratio << " )" << std::endl;
+}
+
+static bool parseRatio ( const char * input, double & out )
+{
+	char * end;
+	out = strtod ( input, &end );
+	return *input && !*end && out >= 0 && out <= 1;
+}
+
+int main ( int argc, char **argv )
+{
+	FeedGenerator::Parameters parameters;
+	int opt;
+	bool ok ( true );
+	while ( ok && ( opt = getopt ( argc, argv, "n:s:o:l:m:d:a:r:i:z:e:" ) ) != -1 )
+	{
+		switch ( opt )
+		{
+		case 'n':
+			parameters.messages = strtoull ( optarg, 0, 10 );
+			break;
+		case 's':
+			parameters.seed = strtoull ( optarg, 0, 10 );
+			break;
+		case 'o':
+			parameters.orders = atoi ( optarg );
+			ok = parameters.orders > 0;
+			break;
+		case 'l':
+			parameters.levels = atoi ( optarg );
+			ok = parameters.levels > 0;
+			break;
+		case 'm':
+		{
+			uint32_t ticks ( 0 );
+			ok = DecimalParser::parsePrice ( optarg, strlen ( optarg ), ticks );
+			// the parser's ticks are 1/Constants::round_size, ours are cents
+			parameters.mid = ticks / ( static_cast < uint32_t > ( Constants::round_size ) / 100 );
+			break;
+		}
+		case 'd':
+			ok = parseRatio ( optarg, parameters.drift );
+			break;
+		case 'a':
+			ok = parseRatio ( optarg, parameters.add_ratio );
+			break;
+		case 'r':
+			ok = parseRatio ( optarg, parameters.full_reduce_ratio );
+			break;
+		case 'i':
+			parameters.id_length = atoi ( optarg );
+			break;
+		case 'z':
+			parameters.max_size = atoi ( optarg );
+			ok = parameters.max_size > 0;
+			break;
+		case 'e':
+			ok = parseRatio ( optarg, parameters.error_ratio );
+			break;
+		default:
+			ok = false;
+		}
+	}
+	if ( !ok || optind != argc )
+	{
+		usage();
+		return 1;
+	}
+	FeedGenerator generator ( parameters );
+	std::string buffer;
+	buffer.reserve ( 1 << 20 );
+	while ( generator.next ( buffer ) )
+	{
+		if ( buffer.size() >= ( 1 << 20 ) - 128 )
+		{
+			if ( fwrite ( buffer.data(), 1, buffer.size(), stdout ) != buffer.size() )
+				return 1;
+			buffer.clear();
+		}
+	}
+	if ( fwrite ( buffer.data(), 1, buffer.size(), stdout ) != buffer.size() || fflush ( stdout ) != 0 )
+		return 1;
+	return 0;
+}
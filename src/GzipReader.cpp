@@ -0,0 +1,161 @@
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "GzipReader.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		GzipReader::GzipReader ( std::string const & path, size_t buffers, size_t buffer_bytes ) :
+			m_file ( path ),
+			m_buffer_bytes ( buffer_bytes ),
+			m_data ( buffers * buffer_bytes ),
+			m_sizes ( buffers ),
+			m_filled ( 0 ),
+			m_released ( 0 ),
+			m_done ( false ),
+			m_stop ( false )
+		{
+			if ( buffers == 0 || buffer_bytes == 0 )
+				throw std::runtime_error ( "Need somewhere to decompress " + path + " to" );
+			m_thread = std::thread ( &GzipReader::run, this );
+		}
+
+		GzipReader::~GzipReader()
+		{
+			m_stop.store ( true, std::memory_order_release );
+			m_thread.join();
+		}
+
+		bool GzipReader::isGzip ( std::string const & path )
+		{
+			int fd ( open ( path.c_str(), O_RDONLY ) );
+			if ( fd < 0 )
+				throw std::runtime_error ( "Unable to open " + path );
+			unsigned char magic[2];
+			bool gzip ( read ( fd, magic, sizeof ( magic ) ) == sizeof ( magic ) && magic[0] == 0x1f && magic[1] == 0x8b );
+			close ( fd );
+			return gzip;
+		}
+
+		bool GzipReader::next ( std::string_view & data )
+		{
+			size_t n ( m_released.load ( std::memory_order_relaxed ) );
+			for ( size_t idle = 0; m_filled.load ( std::memory_order_acquire ) == n; idle++ )
+			{
+				// everything it filled before it was done is still ours to read
+				if ( m_done.load ( std::memory_order_acquire ) && m_filled.load ( std::memory_order_acquire ) == n )
+				{
+					if ( !m_error.empty() )
+						throw std::runtime_error ( m_error );
+					return false;
+				}
+				if ( idle > 64 )
+					std::this_thread::yield();
+			}
+			data = std::string_view ( buffer ( n ), m_sizes[n % m_sizes.size()] );
+			return true;
+		}
+
+		void GzipReader::release()
+		{
+			m_released.store ( m_released.load ( std::memory_order_relaxed ) + 1, std::memory_order_release );
+		}
+
+		char * GzipReader::buffer ( size_t n )
+		{
+			return &m_data[ ( n % m_sizes.size() ) * m_buffer_bytes];
+		}
+
+		void GzipReader::run()
+		{
+			try
+			{
+				inflateAll();
+			} catch ( std::exception & ex )
+			{
+				m_error = ex.what();
+			}
+			m_done.store ( true, std::memory_order_release );
+		}
+
+		/*
+		* A buffer at a time, for as long as the stream goes. A file can be several gzip streams one after the other
+		* ( that's what cat a.gz b.gz makes ), each one picks up where the last one ended. Zeros after the last one
+		* are padding ( tape and block tools leave that ), like gzip -d we stop there. Anything else that isn't
+		* another stream is an error that says where it starts.
+		*/
+		void GzipReader::inflateAll()
+		{
+			z_stream stream;
+			memset ( &stream, 0, sizeof ( stream ) );
+			// 32 on top of the window bits takes a gzip header as well as a zlib one
+			if ( inflateInit2 ( &stream, 15 + 32 ) != Z_OK )
+				throw std::runtime_error ( "Unable to start inflating" );
+			const char * input ( m_file.data() );
+			size_t input_left ( m_file.size() );
+			bool ended ( false );
+			// what went wrong, it's thrown once what came before it is out
+			std::string error;
+			// whoever reads stops us by going away
+			for ( size_t n = 0; !ended && !m_stop.load ( std::memory_order_acquire ); )
+			{
+				for ( size_t idle = 0; n - m_released.load ( std::memory_order_acquire ) == m_sizes.size(); idle++ )
+				{
+					if ( m_stop.load ( std::memory_order_acquire ) )
+					{
+						inflateEnd ( &stream );
+						return;
+					}
+					if ( idle > 64 )
+						std::this_thread::yield();
+				}
+				stream.next_out = reinterpret_cast < Bytef * > ( buffer ( n ) );
+				stream.avail_out = m_buffer_bytes;
+				while ( stream.avail_out > 0 && !ended )
+				{
+					if ( stream.avail_in == 0 && input_left > 0 )
+					{
+						size_t chunk ( std::min ( input_left, f_input_bytes ) );
+						stream.next_in = reinterpret_cast < Bytef * > ( const_cast < char * > ( input ) );
+						stream.avail_in = chunk;
+						input += chunk;
+						input_left -= chunk;
+					}
+					int result ( inflate ( &stream, Z_NO_FLUSH ) );
+					// the input is all mapped, whatever inflate didn't take yet runs to the end of the file
+					const char * rest ( reinterpret_cast < const char * > ( stream.next_in ) );
+					size_t offset ( rest - m_file.data() );
+					if ( result == Z_STREAM_END )
+					{
+						size_t left ( m_file.size() - offset );
+						ended = std::all_of ( rest, rest + left, [] ( char c ) { return c == 0; } );
+						if ( !ended && ( left < 2 || static_cast < unsigned char > ( rest[0] ) != 0x1f ||
+										 static_cast < unsigned char > ( rest[1] ) != 0x8b ) )
+							error = "Trailing garbage in gzip input at byte " + std::to_string ( offset );
+						else if ( !ended )
+							inflateReset ( &stream );
+					}
+					else if ( result != Z_OK )
+						error = ( result == Z_BUF_ERROR ? "Gzip input ends too early at byte " : "Broken gzip input at byte " ) +
+								std::to_string ( offset );
+					ended = ended || !error.empty();
+				}
+				size_t filled ( m_buffer_bytes - stream.avail_out );
+				if ( filled > 0 )
+				{
+					m_sizes[n % m_sizes.size()] = filled;
+					m_filled.store ( ++n, std::memory_order_release );
+				}
+			}
+			inflateEnd ( &stream );
+			if ( !error.empty() )
+				throw std::runtime_error ( error );
+		}
+	}
+}
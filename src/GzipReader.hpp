@@ -0,0 +1,128 @@
+#ifndef __GZIP_READER_HPP__
+#define __GZIP_READER_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "MappedFile.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* A gzipped feed, decompressed on a thread of our own into a ring of big buffers that the caller parses
+		* right where they are.
+		*
+		* The compressed file is mapped and inflated a buffer at a time. The decompressor only ever waits when every
+		* buffer is full and nobody has given one back yet; the caller only when it's through everything that's been
+		* decompressed so far. Either side spins a little before it gives up the core, like the Pipeline.
+		* Only a line that runs from one buffer into the next gets copied.
+		*/
+		class GzipReader
+		{
+		public:
+			static const size_t f_default_buffers = 8;
+			static const size_t f_default_buffer_bytes = 1024 * 1024;
+
+			GzipReader ( std::string const & path,
+						 size_t buffers = f_default_buffers,
+						 size_t buffer_bytes = f_default_buffer_bytes );
+			~GzipReader();
+
+			/* Whether the file starts like a gzip stream */
+			static bool isGzip ( std::string const & path );
+
+			/*
+			* The next buffer of decompressed text, false once there's no more. It stays put until release().
+			* Throws if the file turns out to be broken.
+			*/
+			bool next ( std::string_view & data );
+			void release();
+
+			/*
+			* Every line from offset ( in decompressed bytes ) on goes to lines, with the same calls as processMappedFile
+			* makes: processLines for every buffer, processMessage for a last line without a newline. Returns the
+			* decompressed size.
+			*/
+			template <class Lines>
+			uint64_t replay ( Lines & lines, uint64_t offset )
+			{
+				return replay ( lines, offset, [] ( std::string_view ) {} );
+			}
+
+			/* Same thing, and whatever comes before offset goes to skipped, in order */
+			template <class Lines, class Skipped>
+			uint64_t replay ( Lines & lines, uint64_t offset, Skipped skipped )
+			{
+				uint64_t position ( 0 );
+				// a line that started in an earlier buffer
+				std::string carry;
+				std::string_view data;
+				for ( ; next ( data ); release() )
+				{
+					position += data.size();
+					if ( position <= offset )
+					{
+						skipped ( data );
+						continue;
+					}
+					if ( position - data.size() < offset )
+					{
+						skipped ( data.substr ( 0, data.size() - ( position - offset ) ) );
+						data = data.substr ( data.size() - ( position - offset ) );
+					}
+					if ( !carry.empty() )
+					{
+						size_t end ( data.find ( '\n' ) );
+						carry.append ( data.substr ( 0, end == std::string_view::npos ? data.size() : end + 1 ) );
+						if ( end == std::string_view::npos )
+							continue;
+						lines.processLines ( carry );
+						carry.clear();
+						data = data.substr ( end + 1 );
+					}
+					carry.assign ( data.substr ( lines.processLines ( data ) ) );
+				}
+				if ( position < offset )
+					throw std::runtime_error ( "Snapshot is past the end of the input" );
+				// last line without a newline
+				if ( !carry.empty() )
+					lines.processMessage ( carry );
+				return position;
+			}
+		private:
+			static const size_t f_cache_line = 64;
+			// compressed bytes inflate gets at a time, so it isn't handed more than its counters hold
+			static constexpr size_t f_input_bytes = 1024 * 1024 * 1024;
+
+			GzipReader ( GzipReader const & rhs );
+			GzipReader & operator= ( GzipReader const & rhs );
+
+			MappedFile m_file;
+			size_t m_buffer_bytes;
+			std::vector<char> m_data;
+			// how much of each buffer the decompressor filled
+			std::vector<size_t> m_sizes;
+			// buffers filled and given back so far, buffer n is n % count
+			alignas ( f_cache_line ) std::atomic<size_t> m_filled;
+			alignas ( f_cache_line ) std::atomic<size_t> m_released;
+			// the decompressor got to the end ( and if it was broken, why )
+			std::atomic<bool> m_done;
+			std::string m_error;
+			std::atomic<bool> m_stop;
+			std::thread m_thread;
+
+			void run();
+			void inflateAll();
+			char * buffer ( size_t n );
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,322 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "FeedGenerator.hpp"
+#include "MappedFile.hpp"
+
+using namespace RgmInterview::OrderBook;
+
+/*
+* End to end throughput of pricer builds: every build runs every generated feed for every target size a few times,
+* we keep the median. One comma separated line per build, feed and target size goes to stdout:
+* build,feed,target_size,messages,median_ms,messages_per_sec,peak_rss_kb,checksum,baseline_messages_per_sec,change
+*
+* The checksum is of everything the pricer printed. It has to be the same on every run and for every build, and
+* the same as the baseline's. Against a baseline, a build that got slower by more than the threshold fails us too.
+* A baseline is just this output ( written with -w ) for the same machine.
+*/
+namespace {
+
+	struct Feed
+	{
+		std::string name;
+		FeedGenerator::Parameters parameters;
+	};
+
+	struct Build
+	{
+		std::string name;
+		std::string pricer;
+	};
+
+	struct Result
+	{
+		double median_ms;
+		double messages_per_sec;
+		long peak_rss_kb;
+		std::string checksum;
+	};
+
+	const uint32_t g_target_sizes[] = { 1, 200, 10000 };
+
+	/* A book that stays small, one that's deep and wide, and one that keeps the error handling busy */
+	std::vector<Feed> feeds ( uint64_t messages )
+	{
+		std::vector<Feed> feeds ( 3 );
+		feeds[0].name = "shallow";
+		feeds[0].parameters.orders = 1000;
+		feeds[0].parameters.levels = 20;
+		feeds[1].name = "deep";
+		feeds[1].parameters.orders = 100000;
+		feeds[1].parameters.levels = 2000;
+		feeds[2].name = "errors";
+		feeds[2].parameters.orders = 10000;
+		feeds[2].parameters.levels = 200;
+		feeds[2].parameters.error_ratio = 0.01;
+		for ( Feed & feed : feeds )
+			feed.parameters.messages = messages;
+		return feeds;
+	}
+
+	/* The same seed and parameters always make the same feed, so one that's there already is kept */
+	std::string feedPath ( std::string const & directory, Feed const & feed )
+	{
+		std::string path ( directory + "/throughput." + feed.name + "." + std::to_string ( feed.parameters.messages ) + ".in" );
+		struct stat st;
+		if ( stat ( path.c_str(), &st ) == 0 )
+			return path;
+		std::string tmp ( path + ".tmp" );
+		FILE * out ( fopen ( tmp.c_str(), "w" ) );
+		if ( !out )
+			throw std::runtime_error ( "Unable to write " + tmp );
+		FeedGenerator generator ( feed.parameters );
+		std::string buffer;
+		bool more ( true );
+		while ( more )
+		{
+			more = generator.next ( buffer );
+			if ( buffer.size() >= ( 1 << 20 ) || !more )
+			{
+				if ( fwrite ( buffer.data(), 1, buffer.size(), out ) != buffer.size() )
+				{
+					fclose ( out );
+					throw std::runtime_error ( "Unable to write " + tmp );
+				}
+				buffer.clear();
+			}
+		}
+		if ( fclose ( out ) != 0 || rename ( tmp.c_str(), path.c_str() ) != 0 )
+			throw std::runtime_error ( "Unable to write " + path );
+		return path;
+	}
+
+	/* FNV-1a, plenty to tell two outputs apart */
+	std::string checksum ( std::string const & path )
+	{
+		MappedFile file ( path );
+		uint64_t hash ( 0xcbf29ce484222325ULL );
+		for ( size_t i = 0; i < file.size(); i++ )
+		{
+			hash ^= static_cast < unsigned char > ( file.data() [i] );
+			hash *= 0x100000001b3ULL;
+		}
+		char hex[17];
+		snprintf ( hex, sizeof ( hex ), "%016llx", static_cast < unsigned long long > ( hash ) );
+		return hex;
+	}
+
+	/* One run of pricer -i feed target_size with its output in output, returns the wall time in ms */
+	double run ( std::string const & pricer, std::string const & feed, uint32_t target_size, std::string const & output, long & peak_rss_kb )
+	{
+		std::string target ( std::to_string ( target_size ) );
+		std::chrono::steady_clock::time_point start ( std::chrono::steady_clock::now() );
+		pid_t pid ( fork() );
+		if ( pid < 0 )
+			throw std::runtime_error ( "Unable to fork" );
+		if ( pid == 0 )
+		{
+			int fd ( open ( output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 ) );
+			if ( fd < 0 || dup2 ( fd, STDOUT_FILENO ) < 0 )
+				_exit ( 127 );
+			close ( fd );
+			execl ( pricer.c_str(), pricer.c_str(), "-i", feed.c_str(), target.c_str(), static_cast < char * > ( 0 ) );
+			_exit ( 127 );
+		}
+		int status;
+		struct rusage usage;
+		if ( wait4 ( pid, &status, 0, &usage ) != pid )
+			throw std::runtime_error ( "Lost " + pricer );
+		double ms ( std::chrono::duration<double, std::milli> ( std::chrono::steady_clock::now() - start ).count() );
+		// pricer exits with 0 or 1 depending on whether the feed had errors, anything else it didn't get through
+		if ( !WIFEXITED ( status ) || WEXITSTATUS ( status ) > 1 )
+			throw std::runtime_error ( pricer + " didn't get through " + feed );
+		peak_rss_kb = usage.ru_maxrss;
+		return ms;
+	}
+
+	/* Baseline lines by build, feed and target size */
+	std::map<std::string, std::vector<std::string> > readBaseline ( std::string const & path )
+	{
+		std::map<std::string, std::vector<std::string> > baseline;
+		std::ifstream in ( path.c_str() );
+		if ( !in )
+			throw std::runtime_error ( "Unable to read " + path );
+		std::string line;
+		while ( std::getline ( in, line ) )
+		{
+			std::vector<std::string> fields;
+			std::istringstream columns ( line );
+			std::string field;
+			while ( std::getline ( columns, field, ',' ) )
+				fields.push_back ( field );
+			if ( fields.size() < 8 || fields[0] == "build" )
+				continue;
+			baseline[fields[0] + "," + fields[1] + "," + fields[2]] = fields;
+		}
+		return baseline;
+	}
+
+	void usage()
+	{
+		std::cerr << "Usage: harness [-n messages] [-r runs] [-t threshold] [-b baseline] [-w baseline] [-d directory]" << std::endl;
+		std::cerr << "               build=pricer [build=pricer ...]" << std::endl;
+		std::cerr << "  -n  messages in every generated feed ( 1000000 )" << std::endl;
+		std::cerr << "  -r  runs to take the median of ( 5 )" << std::endl;
+		std::cerr << "  -t  share a build can get slower than the baseline before it fails ( 0.1 )" << std::endl;
+		std::cerr << "  -b  compare with this baseline, fail on slowdowns and changed output" << std::endl;
+		std::cerr << "  -w  write what we measured as a baseline" << std::endl;
+		std::cerr << "  -d  where the feeds and outputs go, feeds are kept for next time ( . )" << std::endl;
+	}
+}
+
+int main ( int argc, char **argv )
+{
+	try
+	{
+		uint64_t messages ( 1000000 );
+		size_t runs ( 5 );
+		double threshold ( 0.1 );
+		std::string baseline_file;
+		std::string write_file;
+		std::string directory ( "." );
+		int opt;
+		while ( ( opt = getopt ( argc, argv, "n:r:t:b:w:d:" ) ) != -1 )
+		{
+			switch ( opt )
+			{
+			case 'n':
+				messages = strtoull ( optarg, 0, 10 );
+				break;
+			case 'r':
+				runs = atoi ( optarg );
+				break;
+			case 't':
+				threshold = atof ( optarg );
+				break;
+			case 'b':
+				baseline_file = optarg;
+				break;
+			case 'w':
+				write_file = optarg;
+				break;
+			case 'd':
+				directory = optarg;
+				break;
+			default:
+				usage();
+				return 1;
+			}
+		}
+		std::vector<Build> builds;
+		for ( int i = optind; i < argc; i++ )
+		{
+			std::string arg ( argv[i] );
+			size_t equals ( arg.find ( '=' ) );
+			if ( equals == std::string::npos || equals == 0 || equals + 1 == arg.size() )
+			{
+				usage();
+				return 1;
+			}
+			builds.push_back ( Build { arg.substr ( 0, equals ), arg.substr ( equals + 1 ) } );
+		}
+		if ( builds.empty() || messages == 0 || runs == 0 || threshold <= 0 )
+		{
+			usage();
+			return 1;
+		}
+		std::map<std::string, std::vector<std::string> > baseline;
+		if ( !baseline_file.empty() )
+			baseline = readBaseline ( baseline_file );
+		std::ostringstream results;
+		results << "build,feed,target_size,messages,median_ms,messages_per_sec,peak_rss_kb,checksum,baseline_messages_per_sec,change" << std::endl;
+		std::cout << results.str() << std::flush;
+		std::vector<std::string> failures;
+		std::string output ( directory + "/throughput.out" );
+		for ( Feed const & feed : feeds ( messages ) )
+		{
+			std::string path ( feedPath ( directory, feed ) );
+			for ( uint32_t target_size : g_target_sizes )
+			{
+				std::string key ( feed.name + "," + std::to_string ( target_size ) );
+				// what the first build printed, every other one has to print the same
+				std::string expected;
+				for ( Build const & build : builds )
+				{
+					std::vector<double> times;
+					Result result;
+					result.peak_rss_kb = 0;
+					for ( size_t i = 0; i < runs; i++ )
+					{
+						long peak_rss_kb;
+						times.push_back ( run ( build.pricer, path, target_size, output, peak_rss_kb ) );
+						result.peak_rss_kb = std::max ( result.peak_rss_kb, peak_rss_kb );
+						std::string sum ( checksum ( output ) );
+						if ( i > 0 && sum != result.checksum )
+							failures.push_back ( build.name + " " + key + ": output changes from run to run" );
+						result.checksum = sum;
+					}
+					std::sort ( times.begin(), times.end() );
+					result.median_ms = times.size() % 2 ? times[times.size() / 2] : ( times[times.size() / 2 - 1] + times[times.size() / 2] ) / 2;
+					result.messages_per_sec = messages / ( result.median_ms / 1000 );
+					if ( expected.empty() )
+						expected = result.checksum;
+					else if ( result.checksum != expected )
+						failures.push_back ( build.name + " " + key + ": prints something else than " + builds[0].name );
+					std::ostringstream line;
+					line << build.name << "," << key << "," << messages << "," << result.median_ms << ","
+						 << static_cast < uint64_t > ( result.messages_per_sec ) << "," << result.peak_rss_kb << "," << result.checksum << ",";
+					std::map<std::string, std::vector<std::string> >::const_iterator base ( baseline.find ( build.name + "," + key ) );
+					// a baseline for a different number of messages doesn't count
+					if ( base != baseline.end() && base->second[3] == std::to_string ( messages ) )
+					{
+						double base_rate ( atof ( base->second[5].c_str() ) );
+						double change ( base_rate > 0 ? result.messages_per_sec / base_rate - 1 : 0 );
+						line << static_cast < uint64_t > ( base_rate ) << "," << change;
+						if ( base->second[7] != result.checksum )
+							failures.push_back ( build.name + " " + key + ": prints something else than the baseline" );
+						if ( change < -threshold )
+						{
+							char slower[32];
+							snprintf ( slower, sizeof ( slower ), "%.1f%%", -change * 100 );
+							failures.push_back ( build.name + " " + key + ": " + slower + " slower than the baseline" );
+						}
+					}
+					else
+						line << ",";
+					std::cout << line.str() << std::endl;
+					results << line.str() << std::endl;
+				}
+			}
+		}
+		unlink ( output.c_str() );
+		if ( !write_file.empty() )
+		{
+			std::ofstream out ( write_file.c_str() );
+			out << results.str();
+			if ( !out )
+				throw std::runtime_error ( "Unable to write " + write_file );
+		}
+		for ( std::string const & failure : failures )
+			std::cerr << "FAILED " << failure << std::endl;
+		return failures.empty() ? 0 : 1;
+	}
+	catch ( std::exception & ex )
+	{
+		std::cerr << "Exception caught: " << ex.what() << std::endl;
+		return 1;
+	}
+}
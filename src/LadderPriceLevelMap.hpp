@@ -0,0 +1,626 @@
+#ifndef __LADDER_PRICE_LEVEL_MAP_HPP__
+#define __LADDER_PRICE_LEVEL_MAP_HPP__
+
+#include <assert.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <limits>
+#include <utility>
+
+#include "MemoryStats.hpp"
+#include "OrderList.hpp"
+#include "SlabAllocator.hpp"
+#include "SweepCosts.hpp"
+#include "TargetCosts.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* Same interface as PriceLevelMap, but the levels near the best price live in a contiguous array covering a window
+		* of prices ( in price units ) that starts at an anchor just beyond the best price. Finding or creating a level is O(1),
+		* a bitmap gets us to the next non-empty level and walking the book touches one array instead of tree nodes.
+		*
+		* The array is a ring indexed by price modulo the window, so sliding the anchor only touches the levels that
+		* fall out of or into the window. Those go to / come from an ordinary map that keeps every price outside the window.
+		* We slide when a price comes in better than the window, or when the window runs dry.
+		*/
+		template <class T, class F = BookFixedPoint>
+		class LadderPriceLevelMap
+		{
+		public:
+			typedef typename F::price_type Price;
+			typedef typename F::volume_type Volume;
+			typedef typename F::value_type Value;
+			typedef BasicOrderStore<F> OrderStore;
+			typedef BasicOrderList<F> OrderList;
+
+		private:
+			typedef std::map < Price, OrderList, T, SlabNodeAllocator < std::pair < const Price, OrderList > > > OverflowLevels;
+
+		public:
+			static const uint32_t f_default_window = 4096;
+
+			Volume total_volume;
+
+			/* What an iterator points at, looks like the std::map value_type PriceLevelMap hands out */
+			typedef std::pair < Price, OrderList > Level;
+
+			class const_iterator
+			{
+			public:
+				const_iterator() : m_map ( 0 ), m_index ( 0 ) {}
+
+				Level const & operator* () const
+				{
+					return m_level;
+				}
+
+				Level const * operator-> () const
+				{
+					return &m_level;
+				}
+
+				const_iterator & operator++ ()
+				{
+					if ( onOverflow() )
+						++m_overflow;
+					else
+						++m_index;
+					settle();
+					return *this;
+				}
+
+				const_iterator operator++ ( int )
+				{
+					const_iterator copy ( *this );
+					++ ( *this );
+					return copy;
+				}
+
+				bool operator== ( const_iterator const & rhs ) const
+				{
+					return m_overflow == rhs.m_overflow && m_index == rhs.m_index;
+				}
+
+				bool operator!= ( const_iterator const & rhs ) const
+				{
+					return ! ( *this == rhs );
+				}
+
+			private:
+				friend class LadderPriceLevelMap;
+				typedef typename LadderPriceLevelMap::OverflowLevels::const_iterator OverflowIterator;
+
+				LadderPriceLevelMap const * m_map;
+				// we're either on an overflow level, on a ladder index or past the end of both
+				OverflowIterator m_overflow;
+				size_t m_index;
+				Level m_level;
+
+				const_iterator ( LadderPriceLevelMap const * map, OverflowIterator overflow, size_t index ) :
+					m_map ( map ),
+					m_overflow ( overflow ),
+					m_index ( index )
+				{
+					settle();
+				}
+
+				/*
+				* Overflow levels better than the window come first, then the ladder, then the rest of the overflow.
+				*/
+				bool onOverflow() const
+				{
+					return m_overflow != m_map->m_overflow.end() &&
+						   ( m_index >= m_map->m_window || keyOf ( m_overflow->first ) < m_map->m_anchor );
+				}
+
+				/* Skip to the next level that's actually there and fill in m_level */
+				void settle()
+				{
+					if ( !onOverflow() )
+					{
+						m_index = m_map->nextLevel ( m_index );
+						if ( m_index < m_map->m_window )
+						{
+							m_level = Level ( m_map->priceAt ( m_index ), m_map->m_levels[m_map->slotOf ( m_index )] );
+							return;
+						}
+					}
+					if ( m_overflow != m_map->m_overflow.end() )
+						m_level = Level ( m_overflow->first, m_overflow->second );
+				}
+			};
+
+			LadderPriceLevelMap ( uint32_t target_volume, uint32_t window = f_default_window ) :
+				LadderPriceLevelMap ( std::vector<uint32_t> ( 1, target_volume ), window )
+			{
+			}
+
+			/* Keeps the cost of every one of these volumes up to date */
+			LadderPriceLevelMap ( std::vector<uint32_t> const & target_volumes, uint32_t window = f_default_window ) : total_volume ( 0 ),
+				m_levels ( window ),
+				m_bitmap ( ( window + 63 ) / 64 ),
+				m_window ( window ),
+				m_mask ( window - 1 ),
+				m_anchor ( 0 ),
+				m_anchored ( false ),
+				m_ladder_levels ( 0 ),
+				m_costs ( target_volumes ),
+				m_most_levels ( 0 )
+			{
+				// a power of two, and at least a full bitmap word
+				assert ( window >= 64 && ( window & ( window - 1 ) ) == 0 );
+			}
+
+			/* Queue the order at its price level, O(1) inside the window, O(logN) in the overflow */
+			void add ( OrderStore & orders,
+					   OrderHandle order )
+			{
+				Price price ( orders.price ( order ) );
+				Volume volume ( orders.volume ( order ) );
+				OrderList & price_level ( level ( price ) );
+				price_level.add ( orders, order );
+				price_level.total_volume += volume;
+				total_volume += volume;
+				assert ( price_level.total_volume > 0 );
+				m_costs.added ( price, volume, *this );
+				if ( m_sweeps.enabled() )
+					m_sweeps.added ( price, volume );
+			}
+
+			/* Returns true if this takes out the whole order ( and releases it ), false otherwise */
+			bool reduce ( OrderStore & orders,
+						  OrderHandle order,
+						  Volume volume )
+			{
+				Price price ( orders.price ( order ) );
+				OrderList & price_level ( level ( price ) );
+				bool removed ( orders.volume ( order ) <= volume );
+				if ( removed )
+				{
+					assert ( price_level.total_volume > 0 );
+					volume = orders.volume ( order );
+					price_level.remove ( orders, order );
+					orders.release ( order );
+				}
+				else
+					orders.reduce ( order, volume );
+				price_level.total_volume -= volume;
+				total_volume -= volume;
+				// the costs still need the level, even if it's empty now
+				m_costs.reduced ( price, volume, *this );
+				if ( m_sweeps.enabled() )
+					m_sweeps.removed ( price, volume );
+				if ( price_level.empty() )
+					remove ( price );
+				return removed;
+			}
+
+			/* Cost of the target volume ( the first one by default ), F::unknown if there isn't enough volume in the book */
+			Value get_total_value ( size_t target = 0 )
+			{
+				return m_costs.value ( target, total_volume, [this] ( auto f )
+				{
+					walk ( f );
+				} );
+			}
+
+			/* Start pulling in the level at price, if it's on the ladder ( the overflow isn't worth it ) */
+			void prefetch ( Price price ) const
+			{
+				size_t index;
+				if ( indexOf ( price, index ) )
+					__builtin_prefetch ( &m_levels[slotOf ( index )] );
+			}
+
+			/*
+			* Keep prefix sums of the levels from here on ( see SweepCosts ), cost_for and size_for_budget then take O(log window)
+			* instead of a walk. Every add and reduce pays O(log window) for it.
+			*/
+			void enable_sweeps ( uint32_t window = SweepCosts<T, F>::f_default_window )
+			{
+				m_sweeps = SweepCosts<T, F> ( window );
+				for ( const_iterator level = begin(); level != end(); ++level )
+					m_sweeps.added ( level->first, level->second.total_volume );
+			}
+
+			/* What taking out any volume costs, F::unknown if there isn't that much in the book */
+			Value cost_for ( Volume volume ) const
+			{
+				if ( m_sweeps.enabled() )
+					return m_sweeps.cost_for ( volume );
+				return SweepCosts<T, F>::walkCost ( begin(), end(), volume );
+			}
+
+			/* Most volume the budget takes out, all of it if there's budget left over */
+			Volume size_for_budget ( Value budget ) const
+			{
+				if ( m_sweeps.enabled() )
+					return m_sweeps.size_for_budget ( budget );
+				return SweepCosts<T, F>::walkSize ( begin(), end(), budget );
+			}
+
+			size_t targets() const
+			{
+				return m_costs.size();
+			}
+
+			Volume target_volume ( size_t target ) const
+			{
+				return m_costs.volume ( target );
+			}
+
+			bool empty() const
+			{
+				assert ( size() != 0 || total_volume == 0 );
+				return size() == 0;
+			}
+
+			size_t size() const
+			{
+				return m_ladder_levels + m_overflow.size();
+			}
+
+			/* Most levels there ever were at once */
+			size_t most_levels() const
+			{
+				return m_most_levels;
+			}
+
+			/*
+			* What we hold ourselves: the ladder, its bitmap and the costs. The overflow's nodes come out of the slab
+			* for their type ( see SlabAllocator ), every map on the thread shares that.
+			*/
+			MemoryUsage memory() const
+			{
+				size_t bytes ( m_bitmap.capacity() * sizeof ( uint64_t ) + m_costs.bytes() + m_sweeps.bytes() );
+				return MemoryUsage ( bytes + m_levels.capacity() * sizeof ( OrderList ), bytes + m_ladder_levels * sizeof ( OrderList ) );
+			}
+
+			void clear()
+			{
+				std::fill ( m_bitmap.begin(), m_bitmap.end(), 0 );
+				m_overflow.clear();
+				m_ladder_levels = 0;
+				m_anchored = false;
+				if ( m_sweeps.enabled() )
+					m_sweeps = SweepCosts<T, F> ( m_sweeps.window() );
+			}
+
+			const_iterator begin() const
+			{
+				return const_iterator ( this, m_overflow.begin(), 0 );
+			}
+
+			const_iterator end() const
+			{
+				return const_iterator ( this, m_overflow.end(), m_window );
+			}
+
+		private:
+
+			/*
+			* Everything inside is done on keys that grow as prices get worse, std::greater puts the best price on top,
+			* so for the buy side the key is the price turned upside down.
+			*/
+			static constexpr bool f_descending = T() ( 1u, 0u );
+
+			// a level is in use when its bit in m_bitmap is set
+			std::vector<OrderList> m_levels;
+			std::vector<uint64_t> m_bitmap;
+			OverflowLevels m_overflow;
+			uint32_t m_window;
+			uint32_t m_mask;
+			// key of the first price in the window
+			uint32_t m_anchor;
+			bool m_anchored;
+			size_t m_ladder_levels;
+			TargetCosts<T, F> m_costs;
+			// off unless someone asks for them
+			SweepCosts<T, F> m_sweeps;
+			size_t m_most_levels;
+
+			/*
+			* Visit the levels best first, same order as the iterators but without their bookkeeping.
+			* Stops as soon as f returns false.
+			*/
+			template <class Visit>
+			void walk ( Visit f ) const
+			{
+				typename OverflowLevels::const_iterator iter ( m_overflow.begin() );
+				for ( ; iter != m_overflow.end() && keyOf ( iter->first ) < m_anchor; ++iter )
+					if ( !f ( iter->first, iter->second ) )
+						return;
+				for ( size_t index = nextLevel ( 0 ); index < m_window; index = nextLevel ( index + 1 ) )
+					if ( !f ( priceAt ( index ), m_levels[slotOf ( index )] ) )
+						return;
+				for ( ; iter != m_overflow.end(); ++iter )
+					if ( !f ( iter->first, iter->second ) )
+						return;
+			}
+
+			friend class TargetCosts<T, F>;
+
+			Volume volume_at ( Price price ) const
+			{
+				size_t index;
+				if ( indexOf ( price, index ) )
+				{
+					assert ( isSet ( slotOf ( index ) ) );
+					return m_levels[slotOf ( index )].total_volume;
+				}
+				typename OverflowLevels::const_iterator iter ( m_overflow.find ( price ) );
+				assert ( iter != m_overflow.end() );
+				return iter->second.total_volume;
+			}
+
+			/* The level right before price, false if price is the best one */
+			bool next_better ( Price price, Price & out ) const
+			{
+				size_t index;
+				bool in_window ( indexOf ( price, index ) );
+				if ( in_window && ( index = prevLevel ( index ) ) < m_window )
+				{
+					out = priceAt ( index );
+					return true;
+				}
+				// best overflow level that's better than price
+				typename OverflowLevels::const_iterator iter ( m_overflow.lower_bound ( price ) );
+				bool overflow ( iter != m_overflow.begin() );
+				if ( overflow )
+					--iter;
+				// coming from beyond the window, the window's in between
+				if ( !in_window && m_anchored && keyOf ( price ) > m_anchor && ( !overflow || keyOf ( iter->first ) < m_anchor ) &&
+						( index = prevLevel ( m_window ) ) < m_window )
+				{
+					out = priceAt ( index );
+					return true;
+				}
+				if ( overflow )
+					out = iter->first;
+				return overflow;
+			}
+
+			/* The level right after price, false if price is the worst one */
+			bool next_worse ( Price price, Price & out ) const
+			{
+				size_t index;
+				bool in_window ( indexOf ( price, index ) );
+				if ( in_window && ( index = nextLevel ( index + 1 ) ) < m_window )
+				{
+					out = priceAt ( index );
+					return true;
+				}
+				// first overflow level that's worse than price
+				typename OverflowLevels::const_iterator iter ( m_overflow.upper_bound ( price ) );
+				bool overflow ( iter != m_overflow.end() );
+				// coming from before the window, the window's in between
+				if ( !in_window && m_anchored && keyOf ( price ) < m_anchor && ( !overflow || keyOf ( iter->first ) >= m_anchor ) &&
+						( index = nextLevel ( 0 ) ) < m_window )
+				{
+					out = priceAt ( index );
+					return true;
+				}
+				if ( overflow )
+					out = iter->first;
+				return overflow;
+			}
+
+			static Price keyOf ( Price price )
+			{
+				return f_descending ? std::numeric_limits<Price>::max() - price : price;
+			}
+
+			/* Index of the price in the window, counting from the anchor */
+			bool indexOf ( Price price, size_t & index ) const
+			{
+				uint32_t key ( keyOf ( price ) );
+				if ( !m_anchored || key < m_anchor || key - m_anchor >= m_window )
+					return false;
+				index = key - m_anchor;
+				return true;
+			}
+
+			Price priceAt ( size_t index ) const
+			{
+				return keyOf ( m_anchor + index );
+			}
+
+			/* Where the index lives in the ring */
+			size_t slotOf ( size_t index ) const
+			{
+				return ( m_anchor + index ) & m_mask;
+			}
+
+			/* First set bit in slots [ begin, end ), end if there's none */
+			size_t findSlot ( size_t begin, size_t end ) const
+			{
+				if ( begin >= end )
+					return end;
+				size_t word ( begin / 64 );
+				size_t last_word ( ( end - 1 ) / 64 );
+				uint64_t bits ( m_bitmap[word] & ( ~0ULL << ( begin % 64 ) ) );
+				while ( !bits )
+				{
+					if ( ++word > last_word )
+						return end;
+					bits = m_bitmap[word];
+				}
+				size_t slot ( word * 64 + __builtin_ctzll ( bits ) );
+				return slot < end ? slot : end;
+			}
+
+			/* Last set bit in slots [ begin, end ), end if there's none */
+			size_t findLastSlot ( size_t begin, size_t end ) const
+			{
+				if ( begin >= end )
+					return end;
+				size_t word ( ( end - 1 ) / 64 );
+				size_t first_word ( begin / 64 );
+				uint64_t bits ( m_bitmap[word] & ( ~0ULL >> ( 63 - ( end - 1 ) % 64 ) ) );
+				while ( !bits )
+				{
+					if ( word == first_word )
+						return end;
+					bits = m_bitmap[--word];
+				}
+				size_t slot ( word * 64 + 63 - __builtin_clzll ( bits ) );
+				return slot >= begin ? slot : end;
+			}
+
+			/* First non-empty index at or after index, m_window if there's none */
+			size_t nextLevel ( size_t index ) const
+			{
+				if ( index >= m_window )
+					return m_window;
+				size_t base ( m_anchor & m_mask );
+				size_t slot ( ( base + index ) & m_mask );
+				// the window runs from base to the end of the ring and wraps around to base
+				size_t end ( slot >= base ? m_window : base );
+				size_t found ( findSlot ( slot, end ) );
+				if ( found == end && end == m_window )
+				{
+					end = base;
+					found = findSlot ( 0, end );
+				}
+				return found == end ? m_window : ( found - base ) & m_mask;
+			}
+
+			/* Last non-empty index before index, m_window if there's none */
+			size_t prevLevel ( size_t index ) const
+			{
+				if ( index == 0 )
+					return m_window;
+				size_t base ( m_anchor & m_mask );
+				size_t end ( base + index );
+				// the part that wrapped around to the start of the ring holds the later indexes
+				if ( end > m_window )
+				{
+					size_t found ( findLastSlot ( 0, end - m_window ) );
+					if ( found != end - m_window )
+						return found + m_window - base;
+					end = m_window;
+				}
+				size_t found ( findLastSlot ( base, end ) );
+				return found == end ? m_window : found - base;
+			}
+
+			bool isSet ( size_t slot ) const
+			{
+				return m_bitmap[slot / 64] & ( 1ULL << ( slot % 64 ) );
+			}
+
+			void setSlot ( size_t slot )
+			{
+				m_bitmap[slot / 64] |= 1ULL << ( slot % 64 );
+			}
+
+			void clearSlot ( size_t slot )
+			{
+				m_bitmap[slot / 64] &= ~ ( 1ULL << ( slot % 64 ) );
+			}
+
+			/* Put the anchor a quarter of the window beyond price, so the best price has some room to improve */
+			uint32_t anchorFor ( Price price ) const
+			{
+				uint32_t key ( keyOf ( price ) );
+				uint32_t room ( m_window / 4 );
+				return key < room ? 0 : key - room;
+			}
+
+			OrderList & level ( Price price )
+			{
+				size_t index;
+				if ( !indexOf ( price, index ) )
+				{
+					typename OverflowLevels::iterator iter ( m_overflow.find ( price ) );
+					if ( iter != m_overflow.end() )
+						return iter->second;
+					// a new best price outside the window, or the very first level
+					if ( !m_anchored || keyOf ( price ) < m_anchor )
+					{
+						recenter ( anchorFor ( price ) );
+						return level ( price );
+					}
+					OrderList & created ( m_overflow[price] );
+					m_most_levels = std::max ( m_most_levels, size() );
+					return created;
+				}
+				size_t slot ( slotOf ( index ) );
+				if ( !isSet ( slot ) )
+				{
+					m_levels[slot] = OrderList();
+					setSlot ( slot );
+					m_ladder_levels++;
+					m_most_levels = std::max ( m_most_levels, size() );
+				}
+				return m_levels[slot];
+			}
+
+			/* Remove the price level */
+			void remove ( Price price )
+			{
+				size_t index;
+				if ( indexOf ( price, index ) )
+				{
+					size_t slot ( slotOf ( index ) );
+					assert ( isSet ( slot ) && m_levels[slot].empty() );
+					clearSlot ( slot );
+					m_ladder_levels--;
+				}
+				else
+				{
+					assert ( m_overflow.count ( price ) );
+					m_overflow.erase ( price );
+				}
+				// the window ran dry, move it to wherever the book is now
+				if ( m_ladder_levels == 0 )
+				{
+					if ( m_overflow.empty() )
+						m_anchored = false;
+					else
+						recenter ( anchorFor ( m_overflow.begin()->first ) );
+				}
+			}
+
+			/*
+			* Slide the window to start at anchor. Levels that fall out go to the overflow,
+			* overflow levels that are now inside the window come in. Levels that stay don't move at all.
+			*/
+			void recenter ( uint32_t anchor )
+			{
+				if ( m_anchored )
+				{
+					for ( size_t index = nextLevel ( 0 ); index < m_window; index = nextLevel ( index + 1 ) )
+					{
+						uint32_t key ( m_anchor + index );
+						if ( key < anchor || static_cast < uint64_t > ( key ) >= static_cast < uint64_t > ( anchor ) + m_window )
+						{
+							size_t slot ( slotOf ( index ) );
+							m_overflow.insert ( std::make_pair ( priceAt ( index ), m_levels[slot] ) );
+							clearSlot ( slot );
+							m_ladder_levels--;
+						}
+					}
+				}
+				m_anchor = anchor;
+				m_anchored = true;
+				// the overflow is sorted best first, so by key, the ones that fit are a single range
+				typename OverflowLevels::iterator iter ( m_overflow.lower_bound ( keyOf ( anchor ) ) );
+				while ( iter != m_overflow.end() &&
+						static_cast < uint64_t > ( keyOf ( iter->first ) ) < static_cast < uint64_t > ( anchor ) + m_window )
+				{
+					size_t slot ( keyOf ( iter->first ) & m_mask );
+					m_levels[slot] = iter->second;
+					setSlot ( slot );
+					m_ladder_levels++;
+					iter = m_overflow.erase ( iter );
+				}
+			}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef __LATENCY_HISTOGRAM_HPP__
+#define __LATENCY_HISTOGRAM_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <limits>
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* HDR style histogram: every power of two is split into 16 buckets, so any value is off by at most 1/16th,
+		* from 1 all the way up to 2^64. Recording is a count of leading zeroes, a shift and an increment, nothing allocates.
+		*/
+		class LatencyHistogram
+		{
+		public:
+			LatencyHistogram()
+			{
+				clear();
+			}
+
+			void record ( uint64_t value )
+			{
+				m_counts[index ( value )]++;
+				m_count++;
+				m_sum += value;
+				m_min = std::min ( m_min, value );
+				m_max = std::max ( m_max, value );
+			}
+
+			uint64_t count() const
+			{
+				return m_count;
+			}
+
+			uint64_t min() const
+			{
+				return m_count ? m_min : 0;
+			}
+
+			uint64_t max() const
+			{
+				return m_max;
+			}
+
+			double mean() const
+			{
+				return m_count ? static_cast < double > ( m_sum ) / m_count : 0;
+			}
+
+			/* Smallest value that at least this share ( 0 .. 1 ) of what we recorded is at or below, to within a bucket */
+			uint64_t percentile ( double share ) const
+			{
+				if ( m_count == 0 )
+					return 0;
+				uint64_t rank ( static_cast < uint64_t > ( share * m_count + 0.5 ) );
+				rank = std::max < uint64_t > ( 1, std::min ( rank, m_count ) );
+				uint64_t seen ( 0 );
+				for ( size_t i = 0; i < f_buckets; i++ )
+				{
+					seen += m_counts[i];
+					if ( seen >= rank )
+						return std::min ( highest ( i ), m_max );
+				}
+				return m_max;
+			}
+
+			LatencyHistogram & operator+= ( LatencyHistogram const & rhs )
+			{
+				for ( size_t i = 0; i < f_buckets; i++ )
+					m_counts[i] += rhs.m_counts[i];
+				m_count += rhs.m_count;
+				m_sum += rhs.m_sum;
+				m_min = std::min ( m_min, rhs.m_min );
+				m_max = std::max ( m_max, rhs.m_max );
+				return *this;
+			}
+
+			void clear()
+			{
+				std::fill ( m_counts, m_counts + f_buckets, 0 );
+				m_count = 0;
+				m_sum = 0;
+				m_min = std::numeric_limits<uint64_t>::max();
+				m_max = 0;
+			}
+
+		private:
+			static const unsigned f_sub_bucket_bits = 4;
+			static const uint64_t f_sub_buckets = 1u << f_sub_bucket_bits;
+			// values below f_sub_buckets get one bucket each, every power of two above that gets f_sub_buckets
+			static const size_t f_buckets = ( 64 - f_sub_bucket_bits + 1 ) * f_sub_buckets;
+
+			uint64_t m_counts[f_buckets];
+			uint64_t m_count;
+			uint64_t m_sum;
+			uint64_t m_min;
+			uint64_t m_max;
+
+			static size_t index ( uint64_t value )
+			{
+				if ( value < f_sub_buckets )
+					return value;
+				unsigned exponent ( 63 - __builtin_clzll ( value ) );
+				unsigned shift ( exponent - f_sub_bucket_bits );
+				return ( shift + 1 ) * f_sub_buckets + ( ( value >> shift ) - f_sub_buckets );
+			}
+
+			/* Largest value that ends up in the bucket */
+			static uint64_t highest ( size_t index )
+			{
+				if ( index < f_sub_buckets )
+					return index;
+				unsigned shift ( index / f_sub_buckets - 1 );
+				uint64_t mantissa ( f_sub_buckets + index % f_sub_buckets );
+				return ( ( mantissa + 1 ) << shift ) - 1;
+			}
+		};
+	}
+}
+
+#endif
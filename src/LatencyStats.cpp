@@ -0,0 +1,84 @@
+#include <stdio.h>
+
+#include "LatencyStats.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		static const char * f_stage_names[LatencyStats::STAGES] =
+		{
+			"parse",
+			"add message",
+			"reduce message",
+			"error message",
+			"order dict",
+			"add, existing level",
+			"add, new level",
+			"reduce, level stays",
+			"reduce, level removed",
+			"check, cached",
+			"check, recomputed"
+		};
+
+		LatencyStats::LatencyStats()
+		{
+			clear();
+		}
+
+		void LatencyStats::clear()
+		{
+			for ( LatencyHistogram & histogram : m_histograms )
+				histogram.clear();
+			std::fill ( m_counters, m_counters + COUNTERS, 0 );
+			m_start_ticks = now();
+			m_start_time = std::chrono::steady_clock::now();
+		}
+
+		LatencyStats & LatencyStats::operator+= ( LatencyStats const & rhs )
+		{
+			for ( size_t stage = 0; stage < STAGES; stage++ )
+				m_histograms[stage] += rhs.m_histograms[stage];
+			for ( size_t counter = 0; counter < COUNTERS; counter++ )
+				m_counters[counter] += rhs.m_counters[counter];
+			if ( rhs.m_start_time < m_start_time )
+			{
+				m_start_ticks = rhs.m_start_ticks;
+				m_start_time = rhs.m_start_time;
+			}
+			return *this;
+		}
+
+		void LatencyStats::print ( std::ostream & os ) const
+		{
+			double ns ( std::chrono::duration < double, std::nano > ( std::chrono::steady_clock::now() - m_start_time ).count() );
+			uint64_t ticks ( now() - m_start_ticks );
+			double ns_per_tick ( ticks ? ns / ticks : 1 );
+			char line[160];
+			os << "Latency ( ns ):" << std::endl;
+			snprintf ( line, sizeof ( line ), "%-24s %12s %9s %9s %9s %9s %9s %9s\n", "stage", "count", "mean", "p50", "p90", "p99", "p99.9", "max" );
+			os << line;
+			for ( size_t stage = 0; stage < STAGES; stage++ )
+			{
+				LatencyHistogram const & histogram ( m_histograms[stage] );
+				if ( histogram.count() == 0 )
+					continue;
+				snprintf ( line, sizeof ( line ), "%-24s %12llu %9.0f %9.0f %9.0f %9.0f %9.0f %9.0f\n",
+						   f_stage_names[stage],
+						   static_cast < unsigned long long > ( histogram.count() ),
+						   histogram.mean() * ns_per_tick,
+						   histogram.percentile ( 0.5 ) * ns_per_tick,
+						   histogram.percentile ( 0.9 ) * ns_per_tick,
+						   histogram.percentile ( 0.99 ) * ns_per_tick,
+						   histogram.percentile ( 0.999 ) * ns_per_tick,
+						   histogram.max() * ns_per_tick );
+				os << line;
+			}
+			snprintf ( line, sizeof ( line ), "%llu messages in %.1f ms ( %.0f per second ), %llu walks of the levels\n",
+					   static_cast < unsigned long long > ( m_counters[MESSAGES] ),
+					   ns / 1e6,
+					   ns > 0 ? m_counters[MESSAGES] * 1e9 / ns : 0.0,
+					   static_cast < unsigned long long > ( m_counters[LEVEL_WALKS] ) );
+			os << line;
+		}
+	}
+}
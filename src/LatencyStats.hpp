@@ -0,0 +1,129 @@
+#ifndef __LATENCY_STATS_HPP__
+#define __LATENCY_STATS_HPP__
+
+#include <stdint.h>
+#include <chrono>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "LatencyHistogram.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* Where the time goes, per message and per stage of handling it. One per thread, like the allocators.
+		*
+		* Timings are in TSC ticks ( nanoseconds where there's no TSC ) and only turned into nanoseconds when we print,
+		* against the wall clock time that went by since the first one.
+		*
+		* Only builds with LATENCY_STATS defined record anything. Without it the macros below are empty,
+		* so the book doesn't even read the clock.
+		*/
+		class LatencyStats
+		{
+		public:
+			enum Stage
+			{
+				// taking a line apart
+				PARSE,
+				// a whole message through the book, by type
+				PROCESS_ADD,
+				PROCESS_REDUCE,
+				PROCESS_ERROR,
+				// finding or adding the order id
+				ORDER_DICT,
+				// the price level map, split by whether the level was there ( and stays ) or not
+				ADD_EXISTING_LEVEL,
+				ADD_NEW_LEVEL,
+				REDUCE_KEEP_LEVEL,
+				REDUCE_REMOVE_LEVEL,
+				// getting the costs, split by whether they were up to date or needed a walk of the levels
+				CHECK_CACHED,
+				CHECK_RECOMPUTED,
+				STAGES
+			};
+
+			enum Counter
+			{
+				MESSAGES,
+				LEVEL_WALKS,
+				COUNTERS
+			};
+
+			static LatencyStats & instance()
+			{
+				static thread_local LatencyStats stats;
+				return stats;
+			}
+
+			static uint64_t now()
+			{
+#if defined(__x86_64__) || defined(__i386__)
+				return __rdtsc();
+#else
+				return std::chrono::duration_cast<std::chrono::nanoseconds> ( std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+			}
+
+			void record ( Stage stage, uint64_t ticks )
+			{
+				m_histograms[stage].record ( ticks );
+			}
+
+			void count ( Counter counter )
+			{
+				m_counters[counter]++;
+			}
+
+			LatencyHistogram const & histogram ( Stage stage ) const
+			{
+				return m_histograms[stage];
+			}
+
+			uint64_t counter ( Counter counter ) const
+			{
+				return m_counters[counter];
+			}
+
+			/* Another thread's, we count from whichever of us started first */
+			LatencyStats & operator+= ( LatencyStats const & rhs );
+
+			/* Percentiles per stage in nanoseconds, and messages per second since we started */
+			void print ( std::ostream & os ) const;
+			void clear();
+		private:
+			LatencyStats();
+
+			LatencyHistogram m_histograms[STAGES];
+			uint64_t m_counters[COUNTERS];
+			uint64_t m_start_ticks;
+			std::chrono::steady_clock::time_point m_start_time;
+		};
+	}
+}
+
+#ifdef LATENCY_STATS
+// starts timing into a local
+#define LATENCY_TIMER(timer) uint64_t timer ( RgmInterview::OrderBook::LatencyStats::now() )
+// records the time since the timer started ( or last lapped ) for the stage, and starts over
+#define LATENCY_LAP(stage, timer) \
+	do { \
+		uint64_t latency_now ( RgmInterview::OrderBook::LatencyStats::now() ); \
+		RgmInterview::OrderBook::LatencyStats::instance().record ( stage, latency_now - timer ); \
+		timer = latency_now; \
+	} while ( 0 )
+#define LATENCY_COUNT(counter) RgmInterview::OrderBook::LatencyStats::instance().count ( counter )
+// whatever only the instrumented build needs
+#define LATENCY_ONLY(statement) statement
+#else
+#define LATENCY_TIMER(timer)
+#define LATENCY_LAP(stage, timer)
+#define LATENCY_COUNT(counter)
+#define LATENCY_ONLY(statement)
+#endif
+
+#endif
@@ -1,35 +1,397 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
 #include <fstream>
 #include <cstring>
 #include <string>
+#include <vector>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 
+#include "BinaryFeed.hpp"
+#include "BookManager.hpp"
 #include "FeedHandler.hpp"
+#include "GzipReader.hpp"
+#include "LatencyStats.hpp"
+#include "MappedFile.hpp"
+#include "ParallelParser.hpp"
+#include "Pipeline.hpp"
+#include "Snapshot.hpp"
 
 using namespace RgmInterview::OrderBook;
 
+static bool parseFlushPolicy ( std::string const & name, FlushPolicy::Policy & policy )
+{
+	if ( name == "message" )
+		policy = FlushPolicy::PER_MESSAGE;
+	else if ( name == "batch" )
+		policy = FlushPolicy::PER_BATCH;
+	else if ( name == "exit" )
+		policy = FlushPolicy::ON_EXIT;
+	else
+		return false;
+	return true;
+}
+
+static void usage()
+{
+	std::cerr << "Usage: pricer [-i input-file | -b binary-file] [-f message|batch|exit] [-s threads] [-r snapshot] [-w snapshot]" << std::endl;
+	std::cerr << "              [-B batch-size] [-p | -j threads] [-m messages]" << std::endl;
+	std::cerr << "              target-size [target-size ...]" << std::endl;
+	std::cerr << "  -i  memory map the feed from input-file instead of reading stdin, a gzipped one gets decompressed on a thread of its own" << std::endl;
+	std::cerr << "  -b  replay a feed converter already parsed into binary-file" << std::endl;
+	std::cerr << "  -f  when to flush the output: after every message, every batch of input or only when we're done ( default )" << std::endl;
+	std::cerr << "  -s  every line starts with a symbol, keep a book per symbol spread over this many threads" << std::endl;
+	std::cerr << "      and start every output line with its symbol" << std::endl;
+	std::cerr << "  -r  restore the book from a snapshot and carry on from where it was taken in the same input" << std::endl;
+	std::cerr << "  -w  write a snapshot of the book once we're through the input" << std::endl;
+	std::cerr << "  -B  how many messages to prefetch for and handle together, 1 handles them one by one" << std::endl;
+	std::cerr << "  -p  parse on one thread and handle the book on another" << std::endl;
+	std::cerr << "  -j  parse input-file in chunks on this many threads, the book takes them in order on this one" << std::endl;
+	std::cerr << "  -m  every this many messages say how much memory the book holds, and what it all came to at the end ( on stderr )" << std::endl;
+	std::cerr << "With more than one target-size every output line starts with the target-size it's for" << std::endl;
+}
+
+/*
+* The feed handler parsing and handling every line on this thread, with the same calls as a Pipeline
+*/
+struct InlineFeed
+{
+	FeedHandler & feed;
+	OutputWriter & out;
+
+	size_t processLines ( std::string_view buffer )
+	{
+		return feed.processLines ( buffer, out );
+	}
+
+	void processMessage ( std::string_view line )
+	{
+		feed.processMessage ( line, out );
+	}
+};
+
+/*
+* Lines that keep the input position up to date with every byte they take, for the snapshot
+*/
+template <class Lines>
+struct PositionedLines
+{
+	Lines & lines;
+	InputPosition & position;
+
+	size_t processLines ( std::string_view buffer )
+	{
+		size_t consumed ( lines.processLines ( buffer ) );
+		position.add ( buffer.substr ( 0, consumed ) );
+		return consumed;
+	}
+
+	void processMessage ( std::string_view line )
+	{
+		lines.processMessage ( line );
+		position.add ( line );
+	}
+};
+
+/*
+* The whole file is mapped and the parser works on views straight into it.
+* Offsets are in bytes, everything up to where the snapshot was taken is skipped.
+*/
+template <class Lines>
+static void processMappedFile ( Lines & lines, std::string const & path, InputPosition & position, InputPosition const & taken )
+{
+	MappedFile file ( path );
+	std::string_view data ( file.view() );
+	if ( taken.offset > data.size() )
+		throw std::runtime_error ( "Snapshot is past the end of " + path );
+	position.add ( data.substr ( 0, taken.offset ) );
+	position.checkResume ( taken );
+	data = data.substr ( taken.offset );
+	PositionedLines<Lines> positioned = { lines, position };
+	size_t consumed ( positioned.processLines ( data ) );
+	// last line without a newline
+	if ( consumed < data.size() )
+		positioned.processMessage ( data.substr ( consumed ) );
+}
+
+/*
+* Same thing without any parsing, the records are read straight out of the mapping.
+* Offsets are in messages.
+*/
+static void processBinaryFile ( FeedHandler & feed, std::string const & path, InputPosition & position, InputPosition const & taken, OutputWriter & out )
+{
+	BinaryFeedReader reader ( path );
+	if ( taken.offset > reader.size() )
+		throw std::runtime_error ( "Snapshot is past the end of " + path );
+	position.add ( reader.records ( 0, taken.offset ), taken.offset );
+	position.checkResume ( taken );
+	reader.replay ( feed, out, taken.offset );
+	position.add ( reader.records ( taken.offset, reader.size() ), reader.size() - taken.offset );
+}
+
+/*
+* The text comes out of a thread decompressing the file into buffers we parse where they are.
+* Offsets are in decompressed bytes, so they're the same as the plain file's.
+*/
+template <class Lines>
+static void processGzipFile ( Lines & lines, std::string const & path, InputPosition & position, InputPosition const & taken )
+{
+	GzipReader reader ( path );
+	PositionedLines<Lines> positioned = { lines, position };
+	if ( taken.offset == 0 )
+		position.checkResume ( taken );
+	reader.replay ( positioned, taken.offset, [&] ( std::string_view data )
+	{
+		position.add ( data );
+		if ( position.offset == taken.offset )
+			position.checkResume ( taken );
+	} );
+}
+
+template <class Lines>
+static void processInputFile ( Lines & lines, std::string const & path, InputPosition & position, InputPosition const & taken )
+{
+	if ( GzipReader::isGzip ( path ) )
+		processGzipFile ( lines, path, position, taken );
+	else
+		processMappedFile ( lines, path, position, taken );
+}
+
+/*
+* Straight reads into a buffer we keep, so whatever is in the pipe gets handled right away and the lines go through
+* processLines in batches like a mapped file's. The buffer grows if a line doesn't fit.
+* Offsets are in bytes, whatever comes before where the snapshot was taken is skipped.
+*/
+template <class Lines>
+static void processStream ( Lines & lines, int fd, InputPosition & position, InputPosition const & taken )
+{
+	std::vector<char> buffer ( 64 * 1024 );
+	ssize_t len;
+	while ( position.offset < taken.offset )
+	{
+		len = read ( fd, buffer.data(), std::min<uint64_t> ( buffer.size(), taken.offset - position.offset ) );
+		if ( len <= 0 )
+			throw std::runtime_error ( "Snapshot is past the end of the input" );
+		position.add ( std::string_view ( buffer.data(), len ) );
+	}
+	position.checkResume ( taken );
+	PositionedLines<Lines> positioned = { lines, position };
+	size_t used ( 0 );
+	while ( ( len = read ( fd, &buffer[used], buffer.size() - used ) ) > 0 )
+	{
+		used += len;
+		size_t consumed ( positioned.processLines ( std::string_view ( buffer.data(), used ) ) );
+		std::copy ( buffer.begin() + consumed, buffer.begin() + used, buffer.begin() );
+		used -= consumed;
+		if ( used == buffer.size() )
+			buffer.resize ( buffer.size() * 2 );
+	}
+	if ( len < 0 )
+		throw std::runtime_error ( "Can't read the input" );
+	// last line without a newline
+	if ( used > 0 )
+		positioned.processMessage ( std::string_view ( buffer.data(), used ) );
+}
+
+/*
+* Every line starts with a symbol. The manager only queues views, so the input stays in memory until we're done.
+*/
+static int processSymbols ( std::vector<uint32_t> const & target_sizes,
+							size_t threads,
+							std::string const & input_file,
+							FlushPolicy::Policy flush_policy )
+{
+	FdSink sink ( STDOUT_FILENO );
+	BookManager manager ( target_sizes, threads, sink, flush_policy );
+	std::unique_ptr<MappedFile> file;
+	std::string buffer;
+	std::string_view data;
+	if ( input_file.empty() )
+	{
+		char chunk[64 * 1024];
+		size_t len;
+		while ( ( len = fread ( chunk, 1, sizeof ( chunk ), stdin ) ) > 0 )
+			buffer.append ( chunk, len );
+		data = buffer;
+	}
+	else if ( GzipReader::isGzip ( input_file ) )
+	{
+		GzipReader reader ( input_file );
+		for ( ; reader.next ( data ); reader.release() )
+			buffer.append ( data );
+		data = buffer;
+	}
+	else
+	{
+		file.reset ( new MappedFile ( input_file ) );
+		data = file->view();
+	}
+	size_t consumed ( manager.routeLines ( data ) );
+	if ( consumed < data.size() )
+		manager.route ( data.substr ( consumed ) );
+	manager.finish();
+	ErrorSummary errors ( manager.errors() );
+	if ( !errors.empty() )
+		manager.printErrorSummary ( std::cout );
+	return errors.empty();
+}
+
 int main ( int argc, char **argv )
 {
 	try
 	{
-		char foo[250];
+		std::string input_file;
+		std::string binary_file;
+		std::string restore_file;
+		std::string snapshot_file;
+		FlushPolicy::Policy flush_policy ( FlushPolicy::ON_EXIT );
+		size_t symbol_threads ( 0 );
+		size_t batch_size ( FeedHandler::f_default_batch_size );
+		bool pipelined ( false );
+		size_t parser_threads ( 0 );
+		size_t memory_sampling ( 0 );
+		int opt;
+		while ( ( opt = getopt ( argc, argv, "i:b:f:s:r:w:B:pj:m:" ) ) != -1 )
+		{
+			switch ( opt )
+			{
+			case 'i':
+				input_file = optarg;
+				break;
+			case 'b':
+				binary_file = optarg;
+				break;
+			case 'r':
+				restore_file = optarg;
+				break;
+			case 'w':
+				snapshot_file = optarg;
+				break;
+			case 'f':
+				if ( !parseFlushPolicy ( optarg, flush_policy ) )
+				{
+					usage();
+					return 1;
+				}
+				break;
+			case 's':
+				symbol_threads = atoi ( optarg );
+				if ( symbol_threads == 0 )
+				{
+					usage();
+					return 1;
+				}
+				break;
+			case 'p':
+				pipelined = true;
+				break;
+			case 'j':
+				parser_threads = atoi ( optarg );
+				if ( parser_threads == 0 )
+				{
+					usage();
+					return 1;
+				}
+				break;
+			case 'm':
+				memory_sampling = atoi ( optarg );
+				if ( memory_sampling == 0 )
+				{
+					usage();
+					return 1;
+				}
+				break;
+			case 'B':
+				batch_size = atoi ( optarg );
+				if ( batch_size == 0 )
+				{
+					usage();
+					return 1;
+				}
+				break;
+			default:
+				usage();
+				return 1;
+			}
+		}
+		// binary feeds don't have symbols or anything to parse, and snapshots and memory stats are of a single book
+		if ( ( !binary_file.empty() && ( !input_file.empty() || symbol_threads > 0 || pipelined ) ) ||
+				( symbol_threads > 0 && pipelined ) ||
+				( parser_threads > 0 && ( input_file.empty() || symbol_threads > 0 || pipelined ) ) ||
+				( symbol_threads > 0 && ( !restore_file.empty() || !snapshot_file.empty() || memory_sampling > 0 ) ) )
+		{
+			usage();
+			return 1;
+		}
 		std::cout.precision ( 8 );
-		if ( argc < 2 )
+		if ( optind >= argc )
 		{
 			std::cerr << "Have to supply a valid target-size" << std::endl;
+			usage();
 			return 1; // failure
 		}
-		const std::string sz ( argv[1] );
-		FeedHandler feed ( atoi ( sz.c_str() ) );
-		while ( fgets(foo,250,stdin) )
+		std::vector<uint32_t> target_sizes;
+		for ( int i = optind; i < argc; i++ )
+			target_sizes.push_back ( atoi ( argv[i] ) );
+		if ( symbol_threads > 0 )
+			return processSymbols ( target_sizes, symbol_threads, input_file, flush_policy );
+		FeedHandler feed ( target_sizes );
+		feed.setBatchSize ( batch_size );
+		// not on stdout, that's for the book
+		if ( memory_sampling > 0 )
+			feed.setMemorySampling ( memory_sampling, &std::cerr );
+		FdSink sink ( STDOUT_FILENO );
+		OutputWriter out ( sink, flush_policy );
+		InputPosition position ( binary_file.empty() ? InputPosition::TEXT_BYTES : InputPosition::BINARY_MESSAGES,
+								 !restore_file.empty() || !snapshot_file.empty() );
+		InputPosition taken ( position );
+		if ( !restore_file.empty() )
+		{
+			taken = Snapshot::restore ( feed, restore_file );
+			// bytes of text and binary messages don't go into each other at all
+			position.checkUnit ( taken );
+		}
+		if ( !binary_file.empty() )
+			processBinaryFile ( feed, binary_file, position, taken, out );
+		else if ( parser_threads > 0 )
+		{
+			// the chunks are cut out of the whole file
+			if ( GzipReader::isGzip ( input_file ) )
+				throw std::runtime_error ( "Can't parse a gzipped input-file in parallel" );
+			ParallelParser lines ( feed, out, parser_threads );
+			processMappedFile ( lines, input_file, position, taken );
+		}
+		else if ( pipelined )
+		{
+			Pipeline lines ( feed, out );
+			if ( input_file.empty() )
+				processStream ( lines, STDIN_FILENO, position, taken );
+			else
+				processInputFile ( lines, input_file, position, taken );
+		}
+		else
 		{
-			foo [ strlen(foo) -1 ] = '\0';
-			std::string line ( foo );
-			feed.processMessage ( line, std::cout );
+			InlineFeed lines = { feed, out };
+			if ( input_file.empty() )
+				processStream ( lines, STDIN_FILENO, position, taken );
+			else
+				processInputFile ( lines, input_file, position, taken );
 		}
+		// everything the book printed goes before the summary
+		out.flush();
+		if ( !snapshot_file.empty() )
+			Snapshot::save ( feed, position, snapshot_file );
 		if ( !feed.errors().empty() )
 			feed.printErrorSummary ( std::cout );
+		if ( memory_sampling > 0 )
+			feed.printMemorySummary ( std::cerr );
+#ifdef LATENCY_STATS
+		// not on stdout, that's for the book
+		LatencyStats::instance().print ( std::cerr );
+#endif
 		return feed.errors().empty();
 	}
 	catch ( std::exception & ex )
@@ -0,0 +1,64 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdexcept>
+
+#include "MappedFile.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		MappedFile::MappedFile ( std::string const & path ) :
+			m_data ( 0 ),
+			m_size ( 0 )
+		{
+			int fd ( open ( path.c_str(), O_RDONLY ) );
+			if ( fd < 0 )
+				throw std::runtime_error ( "Unable to open " + path );
+			struct stat st;
+			if ( fstat ( fd, &st ) < 0 )
+			{
+				close ( fd );
+				throw std::runtime_error ( "Unable to stat " + path );
+			}
+			m_size = static_cast < size_t > ( st.st_size );
+			// mmap refuses empty mappings, an empty file is just an empty view
+			if ( m_size > 0 )
+			{
+				void * addr ( mmap ( 0, m_size, PROT_READ, MAP_PRIVATE, fd, 0 ) );
+				if ( addr == MAP_FAILED )
+				{
+					close ( fd );
+					throw std::runtime_error ( "Unable to map " + path );
+				}
+				// we only ever walk the file front to back
+				madvise ( addr, m_size, MADV_SEQUENTIAL );
+				m_data = static_cast < const char * > ( addr );
+			}
+			// the mapping stays valid after the descriptor is gone
+			close ( fd );
+		}
+
+		MappedFile::~MappedFile()
+		{
+			if ( m_data )
+				munmap ( const_cast < char * > ( m_data ), m_size );
+		}
+
+		const char * MappedFile::data() const
+		{
+			return m_data;
+		}
+
+		size_t MappedFile::size() const
+		{
+			return m_size;
+		}
+
+		std::string_view MappedFile::view() const
+		{
+			return std::string_view ( m_data, m_size );
+		}
+	}
+}
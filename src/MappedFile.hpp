@@ -0,0 +1,34 @@
+#ifndef __MAPPED_FILE_HPP__
+#define __MAPPED_FILE_HPP__
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* A read-only memory mapping of a whole file. We hand out views straight into the mapped pages,
+		* so nothing gets copied on its way into the parser.
+		*/
+		class MappedFile
+		{
+		public:
+			MappedFile ( std::string const & path );
+			~MappedFile();
+
+			const char * data() const;
+			size_t size() const;
+			std::string_view view() const;
+		private:
+			MappedFile ( MappedFile const & rhs );
+			MappedFile & operator= ( MappedFile const & rhs );
+
+			const char * m_data;
+			size_t m_size;
+		};
+	}
+}
+
+#endif
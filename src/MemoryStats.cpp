@@ -0,0 +1,80 @@
+#include "MemoryStats.hpp"
+#include "SlabAllocator.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		MemoryUsage::MemoryUsage ( size_t bytes, size_t live ) :
+			bytes ( bytes ),
+			live ( live )
+		{
+		}
+
+		MemoryUsage & MemoryUsage::operator+= ( MemoryUsage const & rhs )
+		{
+			bytes += rhs.bytes;
+			live += rhs.live;
+			return *this;
+		}
+
+		MemoryUsage MemoryUsage::slabs()
+		{
+			MemoryUsage usage;
+			SlabRegistry::instance().forEach ( [&usage] ( SlabStatistics const & slab )
+			{
+				usage += MemoryUsage ( slab.bytes, slab.live * slab.object_bytes );
+			} );
+			return usage;
+		}
+
+		MemoryStats::MemoryStats() :
+			orders ( 0 ),
+			levels ( 0 ),
+			most_orders ( 0 ),
+			most_levels ( 0 )
+		{
+		}
+
+		MemoryUsage MemoryStats::total() const
+		{
+			MemoryUsage usage ( order_store );
+			usage += order_ids;
+			usage += buy_levels;
+			usage += sell_levels;
+			usage += node_slabs;
+			usage += buffers;
+			return usage;
+		}
+
+		double MemoryStats::bytesPerOrder() const
+		{
+			return orders ? double ( order_store.bytes + order_ids.bytes ) / orders : 0;
+		}
+
+		double MemoryStats::bytesPerLevel() const
+		{
+			return levels ? double ( buy_levels.bytes + sell_levels.bytes + node_slabs.bytes ) / levels : 0;
+		}
+
+		static void printUsage ( std::ostream & os, const char * name, MemoryUsage const & usage )
+		{
+			os << "[ MEMORY] " << name << ": " << usage.bytes << " bytes, " << usage.live << " live" << std::endl;
+		}
+
+		std::ostream& operator<< ( std::ostream& os, const MemoryStats& stats )
+		{
+			os << "[ MEMORY] Orders: " << stats.orders << " ( most " << stats.most_orders << " ), "
+			   << stats.bytesPerOrder() << " bytes each" << std::endl;
+			os << "[ MEMORY] Levels: " << stats.levels << " ( most " << stats.most_levels << " ), "
+			   << stats.bytesPerLevel() << " bytes each" << std::endl;
+			printUsage ( os, "Order store", stats.order_store );
+			printUsage ( os, "Order ids", stats.order_ids );
+			printUsage ( os, "Buy levels", stats.buy_levels );
+			printUsage ( os, "Sell levels", stats.sell_levels );
+			printUsage ( os, "Node slabs ( thread )", stats.node_slabs );
+			printUsage ( os, "Feed buffers", stats.buffers );
+			printUsage ( os, "Total", stats.total() );
+			return os;
+		}
+	}
+}
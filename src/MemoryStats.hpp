@@ -0,0 +1,64 @@
+#ifndef __MEMORY_STATS_HPP__
+#define __MEMORY_STATS_HPP__
+
+#include <stddef.h>
+#include <iostream>
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/* Bytes something holds on to, and how many of those hold anything right now */
+		struct MemoryUsage
+		{
+			MemoryUsage ( size_t bytes = 0, size_t live = 0 );
+			size_t bytes;
+			size_t live;
+
+			MemoryUsage & operator+= ( MemoryUsage const & rhs );
+
+			/* Roughly what the nodes of a std::map ( off the heap ) take: the value, three links and a colour */
+			template <class Map>
+			static size_t treeBytes ( Map const & map )
+			{
+				return map.size() * ( sizeof ( typename Map::value_type ) + 4 * sizeof ( void * ) );
+			}
+
+			/* Every slab on this thread added up */
+			static MemoryUsage slabs();
+		};
+
+		/*
+		* What a book holds, per structure, in bytes. Orders, slots and slab chunks get reused but never given back,
+		* so the bytes are also the most we ever held.
+		*
+		* The level nodes come out of the slabs, which are per thread and type ( see SlabAllocator ): node_slabs is every slab
+		* on the book's thread, whichever book on it the nodes are for.
+		*/
+		struct MemoryStats
+		{
+			MemoryStats();
+			size_t orders;
+			size_t levels;
+			// most there ever were at once
+			size_t most_orders;
+			size_t most_levels;
+			MemoryUsage order_store;
+			MemoryUsage order_ids;
+			// whatever either side's map holds itself, not its nodes
+			MemoryUsage buy_levels;
+			MemoryUsage sell_levels;
+			MemoryUsage node_slabs;
+			// the feed handler's own, nothing for a book
+			MemoryUsage buffers;
+
+			MemoryUsage total() const;
+			/* Order store and ids per live order */
+			double bytesPerOrder() const;
+			/* Maps and nodes per live level */
+			double bytesPerLevel() const;
+		};
+		std::ostream& operator<< ( std::ostream& os, const MemoryStats& stats );
+	}
+}
+
+#endif
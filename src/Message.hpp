@@ -0,0 +1,57 @@
+#ifndef __MESSAGE_HPP__
+#define __MESSAGE_HPP__
+
+#include <stdint.h>
+#include <string_view>
+
+#include "Order.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* Milliseconds since midnight, the way they come in: a plain number of at most 19 digits. We print it back
+		* with as many digits as it came in with, leading zeros and all.
+		*/
+		struct Timestamp
+		{
+			Timestamp ( uint64_t value = 0, uint32_t digits = 0 ) :
+				value ( value ),
+				digits ( digits )
+			{
+			}
+			uint64_t value;
+			// 0 is however many value takes
+			uint32_t digits;
+		};
+
+		namespace MessageType
+		{
+			enum Type
+			{
+				ADD,
+				REDUCE,
+				// didn't make sense, counted as a corrupted message
+				CORRUPTED,
+				// a reduce with a size we can't use, counted as out of bounds
+				WEIRD_NUMBERS
+			};
+		}
+
+		/*
+		* One line of the feed once it's been taken apart, whatever it was read from.
+		* Side and price only mean something for adds. The order id is a view into the input.
+		*/
+		struct Message
+		{
+			MessageType::Type type;
+			OrderSide::Side side;
+			Timestamp time;
+			std::string_view order_id;
+			uint32_t price;
+			uint32_t size;
+		};
+	}
+}
+
+#endif
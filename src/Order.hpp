@@ -1,13 +1,10 @@
 #ifndef __ORDER_HPP__
 #define __ORDER_HPP__
 
-#include <vector>
+#include <assert.h>
 #include <stdint.h>
-#include <ostream>
-#include <memory>
-#include <iostream>
 
-#include "PoolAllocator.hpp"
+#include "FixedPoint.hpp"
 
 namespace RgmInterview {
 	namespace OrderBook {
@@ -21,41 +18,60 @@ namespace RgmInterview {
 			};
 		}
 
-		class Order;
-		typedef Order * Order_ptr;
-
-		class Order
+		/*
+		* What an order looks like on its way into the book, in the book's ticks ( see FixedPoint ).
+		* Once it's in there, it lives in the OrderStore.
+		*/
+		template <class F>
+		class BasicOrder
 		{
 		public:
-			friend class OrderList;
-			Order();
-			Order (
-				OrderSide::Side side,
-				uint32_t volume,
-				uint32_t price );
+			typedef typename F::price_type Price;
+			typedef typename F::volume_type Volume;
+
+			BasicOrder() :
+				m_side ( OrderSide::BUY ),
+				m_volume ( 0 ),
+				m_price ( 0 )
+			{
+			}
 
-			friend class OrderBook;
-			OrderSide::Side side() const;
-			uint32_t volume() const;
-			uint32_t price() const;
+			BasicOrder (
+				OrderSide::Side side,
+				Volume volume,
+				Price price ) :
+				m_side ( side ),
+				m_volume ( volume ),
+				m_price ( price )
+			{
+				assert ( m_volume > 0 );
+				assert ( m_price > 0 );
+			}
 
-			static inline void* operator new ( std::size_t sz )
+			OrderSide::Side side() const
 			{
-				return PoolAllocator<Order>::instance().allocate ( sz ) ;
+				return m_side;
 			}
 
-			static inline void operator delete ( void* p )
+			Volume volume() const
 			{
-				PoolAllocator<Order>::instance().deallocate ( static_cast< Order * > ( p ), sizeof ( Order ) ) ;
+				return m_volume;
 			}
 
-			void reduce ( uint32_t volume );
+			Price price() const
+			{
+				return m_price;
+			}
 		private:
-			Order ( Order const & rhs ) {}
 			OrderSide::Side m_side;
-			uint32_t m_volume;
-			uint32_t m_price;
+			Volume m_volume;
+			Price m_price;
 		};
+
+		extern template class BasicOrder<WideFixedPoint>;
+		extern template class BasicOrder<NarrowFixedPoint>;
+
+		typedef BasicOrder<BookFixedPoint> Order;
 	}
 }
 
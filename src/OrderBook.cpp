@@ -1,34 +1,36 @@
 #include <algorithm>
 #include <assert.h>
-#include <functional>
 
-#include "Constants.hpp"
+#include "LatencyStats.hpp"
 #include "OrderBook.hpp"
 
 namespace RgmInterview {
 	namespace OrderBook {
 
-		OrderBook::OrderBook ( ErrorSummary & error_summary,
-							   uint32_t target_size ) :
+		template <class F>
+		BasicOrderBook<F>::BasicOrderBook ( ErrorSummary & error_summary,
+											uint32_t target_size ) :
+			BasicOrderBook ( error_summary, std::vector<uint32_t> ( 1, target_size ) )
+		{
+		}
+
+		template <class F>
+		BasicOrderBook<F>::BasicOrderBook ( ErrorSummary & error_summary,
+											std::vector<uint32_t> const & target_sizes ) :
 			m_error_summary ( error_summary ),
-			m_target_size ( target_size ),
-			m_buys ( target_size ),
-			m_sells ( target_size )
+			m_target_sizes ( target_sizes ),
+			m_buys ( target_sizes ),
+			m_sells ( target_sizes )
 		{
-			m_add_functors[ OrderSide::BUY ] = std::bind ( &OrderBook::add<BuyPriceLevelMap>, this, std::ref ( m_buys ), std::placeholders::_1 );
-			m_add_functors[ OrderSide::SELL ] = std::bind ( &OrderBook::add<SellPriceLevelMap>, this, std::ref ( m_sells ), std::placeholders::_1 );
-			m_reduce_functors [ OrderSide::BUY ] = std::bind ( &OrderBook::reduce<BuyPriceLevelMap>, this, std::ref ( m_buys ), std::placeholders::_1, std::placeholders::_2, std::placeholders::_3 );
-			m_reduce_functors [ OrderSide::SELL ] = std::bind ( &OrderBook::reduce<SellPriceLevelMap>, this, std::ref ( m_sells ), std::placeholders::_1, std::placeholders::_2, std::placeholders::_3 );
-			m_check_functors  [ OrderSide::BUY ] = std::bind ( &OrderBook::check<BuyPriceLevelMap>, this, std::ref ( m_buys ), OrderSide::BUY, std::placeholders::_1, std::placeholders::_2 );
-			m_check_functors  [ OrderSide::SELL ] = std::bind ( &OrderBook::check<SellPriceLevelMap>, this, std::ref ( m_sells ), OrderSide::SELL, std::placeholders::_1, std::placeholders::_2 );
-			m_last_values [ OrderSide::BUY ] = std::numeric_limits<uint32_t>::max();
-			m_last_values [ OrderSide::SELL ] = std::numeric_limits<uint32_t>::max();
+			m_last_values [ OrderSide::BUY ].assign ( target_sizes.size(), F::unknown );
+			m_last_values [ OrderSide::SELL ].assign ( target_sizes.size(), F::unknown );
 		}
 
 		/*
 		* The orderbook knows all about our orders, so should dealloc them here
 		*/
-		OrderBook::~OrderBook()
+		template <class F>
+		BasicOrderBook<F>::~BasicOrderBook()
 		{
 			m_buys.clear();
 			m_sells.clear();
@@ -39,18 +41,24 @@ namespace RgmInterview {
 		* and add the order to it.
 		* Returns true if succesful, false if the order already exists
 		*/
-		bool OrderBook::add ( Order_ptr const & order,
-							  std::string const & order_id,
-							  OrderSide::Side side,
-							  std::string const & time,
-							  std::ostream &os )
-		{
-			assert ( order->price() > 0 );
-			OrderDict::iterator iter ( m_all_orders.find ( order_id ) );
-			if ( iter == m_all_orders.end() )
+		template <class F>
+		bool BasicOrderBook<F>::add ( Order const & order,
+									  std::string_view order_id,
+									  Timestamp time,
+									  OutputWriter & out )
+		{
+			assert ( order.price() > 0 );
+			LATENCY_TIMER ( timer );
+			std::pair<size_t, bool> entry ( m_all_orders.insert ( order_id ) );
+			LATENCY_LAP ( LatencyStats::ORDER_DICT, timer );
+			if ( entry.second )
 			{
-				m_all_orders.insert ( std::make_pair ( order_id, m_add_functors [ side ] ( order ) ) );
-				m_check_functors [ side ] ( time, os );
+				OrderHandle handle ( m_orders.allocate ( order ) );
+				m_all_orders.value ( entry.first ) = handle;
+				if ( order.side() == OrderSide::BUY )
+					add<OrderSide::BUY> ( handle, time, out );
+				else
+					add<OrderSide::SELL> ( handle, time, out );
 				return true;
 			}
 			else
@@ -60,31 +68,139 @@ namespace RgmInterview {
 			}
 		}
 
-		template <class T>
-		OrderNode_list::iterator OrderBook::add ( T & map, Order_ptr const & order )
+		/*
+		* In two passes, so the second only needs what the first asked for and the misses within a pass overlap.
+		* The store is read straight away for the level of a reduce, those misses still overlap from one message to the next.
+		* The dict is looked at again when the messages are handled, but by then that's all in the cache.
+		* A small book is in the cache anyway, and all this would only cost us.
+		*/
+		template <class F>
+		void BasicOrderBook<F>::prefetch ( Message const * messages, size_t count ) const
+		{
+			if ( m_all_orders.size() < f_prefetch_orders )
+				return;
+			for ( size_t i = 0; i < count; i++ )
+			{
+				if ( messages[i].type == MessageType::ADD )
+				{
+					m_all_orders.prefetch ( messages[i].order_id );
+					Price price;
+					if ( F::fromFeedPrice ( messages[i].price, price ) )
+						prefetchLevel ( messages[i].side, price );
+				}
+				else if ( messages[i].type == MessageType::REDUCE )
+					m_all_orders.prefetch ( messages[i].order_id );
+			}
+			for ( size_t i = 0; i < count; i++ )
+			{
+				if ( messages[i].type != MessageType::REDUCE )
+					continue;
+				size_t pos ( m_all_orders.find ( messages[i].order_id ) );
+				if ( pos != OrderDict::npos )
+				{
+					OrderHandle order ( m_all_orders.value ( pos ) );
+					m_orders.prefetch ( order );
+					prefetchLevel ( m_orders.side ( order ), m_orders.price ( order ) );
+				}
+			}
+		}
+
+		template <class F>
+		void BasicOrderBook<F>::prefetchLevel ( OrderSide::Side side, Price price ) const
+		{
+			if ( side == OrderSide::BUY )
+				m_buys.prefetch ( price );
+			else
+				m_sells.prefetch ( price );
+		}
+
+		template <class F>
+		void BasicOrderBook<F>::depth ( BookDepth & out ) const
+		{
+			depthOf ( m_buys, out.depth, out.levels[OrderSide::BUY] );
+			depthOf ( m_sells, out.depth, out.levels[OrderSide::SELL] );
+			for ( size_t side = 0; side < 2; side++ )
+			{
+				out.costs[side].resize ( m_last_values[side].size() );
+				std::transform ( m_last_values[side].begin(), m_last_values[side].end(), out.costs[side].begin(), feedCost );
+			}
+		}
+
+		template <class F>
+		template <class Map>
+		void BasicOrderBook<F>::depthOf ( Map const & levels, size_t depth, std::vector<DepthLevel> & out )
+		{
+			out.clear();
+			for ( typename Map::const_iterator level = levels.begin(); level != levels.end() && out.size() < depth; ++level )
+				out.push_back ( DepthLevel { F::toFeedPrice ( level->first ), level->second.total_volume, level->second.size() } );
+		}
+
+		template <class F>
+		uint64_t BasicOrderBook<F>::feedCost ( Value value )
+		{
+			return value == F::unknown ? OutputWriter::f_no_cost : F::toFeedValue ( value );
+		}
+
+		template <class F>
+		void BasicOrderBook<F>::enableSweeps()
 		{
-			OrderList_ptr & list ( map.add ( order->price() ) );
-			assert ( list->total_volume >= 0 );
-			map.total_volume += order->volume();
-			list->total_volume += order->volume();
-			assert ( list->total_volume > 0 );
-			OrderNode_list::iterator return_iter = list->add ( order );
-			assert ( ( *return_iter ) == order );
-			return return_iter;
+			m_buys.enable_sweeps();
+			m_sells.enable_sweeps();
 		}
 
-		void OrderBook::reduce ( std::string const & order_id,
-								 uint32_t volume,
-								 std::string const & time,
-								 std::ostream &os )
+		template <class F>
+		MemoryStats BasicOrderBook<F>::memoryStats() const
 		{
-			OrderDict::iterator iter ( m_all_orders.find ( order_id ) );
-			if ( iter != m_all_orders.end() )
+			MemoryStats stats;
+			stats.orders = m_orders.size();
+			stats.levels = m_buys.size() + m_sells.size();
+			stats.most_orders = m_orders.high_water_mark();
+			stats.most_levels = m_buys.most_levels() + m_sells.most_levels();
+			stats.order_store = MemoryUsage ( m_orders.bytes(), m_orders.size() * OrderStore::f_order_bytes );
+			stats.order_ids = MemoryUsage ( m_all_orders.bytes(), m_all_orders.live_bytes() );
+			stats.buy_levels = m_buys.memory();
+			stats.sell_levels = m_sells.memory();
+			stats.node_slabs = MemoryUsage::slabs();
+			return stats;
+		}
+
+		template <class F>
+		void BasicOrderBook<F>::reserve ( size_t expected_orders )
+		{
+			m_orders.reserve ( expected_orders );
+			m_all_orders.reserve ( expected_orders );
+		}
+
+		template <class F>
+		template <OrderSide::Side S>
+		void BasicOrderBook<F>::add ( OrderHandle order,
+									  Timestamp time,
+									  OutputWriter & out )
+		{
+			LATENCY_TIMER ( timer );
+			LATENCY_ONLY ( size_t levels ( this->levels<S>().size() ) );
+			this->levels<S>().add ( m_orders, order );
+			LATENCY_LAP ( this->levels<S>().size() > levels ? LatencyStats::ADD_NEW_LEVEL : LatencyStats::ADD_EXISTING_LEVEL, timer );
+			LATENCY_ONLY ( uint64_t walks ( LatencyStats::instance().counter ( LatencyStats::LEVEL_WALKS ) ) );
+			check<S> ( time, out );
+			LATENCY_LAP ( LatencyStats::instance().counter ( LatencyStats::LEVEL_WALKS ) > walks ? LatencyStats::CHECK_RECOMPUTED : LatencyStats::CHECK_CACHED, timer );
+		}
+
+		template <class F>
+		void BasicOrderBook<F>::reduce ( std::string_view order_id,
+										 Volume volume,
+										 Timestamp time,
+										 OutputWriter & out )
+		{
+			LATENCY_TIMER ( timer );
+			size_t pos ( m_all_orders.find ( order_id ) );
+			LATENCY_LAP ( LatencyStats::ORDER_DICT, timer );
+			if ( pos != OrderDict::npos )
 			{
-				Order_ptr const & order ( ( *iter->second ) );
-				OrderSide::Side side ( order->side() );
-				m_reduce_functors [ side ] ( order_id, iter->second, volume );
-				m_check_functors [ side ] ( time, os );
+				if ( m_orders.side ( m_all_orders.value ( pos ) ) == OrderSide::BUY )
+					reduce<OrderSide::BUY> ( pos, volume, time, out );
+				else
+					reduce<OrderSide::SELL> ( pos, volume, time, out );
 			}
 			else
 			{
@@ -92,34 +208,46 @@ namespace RgmInterview {
 			}
 		}
 
-		template <class T>
-		void OrderBook::reduce ( T & map,
-								 std::string const & order_id,
-								 OrderNode_list::iterator & order_iter,
-								 uint32_t volume )
+		template <class F>
+		template <OrderSide::Side S>
+		void BasicOrderBook<F>::reduce ( size_t order_pos,
+										 Volume volume,
+										 Timestamp time,
+										 OutputWriter & out )
 		{
-			if ( map.reduce ( order_iter, volume ) )
-				m_all_orders.erase ( order_id );
+			LATENCY_TIMER ( timer );
+			LATENCY_ONLY ( size_t levels ( this->levels<S>().size() ) );
+			if ( this->levels<S>().reduce ( m_orders, m_all_orders.value ( order_pos ), volume ) )
+				m_all_orders.erase ( order_pos );
+			LATENCY_LAP ( this->levels<S>().size() < levels ? LatencyStats::REDUCE_REMOVE_LEVEL : LatencyStats::REDUCE_KEEP_LEVEL, timer );
+			LATENCY_ONLY ( uint64_t walks ( LatencyStats::instance().counter ( LatencyStats::LEVEL_WALKS ) ) );
+			check<S> ( time, out );
+			LATENCY_LAP ( LatencyStats::instance().counter ( LatencyStats::LEVEL_WALKS ) > walks ? LatencyStats::CHECK_RECOMPUTED : LatencyStats::CHECK_CACHED, timer );
 		}
 
-		template <class T>
-		void OrderBook::check ( T  & map,
-								OrderSide::Side side,
-								std::string const & time,
-								std::ostream &os )
+		template <class F>
+		template <OrderSide::Side S>
+		void BasicOrderBook<F>::check ( Timestamp time,
+										OutputWriter & out )
 		{
-			uint32_t new_value ( map.get_total_value ( ) );
-			if ( m_last_values [ side ] != new_value )
+			// the buys are what we'd get for selling, so they print as S and the other way around
+			const char action ( S == OrderSide::BUY ? 'S' : 'B' );
+			bool tagged ( m_target_sizes.size() > 1 );
+			for ( size_t target = 0; target < m_target_sizes.size(); target++ )
 			{
-				m_last_values [ side ] = new_value;
-				if ( new_value != std::numeric_limits<uint32_t>::max() )
-				{
-					double val ( new_value / Constants::round_size );
-					printf ( "%s %c %0.2f\n", time.c_str(), ( side == OrderSide::BUY ? 'S' : 'B' ), val );
-				}
+				Value new_value ( levels<S>().get_total_value ( target ) );
+				if ( m_last_values [ S ][ target ] == new_value )
+					continue;
+				m_last_values [ S ][ target ] = new_value;
+				uint64_t cost ( feedCost ( new_value ) );
+				if ( tagged )
+					out.writeCost ( m_target_sizes[target], time, action, cost );
 				else
-					printf ( "%s %c NA\n", time.c_str(), ( side == OrderSide::BUY ? 'S' : 'B' ) );
+					out.writeCost ( time, action, cost );
 			}
 		}
+
+		template class BasicOrderBook<WideFixedPoint>;
+		template class BasicOrderBook<NarrowFixedPoint>;
 	}
 }
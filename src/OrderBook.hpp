@@ -2,36 +2,84 @@
 #define __ORDER_BOOK_HPP__
 
 #include <map>
-#include <unordered_map>
 #include <functional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "Order.hpp"
 #include "PriceLevelMap.hpp"
+#include "LadderPriceLevelMap.hpp"
 #include "OrderList.hpp"
+#include "OrderStore.hpp"
+#include "DepthPublisher.hpp"
 #include "ErrorSummary.hpp"
+#include "MemoryStats.hpp"
+#include "Message.hpp"
+#include "OrderIdIndex.hpp"
+#include "OutputWriter.hpp"
 
 namespace RgmInterview {
 	namespace OrderBook {
-		class OrderBook
+
+		/*
+		* F is the FixedPoint the book keeps its prices, volumes and costs in. Orders come in in its units,
+		* target sizes and the costs we write out are in the feed's.
+		*/
+		template <class F>
+		class BasicOrderBook
 		{
 		public:
-			typedef PriceLevelMap < std::greater<uint32_t> > BuyPriceLevelMap;
-			typedef PriceLevelMap < std::less<uint32_t> > SellPriceLevelMap;
-
-			OrderBook ( ErrorSummary & error_summary,
-						uint32_t target_size );
-			~OrderBook();
-
-			bool add ( Order_ptr const & order,
-					   std::string const & order_id,
-					   OrderSide::Side side,
-					   std::string const & time,
-					   std::ostream &os ) ;
-			void reduce ( std::string const & order_id,
-						  uint32_t volume,
-						  std::string const & time,
-						  std::ostream &os ) ;
+			typedef typename F::price_type Price;
+			typedef typename F::volume_type Volume;
+			typedef typename F::value_type Value;
+			typedef BasicOrder<F> Order;
+			typedef BasicOrderStore<F> OrderStore;
+
+#ifdef PRICE_LADDER
+			typedef LadderPriceLevelMap < std::greater<Price>, F > BuyPriceLevelMap;
+			typedef LadderPriceLevelMap < std::less<Price>, F > SellPriceLevelMap;
+#else
+			typedef PriceLevelMap < std::greater<Price>, F > BuyPriceLevelMap;
+			typedef PriceLevelMap < std::less<Price>, F > SellPriceLevelMap;
+#endif
+
+			BasicOrderBook ( ErrorSummary & error_summary,
+							 uint32_t target_size );
+			/* Prices every one of the target sizes, output lines start with the target size if there's more than one */
+			BasicOrderBook ( ErrorSummary & error_summary,
+							 std::vector<uint32_t> const & target_sizes );
+			~BasicOrderBook();
+
+			bool add ( Order const & order,
+					   std::string_view order_id,
+					   Timestamp time,
+					   OutputWriter & out ) ;
+			void reduce ( std::string_view order_id,
+						  Volume volume,
+						  Timestamp time,
+						  OutputWriter & out ) ;
+
+			/*
+			* Start pulling in whatever handling these messages is going to touch: the dict slots of their ids,
+			* the orders the reduces are for and the levels all of them go to. Nothing changes, see FeedHandler::processBatch.
+			*/
+			void prefetch ( Message const * messages, size_t count ) const;
+
+			/* The top out.depth levels of either side and the last costs we printed, in the feed's units, time is left alone */
+			void depth ( BookDepth & out ) const;
+
+			/* Both sides keep prefix sums of their levels from here on, for cost_for and size_for_budget in O(log window) */
+			void enableSweeps();
+
+			/*
+			* What every structure of the book takes, worked out on the spot ( the long ids get walked ). The slabs are
+			* the whole thread's, and the most levels is each side's most added up.
+			*/
+			MemoryStats memoryStats() const;
+
+			/* Size the order store and id index up front, if we know roughly how many live orders to expect */
+			void reserve ( size_t expected_orders );
 
 			BuyPriceLevelMap const & buys() const
 			{
@@ -42,44 +90,68 @@ namespace RgmInterview {
 			{
 				return m_sells;
 			}
+
+			OrderStore const & orders() const
+			{
+				return m_orders;
+			}
 		private:
-			typedef std::unordered_map < std::string, OrderNode_list::iterator > OrderDict;
+			friend class Snapshot;
+
+			// below this many live orders the book is in the cache and prefetching doesn't pay
+			static const size_t f_prefetch_orders = 64 * 1024;
+
+			typedef OrderIdIndex < OrderHandle > OrderDict;
 
 			ErrorSummary & m_error_summary;
-			uint32_t m_target_size;
+			std::vector<uint32_t> m_target_sizes;
+			OrderStore m_orders;
 			BuyPriceLevelMap m_buys;
 			SellPriceLevelMap m_sells;
 			OrderDict m_all_orders;
 
+			// last value we printed, per side and target
+			std::vector<Value> m_last_values[2];
+
 			/*
-			* When we need to operate on an (Buy/Sell)OrderMap, we just use these bound functions.
-			* They are indexed by order type, and we don't have to supply the map or comparison operator anymore.
+			* Everything past the order dict is done by the half of the book for the order's side. The side is picked
+			* with a single branch and is a template parameter from there on, so the map calls all get inlined.
 			*/
-			typedef std::function<OrderNode_list::iterator ( Order_ptr const & ) > Add_functor;
-			typedef std::function<void ( std::string const &, OrderNode_list::iterator &, uint32_t ) > Reduce_functor;
-			typedef std::function<void ( std::string const &, std::ostream & ) > Check_functor;
-			Add_functor m_add_functors[2];
-			Reduce_functor m_reduce_functors[2];
-			Check_functor m_check_functors[2];
-			uint32_t m_last_values[2];
-
-			template <class T>
-			OrderNode_list::iterator add ( T & map,
-										   Order_ptr const & order );
-
-			template <class T>
-			inline void reduce ( T & map,
-								 std::string const & order_id,
-								 OrderNode_list::iterator & order,
-								 uint32_t volume );
-
-			template <class T>
-			void check ( T & map,
-						 OrderSide::Side side,
-						 std::string const & time,
-						 std::ostream &os );
+			template <OrderSide::Side S>
+			auto & levels()
+			{
+				if constexpr ( S == OrderSide::BUY )
+					return m_buys;
+				else
+					return m_sells;
+			}
+
+			void prefetchLevel ( OrderSide::Side side, Price price ) const;
+
+			template <class Map>
+			static void depthOf ( Map const & levels, size_t depth, std::vector<DepthLevel> & out );
+			static uint64_t feedCost ( Value value );
+
+			template <OrderSide::Side S>
+			void add ( OrderHandle order,
+					   Timestamp time,
+					   OutputWriter & out );
+
+			template <OrderSide::Side S>
+			void reduce ( size_t order_pos,
+						  Volume volume,
+						  Timestamp time,
+						  OutputWriter & out );
+
+			template <OrderSide::Side S>
+			void check ( Timestamp time,
+						 OutputWriter & out );
 		};
 
+		extern template class BasicOrderBook<WideFixedPoint>;
+		extern template class BasicOrderBook<NarrowFixedPoint>;
+
+		typedef BasicOrderBook<BookFixedPoint> OrderBook;
 		typedef OrderBook * OrderBook_ptr;
 	}
 }
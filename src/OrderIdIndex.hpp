@@ -0,0 +1,317 @@
+#ifndef __ORDER_ID_INDEX_HPP__
+#define __ORDER_ID_INDEX_HPP__
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* Open addressing ( linear probing ) table from order id to V.
+		*
+		* Ids of up to 16 bytes are packed into two integers and stored inline in the slot, so lookups don't chase
+		* any pointers and adding an order doesn't allocate. Longer ids live in a side table and the slot just refers to them.
+		* Deleting shifts the following entries back instead of leaving tombstones, so the table never needs a cleanup
+		* no matter how many orders come and go.
+		*
+		* Positions handed out by find/insert are valid until the next insert or erase.
+		*/
+		template <class V>
+		class OrderIdIndex
+		{
+		public:
+			static const size_t npos = static_cast < size_t > ( -1 );
+
+			OrderIdIndex ( size_t expected_size = 0 ) :
+				m_size ( 0 ),
+				m_mask ( 0 )
+			{
+				rehash ( capacityFor ( expected_size ) );
+			}
+
+			/* Start pulling in the slot the id would be found in, so a find or insert shortly after doesn't have to wait for it */
+			void prefetch ( std::string_view id ) const
+			{
+				__builtin_prefetch ( &m_slots[makeKey ( id ).hash & m_mask] );
+			}
+
+			/* Returns the position of the id, or npos */
+			size_t find ( std::string_view id ) const
+			{
+				Key key ( makeKey ( id ) );
+				for ( size_t pos = key.hash & m_mask; ; pos = ( pos + 1 ) & m_mask )
+				{
+					Slot const & slot ( m_slots[pos] );
+					if ( slot.key.meta == f_empty )
+						return npos;
+					if ( matches ( slot.key, key, id ) )
+						return pos;
+				}
+			}
+
+			/* Returns the position of the id and true if we added it, false if it was already there */
+			std::pair<size_t, bool> insert ( std::string_view id )
+			{
+				if ( ( m_size + 1 ) * f_max_load_den > m_slots.size() * f_max_load_num )
+					rehash ( m_slots.size() * 2 );
+				Key key ( makeKey ( id ) );
+				size_t pos ( key.hash & m_mask );
+				for ( ; m_slots[pos].key.meta != f_empty; pos = ( pos + 1 ) & m_mask )
+				{
+					if ( matches ( m_slots[pos].key, key, id ) )
+						return std::make_pair ( pos, false );
+				}
+				if ( key.meta == f_long )
+					key.k0 = storeLongKey ( id );
+				m_slots[pos].key = key;
+				m_slots[pos].value = V();
+				m_size++;
+				return std::make_pair ( pos, true );
+			}
+
+			V & value ( size_t pos )
+			{
+				assert ( m_slots[pos].key.meta != f_empty );
+				return m_slots[pos].value;
+			}
+
+			V const & value ( size_t pos ) const
+			{
+				assert ( m_slots[pos].key.meta != f_empty );
+				return m_slots[pos].value;
+			}
+
+			/* Removes the entry and shifts back whatever was probing past it */
+			void erase ( size_t pos )
+			{
+				assert ( m_slots[pos].key.meta != f_empty );
+				if ( m_slots[pos].key.meta == f_long )
+					releaseLongKey ( m_slots[pos].key.k0 );
+				size_t hole ( pos );
+				for ( size_t next = ( hole + 1 ) & m_mask; m_slots[next].key.meta != f_empty; next = ( next + 1 ) & m_mask )
+				{
+					size_t home ( m_slots[next].key.hash & m_mask );
+					// only move entries whose home isn't in ( hole, next ]
+					if ( ( ( next - home ) & m_mask ) >= ( ( next - hole ) & m_mask ) )
+					{
+						m_slots[hole] = m_slots[next];
+						hole = next;
+					}
+				}
+				m_slots[hole].key.meta = f_empty;
+				m_slots[hole].value = V();
+				m_size--;
+			}
+
+			bool erase ( std::string_view id )
+			{
+				size_t pos ( find ( id ) );
+				if ( pos == npos )
+					return false;
+				erase ( pos );
+				return true;
+			}
+
+			/* Make sure we can hold this many ids without growing */
+			void reserve ( size_t expected_size )
+			{
+				size_t capacity ( capacityFor ( expected_size ) );
+				if ( capacity > m_slots.size() )
+					rehash ( capacity );
+			}
+
+			size_t size() const
+			{
+				return m_size;
+			}
+
+			bool empty() const
+			{
+				return m_size == 0;
+			}
+
+			/* Number of slots, we grow when more than 3/4 of them are taken */
+			size_t capacity() const
+			{
+				return m_slots.size();
+			}
+
+			/* What the slots and the long ids take */
+			size_t bytes() const
+			{
+				size_t bytes ( m_slots.capacity() * sizeof ( Slot ) + m_long_keys.capacity() * sizeof ( std::string ) +
+							   m_free_long_keys.capacity() * sizeof ( uint64_t ) );
+				for ( std::string const & key : m_long_keys )
+					bytes += heapBytes ( key );
+				return bytes;
+			}
+
+			/* Just what holds the ids there are now */
+			size_t live_bytes() const
+			{
+				size_t bytes ( m_size * sizeof ( Slot ) );
+				for ( std::string const & key : m_long_keys )
+					if ( !key.empty() )
+						bytes += sizeof ( std::string ) + heapBytes ( key );
+				return bytes;
+			}
+
+			/* Calls f ( id, value ) for every entry, in no particular order. The id is only good during the call */
+			template <class F>
+			void forEach ( F f ) const
+			{
+				for ( Slot const & slot : m_slots )
+				{
+					if ( slot.key.meta == f_empty )
+						continue;
+					if ( slot.key.meta == f_long )
+					{
+						f ( std::string_view ( m_long_keys[slot.key.k0] ), slot.value );
+						continue;
+					}
+					char packed[f_inline_length];
+					memcpy ( packed, &slot.key.k0, sizeof ( slot.key.k0 ) );
+					memcpy ( packed + sizeof ( slot.key.k0 ), &slot.key.k1, sizeof ( slot.key.k1 ) );
+					f ( std::string_view ( packed, slot.key.meta - 1 ), slot.value );
+				}
+			}
+
+			void clear()
+			{
+				for ( Slot & slot : m_slots )
+					slot = Slot();
+				m_long_keys.clear();
+				m_free_long_keys.clear();
+				m_size = 0;
+			}
+
+		private:
+			static const uint8_t f_empty = 0;
+			static const uint8_t f_long = 0xff;
+			static const size_t f_inline_length = 16;
+			static const size_t f_min_capacity = 64;
+			static const size_t f_max_load_num = 3;
+			static const size_t f_max_load_den = 4;
+
+			/* meta is 0 for an empty slot, length + 1 for inline ids and f_long for ids in the side table */
+			struct Key
+			{
+				uint64_t k0;
+				uint64_t k1;
+				uint32_t hash;
+				uint8_t meta;
+				Key() : k0 ( 0 ), k1 ( 0 ), hash ( 0 ), meta ( f_empty ) {}
+			};
+
+			struct Slot
+			{
+				Key key;
+				V value;
+				Slot() : value() {}
+			};
+
+			std::vector<Slot> m_slots;
+			size_t m_size;
+			size_t m_mask;
+			std::vector<std::string> m_long_keys;
+			std::vector<uint64_t> m_free_long_keys;
+
+			static size_t capacityFor ( size_t expected_size )
+			{
+				size_t capacity ( f_min_capacity );
+				while ( capacity * f_max_load_num < expected_size * f_max_load_den )
+					capacity *= 2;
+				return capacity;
+			}
+
+			/* Whatever the string had to get off the heap, short ones fit in the string itself */
+			static size_t heapBytes ( std::string const & key )
+			{
+				return key.capacity() > std::string().capacity() ? key.capacity() + 1 : 0;
+			}
+
+			static uint64_t mix ( uint64_t h )
+			{
+				h ^= h >> 31;
+				h *= 0xbf58476d1ce4e5b9ULL;
+				h ^= h >> 29;
+				h *= 0x94d049bb133111ebULL;
+				h ^= h >> 32;
+				return h;
+			}
+
+			static Key makeKey ( std::string_view id )
+			{
+				Key key;
+				if ( id.size() <= f_inline_length )
+				{
+					char packed[f_inline_length] = { 0 };
+					memcpy ( packed, id.data(), id.size() );
+					memcpy ( &key.k0, packed, sizeof ( key.k0 ) );
+					memcpy ( &key.k1, packed + sizeof ( key.k0 ), sizeof ( key.k1 ) );
+					key.meta = static_cast < uint8_t > ( id.size() + 1 );
+					key.hash = static_cast < uint32_t > ( mix ( key.k0 * 0x9e3779b97f4a7c15ULL ^ ( key.k1 + key.meta ) ) );
+				}
+				else
+				{
+					key.meta = f_long;
+					key.hash = static_cast < uint32_t > ( mix ( std::hash<std::string_view>() ( id ) ) );
+				}
+				return key;
+			}
+
+			bool matches ( Key const & stored, Key const & key, std::string_view id ) const
+			{
+				if ( stored.meta != key.meta || stored.hash != key.hash )
+					return false;
+				if ( key.meta == f_long )
+					return m_long_keys[stored.k0] == id;
+				return stored.k0 == key.k0 && stored.k1 == key.k1;
+			}
+
+			uint64_t storeLongKey ( std::string_view id )
+			{
+				if ( m_free_long_keys.empty() )
+				{
+					m_long_keys.push_back ( std::string ( id ) );
+					return m_long_keys.size() - 1;
+				}
+				uint64_t index ( m_free_long_keys.back() );
+				m_free_long_keys.pop_back();
+				m_long_keys[index].assign ( id.data(), id.size() );
+				return index;
+			}
+
+			void releaseLongKey ( uint64_t index )
+			{
+				m_long_keys[index].clear();
+				m_free_long_keys.push_back ( index );
+			}
+
+			void rehash ( size_t capacity )
+			{
+				std::vector<Slot> old_slots ( capacity );
+				old_slots.swap ( m_slots );
+				m_mask = capacity - 1;
+				for ( Slot const & slot : old_slots )
+				{
+					if ( slot.key.meta == f_empty )
+						continue;
+					size_t pos ( slot.key.hash & m_mask );
+					while ( m_slots[pos].key.meta != f_empty )
+						pos = ( pos + 1 ) & m_mask;
+					m_slots[pos] = slot;
+				}
+			}
+		};
+	}
+}
+
+#endif
@@ -1,46 +1,88 @@
 #ifndef __ORDER_LIST_HPP__
 #define __ORDER_LIST_HPP__
 
+#include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
-#include <list>
-#include <memory>
-
-#include "Order.hpp"
-#include "PoolAllocator.hpp"
 
+#include "OrderStore.hpp"
 
 namespace RgmInterview {
 	namespace OrderBook {
 
-		typedef std::list < Order_ptr > OrderNode_list;
-
-		class OrderList
+		/*
+		* The orders at one price level, oldest first. This is just the head and tail of a chain that runs through
+		* the OrderStore, so a level is held by value and adding or removing an order never allocates.
+		*/
+		template <class F>
+		class BasicOrderList
 		{
 		public:
-			uint32_t total_volume;
-			OrderList();
-			~OrderList();
-			OrderNode_list::iterator add ( Order_ptr const & order );
-			void remove ( OrderNode_list::iterator const & order_iter );
-			bool empty() const;
-			size_t size() const;
-			OrderNode_list::iterator begin();
-			OrderNode_list::iterator end();
-			static inline void* operator new ( std::size_t sz )
+			typedef BasicOrderStore<F> Store;
+
+			typename F::volume_type total_volume;
+
+			BasicOrderList() : total_volume ( 0 ),
+				m_head ( Store::f_none ),
+				m_tail ( Store::f_none ),
+				m_size ( 0 )
+			{
+				assert ( total_volume == 0 );
+			}
+
+			void add ( Store & orders, OrderHandle order )
+			{
+				orders.link ( order, m_tail, Store::f_none );
+				if ( m_tail != Store::f_none )
+					orders.setNext ( m_tail, order );
+				else
+					m_head = order;
+				m_tail = order;
+				m_size++;
+			}
+
+			void remove ( Store & orders, OrderHandle order )
 			{
-				return PoolAllocator<OrderList>::instance().allocate ( sz ) ;
+				assert ( m_size > 0 );
+				OrderHandle prev ( orders.prev ( order ) );
+				OrderHandle next ( orders.next ( order ) );
+				if ( prev != Store::f_none )
+					orders.setNext ( prev, next );
+				else
+					m_head = next;
+				if ( next != Store::f_none )
+					orders.setPrev ( next, prev );
+				else
+					m_tail = prev;
+				orders.link ( order, Store::f_none, Store::f_none );
+				m_size--;
 			}
 
-			static inline void operator delete ( void* p )
+			bool empty() const
 			{
-				PoolAllocator<OrderList>::instance().deallocate ( static_cast< OrderList * > ( p ), sizeof ( OrderList ) ) ;
+				return m_size == 0;
+			}
+
+			size_t size() const
+			{
+				return m_size;
+			}
+
+			/* Oldest order, follow OrderStore::next from there. OrderStore::f_none if we're empty */
+			OrderHandle front() const
+			{
+				return m_head;
 			}
 		private:
-			;
-			OrderList ( OrderList const & rhs ) {}
-			OrderNode_list m_list;
+			OrderHandle m_head;
+			OrderHandle m_tail;
+			uint32_t m_size;
 		};
-		typedef std::shared_ptr < OrderList > OrderList_ptr;
+
+		extern template class BasicOrderList<WideFixedPoint>;
+		extern template class BasicOrderList<NarrowFixedPoint>;
+
+		typedef BasicOrderList<BookFixedPoint> OrderList;
 	}
 }
 
@@ -0,0 +1,9 @@
+#include "OrderStore.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		template class BasicOrderStore<WideFixedPoint>;
+		template class BasicOrderStore<NarrowFixedPoint>;
+	}
+}
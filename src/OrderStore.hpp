@@ -0,0 +1,200 @@
+#ifndef __ORDER_STORE_HPP__
+#define __ORDER_STORE_HPP__
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Order.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		typedef uint32_t OrderHandle;
+
+		/*
+		* Every live order in the book, kept as a struct of arrays and addressed by a 32 bit handle.
+		*
+		* The prev/next links are what chains the orders of a price level into a FIFO ( see OrderList ), so a level
+		* doesn't need any memory of its own per order. Released handles are chained through the same next links and
+		* handed out again first, so once the arrays have grown to the size of the book nothing gets allocated anymore.
+		*/
+		template <class F>
+		class BasicOrderStore
+		{
+		public:
+			typedef typename F::price_type Price;
+			typedef typename F::volume_type Volume;
+
+			static constexpr OrderHandle f_none = static_cast < OrderHandle > ( -1 );
+			// what we keep per order
+			static constexpr size_t f_order_bytes = sizeof ( Price ) + sizeof ( Volume ) + 2 * sizeof ( OrderHandle ) + sizeof ( uint8_t );
+
+			BasicOrderStore() :
+				m_free ( f_none ),
+				m_size ( 0 )
+			{
+			}
+
+			OrderHandle allocate ( BasicOrder<F> const & order )
+			{
+				OrderHandle handle ( m_free );
+				if ( handle != f_none )
+					m_free = m_next[handle];
+				else
+				{
+					handle = static_cast < OrderHandle > ( m_prices.size() );
+					assert ( handle != f_none );
+					m_prices.push_back ( 0 );
+					m_volumes.push_back ( 0 );
+					m_next.push_back ( f_none );
+					m_prev.push_back ( f_none );
+					m_sides.push_back ( 0 );
+				}
+				m_prices[handle] = order.price();
+				m_volumes[handle] = order.volume();
+				m_sides[handle] = static_cast < uint8_t > ( order.side() );
+				m_next[handle] = f_none;
+				m_prev[handle] = f_none;
+				m_size++;
+				return handle;
+			}
+
+			void release ( OrderHandle order )
+			{
+				assert ( m_size > 0 );
+				m_volumes[order] = 0;
+				m_prev[order] = f_none;
+				m_next[order] = m_free;
+				m_free = order;
+				m_size--;
+			}
+
+			void reserve ( size_t orders )
+			{
+				m_prices.reserve ( orders );
+				m_volumes.reserve ( orders );
+				m_next.reserve ( orders );
+				m_prev.reserve ( orders );
+				m_sides.reserve ( orders );
+			}
+
+			void clear()
+			{
+				m_prices.clear();
+				m_volumes.clear();
+				m_next.clear();
+				m_prev.clear();
+				m_sides.clear();
+				m_free = f_none;
+				m_size = 0;
+			}
+
+			/* Number of live orders */
+			size_t size() const
+			{
+				return m_size;
+			}
+
+			/* Number of orders we have room for without growing */
+			size_t capacity() const
+			{
+				return m_prices.capacity();
+			}
+
+			/* Most live orders there ever were at once, handles only get new ones when there's none to reuse */
+			size_t high_water_mark() const
+			{
+				return m_prices.size();
+			}
+
+			/* What the arrays take, room we haven't used yet included */
+			size_t bytes() const
+			{
+				return m_prices.capacity() * sizeof ( Price ) + m_volumes.capacity() * sizeof ( Volume ) +
+					   ( m_next.capacity() + m_prev.capacity() ) * sizeof ( OrderHandle ) + m_sides.capacity();
+			}
+
+			/* Start pulling in everything about the order */
+			void prefetch ( OrderHandle order ) const
+			{
+				assert ( order < m_prices.size() );
+				__builtin_prefetch ( &m_prices[order] );
+				__builtin_prefetch ( &m_volumes[order] );
+				__builtin_prefetch ( &m_next[order] );
+				__builtin_prefetch ( &m_prev[order] );
+				__builtin_prefetch ( &m_sides[order] );
+			}
+
+			OrderSide::Side side ( OrderHandle order ) const
+			{
+				assert ( order < m_sides.size() );
+				return static_cast < OrderSide::Side > ( m_sides[order] );
+			}
+
+			Price price ( OrderHandle order ) const
+			{
+				assert ( order < m_prices.size() );
+				return m_prices[order];
+			}
+
+			Volume volume ( OrderHandle order ) const
+			{
+				assert ( order < m_volumes.size() );
+				return m_volumes[order];
+			}
+
+			void reduce ( OrderHandle order, Volume volume )
+			{
+				assert ( m_volumes[order] > volume );
+				m_volumes[order] -= volume;
+			}
+
+			OrderHandle next ( OrderHandle order ) const
+			{
+				return m_next[order];
+			}
+
+			OrderHandle prev ( OrderHandle order ) const
+			{
+				return m_prev[order];
+			}
+
+			void link ( OrderHandle order, OrderHandle prev, OrderHandle next )
+			{
+				m_prev[order] = prev;
+				m_next[order] = next;
+			}
+
+			void setNext ( OrderHandle order, OrderHandle next )
+			{
+				m_next[order] = next;
+			}
+
+			void setPrev ( OrderHandle order, OrderHandle prev )
+			{
+				m_prev[order] = prev;
+			}
+
+		private:
+			BasicOrderStore ( BasicOrderStore<F> const & rhs );
+			BasicOrderStore<F> & operator= ( BasicOrderStore<F> const & rhs );
+
+			std::vector<Price> m_prices;
+			std::vector<Volume> m_volumes;
+			std::vector<OrderHandle> m_next;
+			std::vector<OrderHandle> m_prev;
+			std::vector<uint8_t> m_sides;
+			OrderHandle m_free;
+			size_t m_size;
+		};
+
+		extern template class BasicOrderStore<WideFixedPoint>;
+		extern template class BasicOrderStore<NarrowFixedPoint>;
+
+		typedef BasicOrderStore<BookFixedPoint> OrderStore;
+	}
+}
+
+#endif
@@ -0,0 +1,242 @@
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "Constants.hpp"
+#include "OutputWriter.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		StreamSink::StreamSink ( std::ostream & os ) :
+			m_os ( &os )
+		{
+		}
+
+		void StreamSink::write ( const char * data, size_t size )
+		{
+			m_os->write ( data, size );
+		}
+
+		void StreamSink::flush()
+		{
+			m_os->flush();
+		}
+
+		void StreamSink::reset ( std::ostream & os )
+		{
+			m_os = &os;
+		}
+
+		FdSink::FdSink ( int fd ) :
+			m_fd ( fd )
+		{
+		}
+
+		void FdSink::write ( const char * data, size_t size )
+		{
+			while ( size > 0 )
+			{
+				ssize_t written ( ::write ( m_fd, data, size ) );
+				if ( written < 0 )
+				{
+					if ( errno == EINTR )
+						continue;
+					throw std::runtime_error ( std::string ( "Unable to write output: " ) + strerror ( errno ) );
+				}
+				data += written;
+				size -= written;
+			}
+		}
+
+		SynchronizedSink::SynchronizedSink ( OutputSink & sink ) :
+			m_sink ( sink )
+		{
+		}
+
+		void SynchronizedSink::write ( const char * data, size_t size )
+		{
+			std::lock_guard<std::mutex> lock ( m_mutex );
+			m_sink.write ( data, size );
+		}
+
+		void SynchronizedSink::flush()
+		{
+			std::lock_guard<std::mutex> lock ( m_mutex );
+			m_sink.flush();
+		}
+
+		void MemorySink::write ( const char * data, size_t size )
+		{
+			m_data.append ( data, size );
+		}
+
+		std::string const & MemorySink::str() const
+		{
+			return m_data;
+		}
+
+		void MemorySink::clear()
+		{
+			m_data.clear();
+		}
+
+		OutputWriter::OutputWriter ( OutputSink & sink,
+									 FlushPolicy::Policy policy,
+									 size_t capacity ) :
+			m_sink ( sink ),
+			m_policy ( policy ),
+			m_buffer ( std::max ( capacity, f_max_line ) ),
+			m_used ( 0 ),
+			m_dirty ( false )
+		{
+		}
+
+		OutputWriter::~OutputWriter()
+		{
+			try
+			{
+				flush();
+			}
+			catch ( std::exception & )
+			{
+				// nowhere left to tell anyone
+			}
+		}
+
+		void OutputWriter::writeCost ( Timestamp time, char side, uint64_t value )
+		{
+			char * out ( beginLine() );
+			out = formatUInt ( out, time.value, time.digits );
+			*out++ = ' ';
+			*out++ = side;
+			*out++ = ' ';
+			out = formatCost ( out, value );
+			endLine ( out );
+		}
+
+		void OutputWriter::writeCost ( uint32_t target_size, Timestamp time, char side, uint64_t value )
+		{
+			char * out ( beginLine() );
+			out = formatUInt ( out, target_size );
+			*out++ = ' ';
+			out = formatUInt ( out, time.value, time.digits );
+			*out++ = ' ';
+			*out++ = side;
+			*out++ = ' ';
+			out = formatCost ( out, value );
+			endLine ( out );
+		}
+
+		void OutputWriter::setPrefix ( std::string_view prefix )
+		{
+			assert ( prefix.size() < f_max_prefix );
+			m_prefix = prefix;
+		}
+
+		void OutputWriter::endMessage()
+		{
+			if ( m_dirty && m_policy == FlushPolicy::PER_MESSAGE )
+				flush();
+		}
+
+		void OutputWriter::endBatch()
+		{
+			if ( m_dirty && m_policy != FlushPolicy::ON_EXIT )
+				flush();
+		}
+
+		void OutputWriter::flush()
+		{
+			if ( m_used > 0 )
+				m_sink.write ( &m_buffer[0], m_used );
+			m_used = 0;
+			if ( m_dirty )
+				m_sink.flush();
+			m_dirty = false;
+		}
+
+		FlushPolicy::Policy OutputWriter::policy() const
+		{
+			return m_policy;
+		}
+
+		/* Room for another line, whatever's there goes to the sink if we have to */
+		char * OutputWriter::beginLine()
+		{
+			if ( m_buffer.size() - m_used < f_max_line )
+			{
+				m_sink.write ( &m_buffer[0], m_used );
+				m_used = 0;
+			}
+			char * out ( &m_buffer[m_used] );
+			if ( !m_prefix.empty() )
+			{
+				memcpy ( out, m_prefix.data(), m_prefix.size() );
+				out += m_prefix.size();
+				*out++ = ' ';
+			}
+			return out;
+		}
+
+		void OutputWriter::endLine ( char * end )
+		{
+			*end++ = '\n';
+			m_used = end - &m_buffer[0];
+			m_dirty = true;
+		}
+
+		/* At least width digits, zeros in front if it takes fewer */
+		char * OutputWriter::formatUInt ( char * out, uint64_t value, size_t width )
+		{
+			char digits[20];
+			size_t count ( 0 );
+			do
+			{
+				digits[count++] = '0' + value % 10;
+				value /= 10;
+			}
+			while ( value );
+			for ( width = std::min ( width, sizeof ( digits ) ); width > count; width-- )
+				*out++ = '0';
+			while ( count )
+				*out++ = digits[--count];
+			return out;
+		}
+
+		/*
+		* Same text printf ( "%0.2f", value / Constants::round_size ) used to give us.
+		* Anything that isn't exactly half a cent rounds the obvious way. Exactly half a cent is what the double
+		* made of it says: above or below the real value decides, and a true tie goes to the even cent.
+		*/
+		char * OutputWriter::formatCost ( char * out, uint64_t value )
+		{
+			static_assert ( Constants::round_decimals == 3, "we print 2 decimals out of 3" );
+			if ( value == f_no_cost )
+			{
+				memcpy ( out, "NA", 2 );
+				return out + 2;
+			}
+			uint64_t cents ( value / 10 );
+			uint32_t rest ( value % 10 );
+			if ( rest > 5 )
+				cents++;
+			else if ( rest == 5 )
+			{
+				double error ( fma ( value / Constants::round_size, Constants::round_size, - static_cast < double > ( value ) ) );
+				if ( error > 0 || ( error == 0 && cents % 2 ) )
+					cents++;
+			}
+			out = formatUInt ( out, cents / 100 );
+			*out++ = '.';
+			*out++ = '0' + cents / 10 % 10;
+			*out++ = '0' + cents % 10;
+			return out;
+		}
+	}
+}
@@ -0,0 +1,141 @@
+#ifndef __OUTPUT_WRITER_HPP__
+#define __OUTPUT_WRITER_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Message.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/* Where the output ends up */
+		class OutputSink
+		{
+		public:
+			virtual ~OutputSink() {}
+			virtual void write ( const char * data, size_t size ) = 0;
+			virtual void flush() {}
+		};
+
+		class StreamSink : public OutputSink
+		{
+		public:
+			StreamSink ( std::ostream & os );
+			void write ( const char * data, size_t size );
+			void flush();
+			// so a handler can keep one writer around for whatever stream it's handed next
+			void reset ( std::ostream & os );
+		private:
+			std::ostream * m_os;
+		};
+
+		/* Straight to a file descriptor, no stdio in between */
+		class FdSink : public OutputSink
+		{
+		public:
+			FdSink ( int fd );
+			void write ( const char * data, size_t size );
+		private:
+			int m_fd;
+		};
+
+		/* Keeps everything, handy for tests and for handing output to someone else */
+		class MemorySink : public OutputSink
+		{
+		public:
+			void write ( const char * data, size_t size );
+			std::string const & str() const;
+			void clear();
+		private:
+			std::string m_data;
+		};
+
+		/* Lets several writers share one sink, each write goes through in one piece */
+		class SynchronizedSink : public OutputSink
+		{
+		public:
+			SynchronizedSink ( OutputSink & sink );
+			void write ( const char * data, size_t size );
+			void flush();
+		private:
+			OutputSink & m_sink;
+			std::mutex m_mutex;
+		};
+
+		namespace FlushPolicy
+		{
+			enum Policy
+			{
+				// after every message that printed something
+				PER_MESSAGE,
+				// after every batch of lines ( a buffer, a file, .. )
+				PER_BATCH,
+				// only when the buffer is full, and when we're done
+				ON_EXIT
+			};
+		}
+
+		/*
+		* Formats the book's output into a buffer we allocate once, with integer arithmetic only,
+		* and hands it to the sink according to the flush policy.
+		*
+		* Lines look like "<time> <side> <cost>" with the time as it came in and the cost in 2 decimals, or NA if there's
+		* not enough volume.
+		* Only whole lines ever go to the sink. Anything still buffered gets flushed when we're destroyed.
+		*/
+		class OutputWriter
+		{
+		public:
+			static constexpr size_t f_default_capacity = 64 * 1024;
+			static constexpr size_t f_max_prefix = 32;
+			// a cost we don't have, prints as NA
+			static constexpr uint64_t f_no_cost = std::numeric_limits<uint64_t>::max();
+
+			OutputWriter ( OutputSink & sink,
+						   FlushPolicy::Policy policy = FlushPolicy::ON_EXIT,
+						   size_t capacity = f_default_capacity );
+			~OutputWriter();
+
+			/* value in ticks of 1/Constants::round_size, f_no_cost means NA */
+			void writeCost ( Timestamp time, char side, uint64_t value );
+			/* Same, tagged with the target size it's for */
+			void writeCost ( uint32_t target_size, Timestamp time, char side, uint64_t value );
+
+			/* Goes in front of every line from now on ( think symbols ), the text has to outlive its use here */
+			void setPrefix ( std::string_view prefix );
+
+			void endMessage();
+			void endBatch();
+			void flush();
+
+			FlushPolicy::Policy policy() const;
+		private:
+			OutputWriter ( OutputWriter const & rhs );
+			OutputWriter & operator= ( OutputWriter const & rhs );
+
+			// longest line we can write: prefix, tag, time, side and cost
+			static constexpr size_t f_max_line = f_max_prefix + 64;
+
+			OutputSink & m_sink;
+			FlushPolicy::Policy m_policy;
+			std::vector<char> m_buffer;
+			size_t m_used;
+			bool m_dirty;
+			std::string_view m_prefix;
+
+			char * beginLine();
+			void endLine ( char * end );
+			static char * formatUInt ( char * out, uint64_t value, size_t width = 0 );
+			static char * formatCost ( char * out, uint64_t value );
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,119 @@
+#include <algorithm>
+
+#include "CpuSet.hpp"
+#include "ParallelParser.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		ParallelParser::ParallelParser ( FeedHandler & feed, OutputWriter & out, size_t threads, size_t chunk_bytes ) :
+			m_feed ( feed ),
+			m_out ( out ),
+			m_stats ( LatencyStats::instance() ),
+			m_chunk_bytes ( std::max < size_t > ( 1, chunk_bytes ) ),
+			m_window ( 2 * std::max < size_t > ( 1, threads ) ),
+			m_first ( 0 ),
+			m_end ( 0 ),
+			m_applied ( 0 ),
+			m_next ( 0 ),
+			m_stop ( false ),
+			m_pinned ( 0 )
+		{
+			m_slots.reset ( new Chunk[m_window] );
+			for ( size_t i = 0; i < m_window; i++ )
+				m_slots[i].ready.store ( 0, std::memory_order_relaxed );
+			CpuSet cpus;
+			for ( size_t i = 0; i < std::max < size_t > ( 1, threads ); i++ )
+			{
+				m_threads.push_back ( std::thread ( &ParallelParser::run, this ) );
+				// the first core we're allowed on is for the book, if there's enough of them
+				if ( cpus.pin ( m_threads.back(), i + 1 ) )
+					m_pinned++;
+			}
+		}
+
+		ParallelParser::~ParallelParser()
+		{
+			m_stop.store ( true, std::memory_order_release );
+			for ( std::thread & thread : m_threads )
+				thread.join();
+		}
+
+		size_t ParallelParser::pinned() const
+		{
+			return m_pinned;
+		}
+
+		void ParallelParser::processMessage ( std::string_view line )
+		{
+			m_feed.processMessage ( line, m_out );
+		}
+
+		size_t ParallelParser::processLines ( std::string_view buffer )
+		{
+			size_t complete ( buffer.rfind ( '\n' ) );
+			if ( complete == std::string_view::npos )
+				return 0;
+			complete++;
+			m_texts.clear();
+			for ( size_t begin = 0; begin < complete; )
+			{
+				size_t end ( begin + m_chunk_bytes < complete ? buffer.find ( '\n', begin + m_chunk_bytes - 1 ) + 1 : complete );
+				m_texts.push_back ( buffer.substr ( begin, end - begin ) );
+				begin = end;
+			}
+			m_first = m_end.load ( std::memory_order_relaxed );
+			m_end.store ( m_first + m_texts.size(), std::memory_order_release );
+			size_t batch_size ( m_feed.batchSize() );
+			for ( size_t i = m_first; i < m_first + m_texts.size(); i++ )
+			{
+				Chunk & chunk ( m_slots[i % m_window] );
+				for ( size_t idle = 0; chunk.ready.load ( std::memory_order_acquire ) != i + 1; idle++ )
+					if ( idle > 64 )
+						std::this_thread::yield();
+				for ( size_t j = 0; j < chunk.messages.size(); j += batch_size )
+					m_feed.processBatch ( &chunk.messages[j], std::min ( batch_size, chunk.messages.size() - j ), m_out );
+				m_applied.store ( i + 1, std::memory_order_release );
+			}
+			m_out.endBatch();
+			return complete;
+		}
+
+		/* Take the next chunk, wait until it's there and its slot is free, and parse it */
+		void ParallelParser::run()
+		{
+			for ( ;; )
+			{
+				size_t i ( m_next.fetch_add ( 1, std::memory_order_relaxed ) );
+				for ( size_t idle = 0;
+						i >= m_end.load ( std::memory_order_acquire ) || i >= m_applied.load ( std::memory_order_acquire ) + m_window;
+						idle++ )
+				{
+					if ( m_stop.load ( std::memory_order_acquire ) )
+					{
+						LATENCY_ONLY ( std::lock_guard<std::mutex> lock ( m_stats_mutex ) );
+						LATENCY_ONLY ( m_stats += LatencyStats::instance() );
+						return;
+					}
+					if ( idle > 64 )
+						std::this_thread::yield();
+				}
+				std::string_view text ( m_texts[i - m_first] );
+				Chunk & chunk ( m_slots[i % m_window] );
+				chunk.messages.clear();
+				size_t line_begin ( 0 );
+				size_t line_end ( text.find ( '\n' ) );
+				while ( line_end != std::string_view::npos )
+				{
+					LATENCY_TIMER ( timer );
+					chunk.messages.emplace_back();
+					FeedHandler::parseMessage ( text.substr ( line_begin, line_end - line_begin ), chunk.messages.back() );
+					LATENCY_LAP ( LatencyStats::PARSE, timer );
+					line_begin = line_end + 1;
+					line_end = text.find ( '\n', line_begin );
+				}
+				chunk.ready.store ( i + 1, std::memory_order_release );
+			}
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef __PARALLEL_PARSER_HPP__
+#define __PARALLEL_PARSER_HPP__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "FeedHandler.hpp"
+#include "LatencyStats.hpp"
+#include "Message.hpp"
+#include "OutputWriter.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* For big files: the text is cut into chunks at line ends and a pool of threads parses them into arrays
+		* of messages, while whoever calls processLines hands the arrays to the feed handler in file order.
+		*
+		* Chunks are numbered as they come in and go round a window of slots, so no more than a window's worth of
+		* parsed messages is ever around however big the file is. A parser that gets too far ahead waits for its slot.
+		* Broken lines stay in the arrays and get counted in the handler's errors like they would without us.
+		*
+		* Same calls as the feed handler's, the book stays on the caller's thread and everything is through it when
+		* they return. Parse times the pool kept go to the creator's stats when we're destroyed.
+		*/
+		class ParallelParser
+		{
+		public:
+			static const size_t f_default_chunk_bytes = 1024 * 1024;
+
+			ParallelParser ( FeedHandler & feed, OutputWriter & out, size_t threads, size_t chunk_bytes = f_default_chunk_bytes );
+			~ParallelParser();
+
+			/* Only a line at a time, not worth handing over */
+			void processMessage ( std::string_view line );
+			/* Every complete line in the buffer, returns the number of bytes consumed */
+			size_t processLines ( std::string_view buffer );
+
+			/* Parsers we managed to pin */
+			size_t pinned() const;
+		private:
+			struct Chunk
+			{
+				std::vector<Message> messages;
+				// one past the number of the chunk that's in here, once it's parsed
+				std::atomic<size_t> ready;
+			};
+
+			ParallelParser ( ParallelParser const & rhs );
+			ParallelParser & operator= ( ParallelParser const & rhs );
+
+			FeedHandler & m_feed;
+			OutputWriter & m_out;
+			LatencyStats & m_stats;
+			std::mutex m_stats_mutex;
+			size_t m_chunk_bytes;
+			std::unique_ptr<Chunk[]> m_slots;
+			size_t m_window;
+			// the text of the chunks processLines is on, from the first one on
+			std::vector<std::string_view> m_texts;
+			size_t m_first;
+			// chunks up to end are there to parse, the ones before applied are done with
+			std::atomic<size_t> m_end;
+			std::atomic<size_t> m_applied;
+			// the next one a parser takes
+			std::atomic<size_t> m_next;
+			std::atomic<bool> m_stop;
+			std::vector<std::thread> m_threads;
+			size_t m_pinned;
+
+			void run();
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include "CpuSet.hpp"
+#include "Pipeline.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		Pipeline::Pipeline ( FeedHandler & feed, OutputWriter & out, size_t queue_capacity ) :
+			m_feed ( feed ),
+			m_out ( out ),
+			m_stats ( LatencyStats::instance() ),
+			m_queue ( queue_capacity ),
+			m_batch ( feed.batchSize() ),
+			m_requests ( 0 ),
+			m_consumed ( 0 ),
+			m_stop ( false ),
+			m_pinned ( false )
+		{
+			m_thread = std::thread ( &Pipeline::run, this );
+			// next to the book if we're allowed a second core, sharing the one we have if we aren't
+			m_pinned = CpuSet().pin ( m_thread, 1 );
+		}
+
+		Pipeline::~Pipeline()
+		{
+			m_stop.store ( true, std::memory_order_release );
+			m_thread.join();
+		}
+
+		bool Pipeline::pinned() const
+		{
+			return m_pinned;
+		}
+
+		void Pipeline::processMessage ( std::string_view line )
+		{
+			m_feed.processMessage ( line, m_out );
+		}
+
+		/* Takes whatever is queued up to a batch, so a slow parser doesn't hold messages back waiting for a full one */
+		size_t Pipeline::processLines ( std::string_view buffer )
+		{
+			m_buffer = buffer;
+			m_requests.fetch_add ( 1, std::memory_order_release );
+			size_t batched ( 0 );
+			size_t idle ( 0 );
+			Task task;
+			for ( ;; )
+			{
+				bool popped ( m_queue.pop ( task ) );
+				if ( popped && !task.end )
+				{
+					m_batch[batched++] = task.message;
+					if ( batched < m_batch.size() )
+						continue;
+				}
+				if ( batched > 0 )
+				{
+					m_feed.processBatch ( m_batch.data(), batched, m_out );
+					batched = 0;
+				}
+				if ( popped )
+				{
+					if ( task.end )
+						break;
+					idle = 0;
+				}
+				// spin a little before we give up the core
+				else if ( ++idle > 64 )
+					std::this_thread::yield();
+			}
+			m_out.endBatch();
+			return m_consumed;
+		}
+
+		void Pipeline::run()
+		{
+			size_t done ( 0 );
+			size_t idle ( 0 );
+			for ( ;; )
+			{
+				if ( m_requests.load ( std::memory_order_acquire ) > done )
+				{
+					m_consumed = parseLines ( m_buffer );
+					Task end = Task();
+					end.end = true;
+					push ( end );
+					done++;
+					idle = 0;
+				}
+				else if ( m_stop.load ( std::memory_order_acquire ) )
+					break;
+				else if ( ++idle > 64 )
+					std::this_thread::yield();
+			}
+			LATENCY_ONLY ( m_stats += LatencyStats::instance() );
+		}
+
+		size_t Pipeline::parseLines ( std::string_view buffer )
+		{
+			Task task;
+			task.end = false;
+			size_t line_begin ( 0 );
+			size_t line_end ( buffer.find ( '\n' ) );
+			while ( line_end != std::string_view::npos )
+			{
+				LATENCY_TIMER ( timer );
+				FeedHandler::parseMessage ( buffer.substr ( line_begin, line_end - line_begin ), task.message );
+				LATENCY_LAP ( LatencyStats::PARSE, timer );
+				push ( task );
+				line_begin = line_end + 1;
+				line_end = buffer.find ( '\n', line_begin );
+			}
+			return line_begin;
+		}
+
+		void Pipeline::push ( Task const & task )
+		{
+			while ( !m_queue.push ( task ) )
+				std::this_thread::yield();
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef __PIPELINE_HPP__
+#define __PIPELINE_HPP__
+
+#include <atomic>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "FeedHandler.hpp"
+#include "LatencyStats.hpp"
+#include "Message.hpp"
+#include "OutputWriter.hpp"
+#include "SpscQueue.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* Parsing and the book on two threads. A parser thread of our own takes the lines apart and the messages go over
+		* a single producer / single consumer queue to whoever calls processLines, which hands them to the feed handler
+		* a batch at a time ( whatever is queued, up to its batchSize() ). A full queue makes the parser wait.
+		*
+		* The book stays on the caller's thread, its memory comes from that thread's allocators. Same calls as the
+		* feed handler's and everything is through the book when they return, so the text only has to stay put until then.
+		* Parse times the parser thread kept go to the creator's stats when we're destroyed.
+		*/
+		class Pipeline
+		{
+		public:
+			static const size_t f_default_queue_capacity = 16 * 1024;
+
+			Pipeline ( FeedHandler & feed, OutputWriter & out, size_t queue_capacity = f_default_queue_capacity );
+			~Pipeline();
+
+			/* Only a line at a time, not worth handing over */
+			void processMessage ( std::string_view line );
+			/* Every complete line in the buffer, returns the number of bytes consumed */
+			size_t processLines ( std::string_view buffer );
+
+			/* Whether the parser thread got the CPU next to ours */
+			bool pinned() const;
+		private:
+			/* A parsed line, or the end of the buffer */
+			struct Task
+			{
+				Message message;
+				bool end;
+			};
+
+			Pipeline ( Pipeline const & rhs );
+			Pipeline & operator= ( Pipeline const & rhs );
+
+			FeedHandler & m_feed;
+			OutputWriter & m_out;
+			LatencyStats & m_stats;
+			SpscQueue<Task> m_queue;
+			std::vector<Message> m_batch;
+			// the buffer for the parser, it takes it once requests goes past the ones it's done
+			std::string_view m_buffer;
+			std::atomic<size_t> m_requests;
+			// the parser's, read once we've seen the end of the buffer
+			size_t m_consumed;
+			std::atomic<bool> m_stop;
+			std::thread m_thread;
+			bool m_pinned;
+
+			void run();
+			size_t parseLines ( std::string_view buffer );
+			void push ( Task const & task );
+		};
+	}
+}
+
+#endif
@@ -2,11 +2,17 @@
 #define __ORDER_MAP_HPP__
 
 #include <assert.h>
+#include <algorithm>
 #include <map>
 #include <unordered_map>
 #include <limits>
+#include <vector>
 
+#include "MemoryStats.hpp"
 #include "OrderList.hpp"
+#include "SlabAllocator.hpp"
+#include "SweepCosts.hpp"
+#include "TargetCosts.hpp"
 
 namespace RgmInterview {
 	namespace OrderBook {
@@ -14,102 +20,136 @@ namespace RgmInterview {
 		/*
 		* A map+table that has constant time lookups, but still O(logN) only when we create a new price level
 		*/
-		template <class T>
+		template <class T, class F = BookFixedPoint>
 		class PriceLevelMap
 		{
 		public:
-			uint32_t total_volume;
-			typedef typename std::map < uint32_t, OrderList_ptr, T > LevelsTree;
+			typedef typename F::price_type Price;
+			typedef typename F::volume_type Volume;
+			typedef typename F::value_type Value;
+			typedef BasicOrderStore<F> OrderStore;
+			typedef BasicOrderList<F> OrderList;
+
+			Volume total_volume;
+			typedef typename std::map < Price, OrderList, T, SlabNodeAllocator < std::pair < const Price, OrderList > > > LevelsTree;
+			typedef typename LevelsTree::const_iterator const_iterator;
 
 			PriceLevelMap ( uint32_t target_volume ) : total_volume ( 0 ),
-				m_cached_total_value ( std::numeric_limits<uint32_t>::max() ),
-				m_last_considered_level ( std::numeric_limits<uint32_t>::max() ),
-				m_target_volume ( target_volume )
+				m_costs ( std::vector<uint32_t> ( 1, target_volume ) ),
+				m_most_levels ( 0 )
 			{
 			}
 
-			/* Add( O(1) ) or Find ( O(logN) ) the price level in the map */
-			OrderList_ptr & add ( uint32_t price )
+			/* Keeps the cost of every one of these volumes up to date */
+			PriceLevelMap ( std::vector<uint32_t> const & target_volumes ) : total_volume ( 0 ),
+				m_costs ( target_volumes ),
+				m_most_levels ( 0 )
 			{
-				// this resets the cached value
-				if ( m_last_considered_level != std::numeric_limits<uint32_t>::max() &&
-						T() ( price, m_last_considered_level ) )
-				{
-					m_last_considered_level =  std::numeric_limits<uint32_t>::max();
-					m_cached_total_value = std::numeric_limits<uint32_t>::max();
-				}
-				typename LevelsTable::iterator iter ( m_table.find ( price ) );
-				if ( iter != m_table.end() )
-					return iter->second->second;
-				else
-				{
-					OrderList_ptr node_list = std::make_shared < OrderList > ();
-					typename LevelsTree::iterator iter = m_tree.insert ( std::make_pair ( price, node_list ) ).first;
-					m_table.insert ( std::make_pair ( price, iter ) );
-					assert ( iter->second->total_volume == 0 );
-					return iter->second;
-				}
 			}
 
-			/* Returns true if this takes out the whole order, false otherwise */
-			bool reduce ( OrderNode_list::iterator & order_iter,
-						  uint32_t volume )
+			/* Queue the order at its price level, which we find ( O(1) ) or create ( O(logN) ) */
+			void add ( OrderStore & orders,
+					   OrderHandle order )
 			{
-				Order_ptr order ( ( *order_iter ) );
-				OrderList_ptr & price_level ( add ( order->price() ) );
-				// this resets the cached value
-				if ( m_last_considered_level != std::numeric_limits<uint32_t>::max() &&
-						( order->price() ==  m_last_considered_level ||
-						  T() ( order->price(), m_last_considered_level ) ) )
-				{
-					m_last_considered_level =  std::numeric_limits<uint32_t>::max();
-					m_cached_total_value = std::numeric_limits<uint32_t>::max();
-				}
-				if ( order->volume() <= volume )
+				Price price ( orders.price ( order ) );
+				Volume volume ( orders.volume ( order ) );
+				OrderList & price_level ( level ( price ) );
+				price_level.add ( orders, order );
+				price_level.total_volume += volume;
+				total_volume += volume;
+				assert ( price_level.total_volume > 0 );
+				m_costs.added ( price, volume, *this );
+				if ( m_sweeps.enabled() )
+					m_sweeps.added ( price, volume );
+			}
+
+			/* Returns true if this takes out the whole order ( and releases it ), false otherwise */
+			bool reduce ( OrderStore & orders,
+						  OrderHandle order,
+						  Volume volume )
+			{
+				Price price ( orders.price ( order ) );
+				typename LevelsTable::iterator iter ( m_table.find ( price ) );
+				assert ( iter != m_table.end() );
+				OrderList & price_level ( iter->second->second );
+				bool removed ( orders.volume ( order ) <= volume );
+				if ( removed )
 				{
-					assert ( price_level->total_volume > 0 );
-					volume = order->volume();
-					price_level->remove ( order_iter );
-					price_level->total_volume -= volume;
-					if ( price_level->empty() )
-						remove ( order->price() );
-					delete ( order );
-					total_volume -= volume;
-					return true;
+					assert ( price_level.total_volume > 0 );
+					volume = orders.volume ( order );
+					price_level.remove ( orders, order );
+					orders.release ( order );
 				}
 				else
-				{
-					order->reduce ( volume );
-					price_level->total_volume -= volume;
-					total_volume -= volume;
-					return false;
-				}
+					orders.reduce ( order, volume );
+				price_level.total_volume -= volume;
+				total_volume -= volume;
+				// the costs still need the level, even if it's empty now
+				m_costs.reduced ( price, volume, *this );
+				if ( m_sweeps.enabled() )
+					m_sweeps.removed ( price, volume );
+				if ( price_level.empty() )
+					remove ( iter );
+				return removed;
 			}
 
-			uint32_t get_total_value ( )
+			/* Cost of the target volume ( the first one by default ), F::unknown if there isn't enough volume in the book */
+			Value get_total_value ( size_t target = 0 )
 			{
-				uint32_t target_volume ( m_target_volume );
-				uint32_t total_value ( std::numeric_limits<uint32_t>::max() );
-				if ( total_volume >= target_volume )
+				return m_costs.value ( target, total_volume, [this] ( auto f )
 				{
-					if ( m_cached_total_value != std::numeric_limits<uint32_t>::max() )
-						return m_cached_total_value;
-					total_value = 0;
-					for ( auto iter = begin();
-							target_volume != 0 && iter != end();
-							iter++ )
-					{
-						uint32_t price ( iter->first );
-						OrderList_ptr const & list ( iter->second );
-						uint32_t volume_traded_at_level ( std::min ( target_volume, list->total_volume ) );
-						total_value += price * volume_traded_at_level;
-						target_volume -= volume_traded_at_level;
-						m_last_considered_level = price;
-					}
-					m_cached_total_value = total_value;
-					assert ( target_volume == 0 );
-				}
-				return total_value;
+					for ( typename LevelsTree::const_iterator iter = m_tree.begin(); iter != m_tree.end(); ++iter )
+						if ( !f ( iter->first, iter->second ) )
+							return;
+				} );
+			}
+
+			/*
+			* Start pulling in the level at price, if there is one. The table still has to be looked at to find it, but
+			* done for a whole batch of messages up front those lookups don't wait on each other.
+			*/
+			void prefetch ( Price price ) const
+			{
+				typename LevelsTable::const_iterator iter ( m_table.find ( price ) );
+				if ( iter != m_table.end() )
+					__builtin_prefetch ( &iter->second->second );
+			}
+
+			/*
+			* Keep prefix sums of the levels from here on ( see SweepCosts ), cost_for and size_for_budget then take O(log window)
+			* instead of a walk. Every add and reduce pays O(log window) for it.
+			*/
+			void enable_sweeps ( uint32_t window = SweepCosts<T, F>::f_default_window )
+			{
+				m_sweeps = SweepCosts<T, F> ( window );
+				for ( const_iterator level = begin(); level != end(); ++level )
+					m_sweeps.added ( level->first, level->second.total_volume );
+			}
+
+			/* What taking out any volume costs, F::unknown if there isn't that much in the book */
+			Value cost_for ( Volume volume ) const
+			{
+				if ( m_sweeps.enabled() )
+					return m_sweeps.cost_for ( volume );
+				return SweepCosts<T, F>::walkCost ( begin(), end(), volume );
+			}
+
+			/* Most volume the budget takes out, all of it if there's budget left over */
+			Volume size_for_budget ( Value budget ) const
+			{
+				if ( m_sweeps.enabled() )
+					return m_sweeps.size_for_budget ( budget );
+				return SweepCosts<T, F>::walkSize ( begin(), end(), budget );
+			}
+
+			size_t targets() const
+			{
+				return m_costs.size();
+			}
+
+			Volume target_volume ( size_t target ) const
+			{
+				return m_costs.volume ( target );
 			}
 
 			bool empty() const
@@ -125,37 +165,103 @@ namespace RgmInterview {
 				return m_tree.size();
 			}
 
+			/* Most levels there ever were at once */
+			size_t most_levels() const
+			{
+				return m_most_levels;
+			}
+
+			/*
+			* What we hold ourselves: the table's buckets and the costs. The nodes of the tree and the table come out of
+			* the slabs for their types ( see SlabAllocator ), every map on the thread shares those.
+			*/
+			MemoryUsage memory() const
+			{
+				size_t bytes ( m_table.bucket_count() * sizeof ( void * ) + m_costs.bytes() + m_sweeps.bytes() );
+				return MemoryUsage ( bytes, bytes );
+			}
+
 			void clear()
 			{
 				m_table.clear();
 				m_tree.clear();
+				if ( m_sweeps.enabled() )
+					m_sweeps = SweepCosts<T, F> ( m_sweeps.window() );
 			}
 
-			typename LevelsTree::const_iterator begin() const
+			const_iterator begin() const
 			{
 				return m_tree.begin();
 			}
 
-			typename LevelsTree::const_iterator end() const
+			const_iterator end() const
 			{
 				return m_tree.end();
 			}
 
 		private:
-			typedef typename std::unordered_map < uint32_t, typename LevelsTree::iterator > LevelsTable;
+			typedef typename std::unordered_map < Price,
+					typename LevelsTree::iterator,
+					std::hash<Price>,
+					std::equal_to<Price>,
+					SlabNodeAllocator < std::pair < const Price, typename LevelsTree::iterator > > > LevelsTable;
 			LevelsTree m_tree;
 			LevelsTable m_table;
-			uint32_t m_cached_total_value;
-			uint32_t m_last_considered_level;
-			uint32_t m_target_volume;
+			TargetCosts<T, F> m_costs;
+			// off unless someone asks for them
+			SweepCosts<T, F> m_sweeps;
+			size_t m_most_levels;
 
-			/* Remove ( O(1) ) the price level from the map */
-			void remove ( uint32_t price )
+			friend class TargetCosts<T, F>;
+
+			/* Find ( O(1) ) or create ( O(logN) ) the price level */
+			OrderList & level ( Price price )
+			{
+				typename LevelsTable::iterator iter ( m_table.find ( price ) );
+				if ( iter != m_table.end() )
+					return iter->second->second;
+				typename LevelsTree::iterator level ( m_tree.insert ( std::make_pair ( price, OrderList() ) ).first );
+				m_table.insert ( std::make_pair ( price, level ) );
+				m_most_levels = std::max ( m_most_levels, m_tree.size() );
+				return level->second;
+			}
+
+			Volume volume_at ( Price price ) const
 			{
 				typename LevelsTable::const_iterator iter ( m_table.find ( price ) );
 				assert ( iter != m_table.end() );
-				assert ( iter->second->second->total_volume == 0 );
-				assert ( iter->second->second->empty() );
+				return iter->second->second.total_volume;
+			}
+
+			/* The level right before price, false if price is the best one */
+			bool next_better ( Price price, Price & out ) const
+			{
+				typename LevelsTable::const_iterator iter ( m_table.find ( price ) );
+				assert ( iter != m_table.end() );
+				typename LevelsTree::const_iterator level ( iter->second );
+				if ( level == m_tree.begin() )
+					return false;
+				out = ( --level )->first;
+				return true;
+			}
+
+			/* The level right after price, false if price is the worst one */
+			bool next_worse ( Price price, Price & out ) const
+			{
+				typename LevelsTable::const_iterator iter ( m_table.find ( price ) );
+				assert ( iter != m_table.end() );
+				typename LevelsTree::const_iterator level ( iter->second );
+				if ( ++level == m_tree.end() )
+					return false;
+				out = level->first;
+				return true;
+			}
+
+			/* Remove ( O(1) ) the price level from the map */
+			void remove ( typename LevelsTable::iterator iter )
+			{
+				assert ( iter->second->second.total_volume == 0 );
+				assert ( iter->second->second.empty() );
 				m_tree.erase ( iter->second );
 				m_table.erase ( iter );
 			}
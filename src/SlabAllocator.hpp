@@ -0,0 +1,245 @@
+#ifndef __SLAB_ALLOCATOR_HPP__
+#define __SLAB_ALLOCATOR_HPP__
+
+#include <assert.h>
+#include <stddef.h>
+#include <algorithm>
+#include <new>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		struct SlabStatistics
+		{
+			size_t chunks;
+			// objects we can hand out without asking for another chunk, including the ones that are out
+			size_t capacity;
+			size_t live;
+			size_t high_water_mark;
+			size_t bytes;
+			// what each object takes
+			size_t object_bytes;
+		};
+
+		/*
+		* Every SlabAllocator alive on this thread. They're per type, so nobody else knows about all of them; they sign up
+		* when they're made and leave when they go, allocating doesn't come anywhere near here.
+		*/
+		class SlabRegistry
+		{
+		public:
+			typedef SlabStatistics ( *StatisticsOf ) ( void const * slab );
+
+			static SlabRegistry & instance()
+			{
+				static thread_local SlabRegistry instance;
+				return instance;
+			}
+
+			void add ( void const * slab, StatisticsOf statistics )
+			{
+				m_slabs.push_back ( std::make_pair ( slab, statistics ) );
+			}
+
+			void remove ( void const * slab )
+			{
+				for ( size_t i = 0; i < m_slabs.size(); i++ )
+					if ( m_slabs[i].first == slab )
+					{
+						m_slabs.erase ( m_slabs.begin() + i );
+						return;
+					}
+			}
+
+			/* Calls f ( statistics ) for every slab */
+			template <class F>
+			void forEach ( F f ) const
+			{
+				for ( std::pair<void const *, StatisticsOf> const & slab : m_slabs )
+					f ( slab.second ( slab.first ) );
+			}
+
+		private:
+			std::vector < std::pair<void const *, StatisticsOf> > m_slabs;
+		};
+
+		/*
+		* Hands out single objects of T from big chunks of raw memory. Freed objects go on a free list that's threaded
+		* through the objects themselves and get handed out again first. When that runs dry we carve the next object
+		* out of the current chunk, and only when that's used up we ask for a new chunk. Chunks are kept until we're destroyed.
+		*
+		* Nothing gets constructed here, that's up to whoever asked for the memory.
+		* There's one instance per type and thread, so books on different threads never share ( or lock ) anything.
+		*/
+		template <class T>
+		class SlabAllocator
+		{
+		public:
+			static const size_t f_default_chunk_bytes = 256 * 1024;
+
+			typedef SlabStatistics Statistics;
+
+			SlabAllocator ( size_t initial_capacity = 0, size_t chunk_bytes = f_default_chunk_bytes ) :
+				m_free ( 0 ),
+				m_fresh ( 0 ),
+				m_fresh_end ( 0 ),
+				m_objects_per_chunk ( std::max < size_t > ( 1, chunk_bytes / sizeof ( Slot ) ) ),
+				m_capacity ( 0 ),
+				m_live ( 0 ),
+				m_high_water_mark ( 0 )
+			{
+				reserve ( initial_capacity );
+				// the registry is made before we're done, so it goes after us
+				SlabRegistry::instance().add ( this, &SlabAllocator<T>::statisticsOf );
+			}
+
+			~SlabAllocator()
+			{
+				SlabRegistry::instance().remove ( this );
+				for ( Slot * chunk : m_chunks )
+					::operator delete ( chunk );
+			}
+
+			static SlabAllocator<T> & instance()
+			{
+				static thread_local SlabAllocator<T> instance;
+				return instance;
+			}
+
+			T * allocate()
+			{
+				Slot * slot ( m_free );
+				if ( slot )
+					m_free = slot->next;
+				else
+				{
+					if ( m_fresh == m_fresh_end )
+						grow();
+					slot = m_fresh++;
+				}
+				if ( ++m_live > m_high_water_mark )
+					m_high_water_mark = m_live;
+				return reinterpret_cast < T * > ( slot );
+			}
+
+			void deallocate ( T * t )
+			{
+				assert ( t );
+				assert ( m_live > 0 );
+				Slot * slot ( reinterpret_cast < Slot * > ( t ) );
+				slot->next = m_free;
+				m_free = slot;
+				m_live--;
+			}
+
+			/* Make sure we can hold this many objects without asking for more memory */
+			void reserve ( size_t objects )
+			{
+				while ( m_capacity < objects )
+				{
+					// whatever's left of the current chunk goes on the free list, we only carve from the newest one
+					while ( m_fresh != m_fresh_end )
+					{
+						Slot * slot ( m_fresh++ );
+						slot->next = m_free;
+						m_free = slot;
+					}
+					grow();
+				}
+			}
+
+			Statistics statistics() const
+			{
+				Statistics stats;
+				stats.chunks = m_chunks.size();
+				stats.capacity = m_capacity;
+				stats.live = m_live;
+				stats.high_water_mark = m_high_water_mark;
+				stats.bytes = m_capacity * sizeof ( Slot );
+				stats.object_bytes = sizeof ( Slot );
+				return stats;
+			}
+
+		private:
+			union Slot
+			{
+				Slot * next;
+				alignas ( T ) unsigned char storage[sizeof ( T )];
+			};
+
+			SlabAllocator ( SlabAllocator<T> const & rhs );
+			SlabAllocator<T> & operator= ( SlabAllocator<T> const & rhs );
+
+			std::vector<Slot *> m_chunks;
+			Slot * m_free;
+			Slot * m_fresh;
+			Slot * m_fresh_end;
+			size_t m_objects_per_chunk;
+			size_t m_capacity;
+			size_t m_live;
+			size_t m_high_water_mark;
+
+			static Statistics statisticsOf ( void const * slab )
+			{
+				return static_cast < SlabAllocator<T> const * > ( slab )->statistics();
+			}
+
+			void grow()
+			{
+				Slot * chunk ( static_cast < Slot * > ( ::operator new ( m_objects_per_chunk * sizeof ( Slot ) ) ) );
+				m_chunks.push_back ( chunk );
+				m_fresh = chunk;
+				m_fresh_end = chunk + m_objects_per_chunk;
+				m_capacity += m_objects_per_chunk;
+			}
+		};
+
+		/*
+		* Standard allocator on top of SlabAllocator, for node based containers. Every node comes out of the
+		* slab for its type, anything bigger than a single object ( bucket arrays and such ) goes to the heap.
+		*/
+		template <class T>
+		class SlabNodeAllocator
+		{
+		public:
+			typedef T value_type;
+
+			SlabNodeAllocator() {}
+
+			template <class U>
+			SlabNodeAllocator ( SlabNodeAllocator<U> const & ) {}
+
+			T * allocate ( size_t n )
+			{
+				if ( n == 1 )
+					return SlabAllocator<T>::instance().allocate();
+				return std::allocator<T>().allocate ( n );
+			}
+
+			void deallocate ( T * t, size_t n )
+			{
+				if ( n == 1 )
+					SlabAllocator<T>::instance().deallocate ( t );
+				else
+					std::allocator<T>().deallocate ( t, n );
+			}
+
+			template <class U>
+			bool operator== ( SlabNodeAllocator<U> const & ) const
+			{
+				return true;
+			}
+
+			template <class U>
+			bool operator!= ( SlabNodeAllocator<U> const & ) const
+			{
+				return false;
+			}
+		};
+	}
+}
+
+#endif
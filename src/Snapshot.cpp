@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <limits>
+#include <stdio.h>
+#include <string.h>
+#include <stdexcept>
+#include <zlib.h>
+
+#include "MappedFile.hpp"
+#include "Snapshot.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		const char Snapshot::f_magic[8] = { 'R', 'G', 'M', 'S', 'N', 'A', 'P', '1' };
+
+		// the records keep prices and volumes in 32 bits
+		static_assert ( sizeof ( OrderBook::Price ) <= sizeof ( uint32_t ) && sizeof ( OrderBook::Volume ) <= sizeof ( uint32_t ),
+						"snapshot records are too narrow for the book" );
+
+		InputPosition::InputPosition ( Unit unit, bool tracked ) :
+			unit ( unit ),
+			checksum ( 0 ),
+			offset ( 0 ),
+			tracked ( tracked )
+		{
+		}
+
+		void InputPosition::add ( std::string_view data, uint64_t units )
+		{
+			if ( !tracked )
+				return;
+			checksum = crc32_z ( checksum, reinterpret_cast < const Bytef * > ( data.data() ), data.size() );
+			offset += units;
+		}
+
+		void InputPosition::add ( std::string_view data )
+		{
+			add ( data, data.size() );
+		}
+
+		void InputPosition::checkUnit ( InputPosition const & taken ) const
+		{
+			if ( unit != taken.unit )
+				throw std::runtime_error ( taken.unit == BINARY_MESSAGES ? "Snapshot was taken in a binary feed" : "Snapshot was taken in a text feed" );
+		}
+
+		void InputPosition::checkResume ( InputPosition const & taken ) const
+		{
+			checkUnit ( taken );
+			if ( offset != taken.offset || checksum != taken.checksum )
+				throw std::runtime_error ( "Snapshot was taken in another input" );
+		}
+
+		size_t Snapshot::targetsBytes ( size_t targets )
+		{
+			return targets * 3 * sizeof ( uint64_t );
+		}
+
+		template <class T>
+		void Snapshot::saveSide ( T const & map,
+								  OrderStore const & orders,
+								  std::vector<OrderRecord> const & ids,
+								  std::vector<OrderRecord> & out )
+		{
+			for ( typename T::const_iterator level = map.begin(); level != map.end(); ++level )
+				for ( OrderHandle order = level->second.front(); order != OrderStore::f_none; order = orders.next ( order ) )
+				{
+					OrderRecord record ( ids[order] );
+					record.price = orders.price ( order );
+					record.volume = orders.volume ( order );
+					record.side = orders.side ( order );
+					out.push_back ( record );
+				}
+		}
+
+		void Snapshot::save ( FeedHandler const & feed, InputPosition const & position, std::string const & path )
+		{
+			OrderBook const & book ( feed.m_book );
+			// the dict goes from id to order, we need it the other way around
+			std::vector<OrderRecord> ids ( book.m_orders.capacity() );
+			std::string id_chars;
+			book.m_all_orders.forEach ( [&] ( std::string_view id, OrderHandle order )
+			{
+				OrderRecord & record ( ids[order] );
+				memset ( &record, 0, sizeof ( record ) );
+				record.id_offset = id_chars.size();
+				record.id_length = id.size();
+				id_chars.append ( id );
+			} );
+			std::vector<OrderRecord> records;
+			records.reserve ( book.m_orders.size() );
+			saveSide ( book.m_buys, book.m_orders, ids, records );
+			saveSide ( book.m_sells, book.m_orders, ids, records );
+
+			Header header;
+			memset ( &header, 0, sizeof ( header ) );
+			memcpy ( header.magic, f_magic, sizeof ( header.magic ) );
+			header.version = f_version;
+			header.targets = book.m_target_sizes.size();
+			header.input_offset = position.offset;
+			header.input_unit = position.unit;
+			header.input_checksum = position.checksum;
+			header.orders = records.size();
+			header.id_bytes = id_chars.size();
+			ErrorSummary const & errors ( feed.m_error_summary );
+			header.corrupted_messages = errors.corrupted_messages;
+			header.out_of_bounds_or_weird_numbers = errors.out_of_bounds_or_weird_numbers;
+			header.order_modify_on_order_i_dont_know = errors.order_modify_on_order_i_dont_know;
+			header.duplicate_order_id = errors.duplicate_order_id;
+			header.unexpected_exception = errors.unexpected_exception;
+			header.decimals = BookFixedPoint::decimals;
+
+			// the book's unknown is whatever its costs max out at, on file it's always 64 bits of it
+			std::vector<uint64_t> targets ( targetsBytes ( header.targets ) / sizeof ( uint64_t ), 0 );
+			std::copy ( book.m_target_sizes.begin(), book.m_target_sizes.end(), targets.begin() );
+			for ( size_t side = 0; side < 2; side++ )
+				std::transform ( book.m_last_values[side].begin(), book.m_last_values[side].end(), targets.begin() + ( side + 1 ) * header.targets,
+								 [] ( OrderBook::Value value )
+				{
+					return value == BookFixedPoint::unknown ? std::numeric_limits<uint64_t>::max() : static_cast < uint64_t > ( value );
+				} );
+
+			std::string temporary ( path + ".tmp" );
+			FILE * file ( fopen ( temporary.c_str(), "wb" ) );
+			if ( !file )
+				throw std::runtime_error ( "Unable to open " + temporary );
+			bool written ( fwrite ( &header, sizeof ( header ), 1, file ) == 1 &&
+						   fwrite ( targets.data(), sizeof ( uint64_t ), targets.size(), file ) == targets.size() &&
+						   fwrite ( records.data(), sizeof ( OrderRecord ), records.size(), file ) == records.size() &&
+						   fwrite ( id_chars.data(), 1, id_chars.size(), file ) == id_chars.size() );
+			if ( fclose ( file ) != 0 || !written || rename ( temporary.c_str(), path.c_str() ) != 0 )
+			{
+				remove ( temporary.c_str() );
+				throw std::runtime_error ( "Unable to write " + path );
+			}
+		}
+
+		InputPosition Snapshot::restore ( FeedHandler & feed, std::string const & path )
+		{
+			OrderBook & book ( feed.m_book );
+			if ( book.m_orders.size() > 0 )
+				throw std::runtime_error ( "Can only restore a snapshot into an empty book" );
+			MappedFile file ( path );
+			const char * data ( file.data() );
+			size_t left ( file.size() );
+			if ( left < sizeof ( Header ) || memcmp ( data, f_magic, sizeof ( f_magic ) ) != 0 )
+				throw std::runtime_error ( "Not a snapshot: " + path );
+			const Header * header ( reinterpret_cast < const Header * > ( data ) );
+			if ( header->version != f_version )
+				throw std::runtime_error ( "Unsupported snapshot: " + path );
+			if ( header->decimals != BookFixedPoint::decimals )
+				throw std::runtime_error ( "Snapshot was taken with other price decimals: " + path );
+			if ( header->input_unit != InputPosition::TEXT_BYTES && header->input_unit != InputPosition::BINARY_MESSAGES )
+				throw std::runtime_error ( "Corrupted snapshot: " + path );
+			left -= sizeof ( Header );
+			size_t targets_bytes ( targetsBytes ( header->targets ) );
+			if ( header->targets > left / ( 3 * sizeof ( uint64_t ) ) ||
+					targets_bytes > left ||
+					header->orders > ( left - targets_bytes ) / sizeof ( OrderRecord ) ||
+					header->id_bytes != left - targets_bytes - header->orders * sizeof ( OrderRecord ) )
+				throw std::runtime_error ( "Truncated snapshot: " + path );
+			const uint64_t * targets ( reinterpret_cast < const uint64_t * > ( data + sizeof ( Header ) ) );
+			if ( !std::equal ( book.m_target_sizes.begin(), book.m_target_sizes.end(), targets, targets + header->targets ) )
+				throw std::runtime_error ( "Snapshot was taken for other target sizes: " + path );
+			const OrderRecord * records ( reinterpret_cast < const OrderRecord * > ( data + sizeof ( Header ) + targets_bytes ) );
+			const char * id_chars ( reinterpret_cast < const char * > ( records + header->orders ) );
+
+			book.reserve ( header->orders );
+			for ( uint64_t i = 0; i < header->orders; i++ )
+			{
+				OrderRecord const & record ( records[i] );
+				if ( record.id_offset > header->id_bytes || record.id_length > header->id_bytes - record.id_offset ||
+						record.price == 0 || record.volume == 0 || record.side > OrderSide::SELL )
+					throw std::runtime_error ( "Corrupted snapshot: " + path );
+				std::pair<size_t, bool> entry ( book.m_all_orders.insert ( std::string_view ( id_chars + record.id_offset, record.id_length ) ) );
+				if ( !entry.second )
+					throw std::runtime_error ( "Corrupted snapshot: " + path );
+				OrderSide::Side side ( static_cast < OrderSide::Side > ( record.side ) );
+				OrderHandle order ( book.m_orders.allocate ( Order ( side, record.volume, record.price ) ) );
+				book.m_all_orders.value ( entry.first ) = order;
+				if ( side == OrderSide::BUY )
+					book.m_buys.add ( book.m_orders, order );
+				else
+					book.m_sells.add ( book.m_orders, order );
+			}
+			for ( size_t side = 0; side < 2; side++ )
+			{
+				book.m_last_values[side].resize ( header->targets );
+				std::transform ( targets + ( side + 1 ) * header->targets, targets + ( side + 2 ) * header->targets, book.m_last_values[side].begin(),
+								 [] ( uint64_t value )
+				{
+					return value == std::numeric_limits<uint64_t>::max() ? BookFixedPoint::unknown : static_cast < OrderBook::Value > ( value );
+				} );
+			}
+
+			ErrorSummary & errors ( feed.m_error_summary );
+			errors.corrupted_messages = header->corrupted_messages;
+			errors.out_of_bounds_or_weird_numbers = header->out_of_bounds_or_weird_numbers;
+			errors.order_modify_on_order_i_dont_know = header->order_modify_on_order_i_dont_know;
+			errors.duplicate_order_id = header->duplicate_order_id;
+			errors.unexpected_exception = header->unexpected_exception;
+			InputPosition position ( static_cast < InputPosition::Unit > ( header->input_unit ) );
+			position.offset = header->input_offset;
+			position.checksum = header->input_checksum;
+			return position;
+		}
+	}
+}
@@ -0,0 +1,109 @@
+#ifndef __SNAPSHOT_HPP__
+#define __SNAPSHOT_HPP__
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+
+#include "FeedHandler.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* How far into its input a snapshot was taken: text is counted in bytes, a binary feed in messages. Along with it
+		* goes a crc32 of everything before the offset, so a snapshot can tell when it's being carried on in some other input.
+		*/
+		struct InputPosition
+		{
+			enum Unit
+			{
+				TEXT_BYTES = 1,
+				BINARY_MESSAGES = 2
+			};
+
+			/* Untracked, add() doesn't do anything: for a run that doesn't restore or save a snapshot, the checksum takes a while */
+			InputPosition ( Unit unit = TEXT_BYTES, bool tracked = true );
+
+			/* The next bit of the input, units long: bytes of text, or the records of that many messages */
+			void add ( std::string_view data, uint64_t units );
+			void add ( std::string_view data );
+			/* Throws unless taken counts the same kind of input */
+			void checkUnit ( InputPosition const & taken ) const;
+			/* Throws unless we got to where taken was through the same input */
+			void checkResume ( InputPosition const & taken ) const;
+
+			uint32_t unit;
+			uint32_t checksum;
+			uint64_t offset;
+			bool tracked;
+		};
+
+		/*
+		* Saves everything a FeedHandler knows to a file, so a restarted pricer can pick up where the last one was
+		* instead of replaying the feed from the open.
+		*
+		* That's every live order ( per side, best level first and oldest first within a level, so the levels come
+		* back in the same FIFO order ), its id, the last cost we printed per side and target and the error counters.
+		* Along with it goes the input position the caller says we got to.
+		*
+		* Restoring maps the file and puts the orders straight back into an empty book. The costs are rebuilt on the way,
+		* so what gets printed after that is exactly what an uninterrupted run would have printed.
+		* Everything is in native byte order, a snapshot is meant to be restored where it was taken.
+		* Prices, volumes and costs are in the book's units, so it only goes back into a book with the same decimals.
+		*/
+		class Snapshot
+		{
+		public:
+			/* Written to a temporary file first and renamed, so there's never half a snapshot at path */
+			static void save ( FeedHandler const & feed, InputPosition const & position, std::string const & path );
+			/* The handler has to be fresh and have the same target sizes, returns the input position */
+			static InputPosition restore ( FeedHandler & feed, std::string const & path );
+		private:
+			static const char f_magic[8];
+			static const uint32_t f_version = 3;
+
+			struct Header
+			{
+				char magic[8];
+				uint32_t version;
+				uint32_t targets;
+				uint64_t input_offset;
+				uint64_t orders;
+				uint64_t id_bytes;
+				uint32_t corrupted_messages;
+				uint32_t out_of_bounds_or_weird_numbers;
+				uint32_t order_modify_on_order_i_dont_know;
+				uint32_t duplicate_order_id;
+				uint32_t unexpected_exception;
+				uint32_t decimals;
+				uint32_t input_unit;
+				uint32_t input_checksum;
+			};
+
+			struct OrderRecord
+			{
+				uint64_t id_offset;
+				uint32_t id_length;
+				uint32_t price;
+				uint32_t volume;
+				uint8_t side;
+				uint8_t padding[3];
+			};
+
+			static_assert ( sizeof ( Header ) == 72, "header layout changed" );
+			static_assert ( sizeof ( OrderRecord ) == 24, "record layout changed" );
+
+			/* Target sizes, then the last values of the buys and of the sells, all 64 bits */
+			static size_t targetsBytes ( size_t targets );
+
+			template <class T>
+			static void saveSide ( T const & map,
+								   OrderStore const & orders,
+								   std::vector<OrderRecord> const & ids,
+								   std::vector<OrderRecord> & out );
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef __SPSC_QUEUE_HPP__
+#define __SPSC_QUEUE_HPP__
+
+#include <assert.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* Bounded lock-free queue for exactly one producer thread and one consumer thread.
+		*
+		* A ring of slots with a head the consumer owns and a tail the producer owns. Each side keeps its own
+		* copy of the other side's index and only goes for the real ( shared ) one when its copy says full or empty,
+		* so most pushes and pops don't touch the other thread's cache line at all.
+		*/
+		template <class T>
+		class SpscQueue
+		{
+		public:
+			/* capacity has to be a power of two */
+			SpscQueue ( size_t capacity ) :
+				m_slots ( capacity ),
+				m_mask ( capacity - 1 ),
+				m_head ( 0 ),
+				m_cached_tail ( 0 ),
+				m_tail ( 0 ),
+				m_cached_head ( 0 )
+			{
+				assert ( capacity >= 2 && ( capacity & ( capacity - 1 ) ) == 0 );
+			}
+
+			/* Producer side, false if the queue is full */
+			bool push ( T const & value )
+			{
+				size_t tail ( m_tail.load ( std::memory_order_relaxed ) );
+				if ( tail - m_cached_head > m_mask )
+				{
+					m_cached_head = m_head.load ( std::memory_order_acquire );
+					if ( tail - m_cached_head > m_mask )
+						return false;
+				}
+				m_slots[tail & m_mask] = value;
+				m_tail.store ( tail + 1, std::memory_order_release );
+				return true;
+			}
+
+			/* Consumer side, false if the queue is empty */
+			bool pop ( T & value )
+			{
+				size_t head ( m_head.load ( std::memory_order_relaxed ) );
+				if ( head == m_cached_tail )
+				{
+					m_cached_tail = m_tail.load ( std::memory_order_acquire );
+					if ( head == m_cached_tail )
+						return false;
+				}
+				value = m_slots[head & m_mask];
+				m_head.store ( head + 1, std::memory_order_release );
+				return true;
+			}
+
+			/* Only a hint when the other side is busy */
+			bool empty() const
+			{
+				return m_head.load ( std::memory_order_acquire ) == m_tail.load ( std::memory_order_acquire );
+			}
+
+			size_t capacity() const
+			{
+				return m_slots.size();
+			}
+
+		private:
+			static const size_t f_cache_line = 64;
+
+			SpscQueue ( SpscQueue<T> const & rhs );
+			SpscQueue<T> & operator= ( SpscQueue<T> const & rhs );
+
+			std::vector<T> m_slots;
+			size_t m_mask;
+			// the consumer's
+			alignas ( f_cache_line ) std::atomic<size_t> m_head;
+			size_t m_cached_tail;
+			// the producer's
+			alignas ( f_cache_line ) std::atomic<size_t> m_tail;
+			size_t m_cached_head;
+		};
+	}
+}
+
+#endif
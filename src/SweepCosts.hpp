@@ -0,0 +1,265 @@
+#ifndef __SWEEP_COSTS_HPP__
+#define __SWEEP_COSTS_HPP__
+
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "MemoryStats.hpp"
+#include "OrderList.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* What sweeping any volume off one side of the book costs, and how much volume any budget sweeps, in O(log window)
+		* instead of a walk of the levels. T is the map's ordering ( best price first ), F the book's FixedPoint.
+		*
+		* Volume and price * volume per price go in two Fenwick trees over a window of prices ( in price units ) that starts
+		* a bit before the best price, so both prefix sums and finding where one of them passes a value take a single
+		* descent. Prices past the end of the window go in an ordinary map, a sweep only walks those when it gets through
+		* the whole window. Like the ladder we move the window when a price comes in better than it, or when it runs dry;
+		* the trees get rebuilt then. A level left far ahead of the rest of the book holds the window where it is, and so
+		* does a book wider than the window; sweeps that go deeper than the window walk the rest.
+		*
+		* The map tells us every change in volume at a price, we keep no orders or lists.
+		*/
+		template <class T, class F>
+		class SweepCosts
+		{
+		public:
+			typedef typename F::price_type Price;
+			typedef typename F::volume_type Volume;
+			typedef typename F::value_type Value;
+
+			static const uint32_t f_default_window = 16 * 1024;
+
+			/* window has to be a power of two, 0 keeps no sums at all ( and takes no memory ) */
+			SweepCosts ( uint32_t window = 0 ) :
+				m_window ( window ),
+				m_anchor ( 0 ),
+				m_window_volume ( 0 ),
+				m_window_value ( 0 ),
+				m_volumes ( window ),
+				m_volume_sums ( window + 1 ),
+				m_value_sums ( window + 1 )
+			{
+				assert ( window == 0 || ( window >= 4 && ( window & ( window - 1 ) ) == 0 ) );
+			}
+
+			bool enabled() const
+			{
+				return m_window != 0;
+			}
+
+			uint32_t window() const
+			{
+				return m_window;
+			}
+
+			/* The window's sums and whatever went past it */
+			size_t bytes() const
+			{
+				return ( m_volumes.capacity() + m_volume_sums.capacity() ) * sizeof ( Volume ) + m_value_sums.capacity() * sizeof ( Value ) +
+					   MemoryUsage::treeBytes ( m_overflow );
+			}
+
+			void added ( Price price, Volume volume )
+			{
+				uint32_t key ( keyOf ( price ) );
+				// nothing to move, the window can go wherever it likes
+				if ( m_window_volume == 0 )
+				{
+					assert ( m_overflow.empty() );
+					m_anchor = anchorFor ( key );
+				}
+				else if ( key < m_anchor )
+					slide ( key );
+				change ( key, volume, true );
+			}
+
+			void removed ( Price price, Volume volume )
+			{
+				change ( keyOf ( price ), volume, false );
+				if ( m_window_volume == 0 && !m_overflow.empty() )
+					slide ( m_overflow.begin()->first );
+			}
+
+			/* Cost of taking out volume, best price first, F::unknown if there isn't that much */
+			Value cost_for ( Volume volume ) const
+			{
+				Value value ( 0 );
+				if ( volume > m_window_volume )
+				{
+					volume -= m_window_volume;
+					value = m_window_value;
+					for ( typename Overflow::const_iterator level = m_overflow.begin(); level != m_overflow.end(); ++level )
+					{
+						Volume taken ( std::min ( level->second, volume ) );
+						value += F::cost ( priceOf ( level->first ), taken );
+						volume -= taken;
+						if ( volume == 0 )
+							return value;
+					}
+					return F::unknown;
+				}
+				if ( volume == 0 )
+					return 0;
+				// the most slots we can take whole and still be short of volume, the next one makes up the rest
+				size_t pos ( 0 );
+				for ( size_t step = m_window; step > 0; step >>= 1 )
+					if ( pos + step <= m_window && m_volume_sums[pos + step] < volume )
+					{
+						pos += step;
+						volume -= m_volume_sums[pos];
+						value += m_value_sums[pos];
+					}
+				return value + F::cost ( priceOf ( m_anchor + pos ), volume );
+			}
+
+			/* Most volume budget pays for, best price first ( all of it if there's budget left over ) */
+			Volume size_for_budget ( Value budget ) const
+			{
+				Volume volume ( 0 );
+				if ( budget >= m_window_value )
+				{
+					volume = m_window_volume;
+					budget -= m_window_value;
+					for ( typename Overflow::const_iterator level = m_overflow.begin(); level != m_overflow.end(); ++level )
+					{
+						Price price ( priceOf ( level->first ) );
+						Value value ( F::cost ( price, level->second ) );
+						if ( value > budget )
+							return volume + static_cast < Volume > ( budget / price );
+						volume += level->second;
+						budget -= value;
+					}
+					return volume;
+				}
+				// the most slots we can pay for whole, the next one we can only have some of
+				size_t pos ( 0 );
+				for ( size_t step = m_window; step > 0; step >>= 1 )
+					if ( pos + step <= m_window && m_value_sums[pos + step] <= budget )
+					{
+						pos += step;
+						budget -= m_value_sums[pos];
+						volume += m_volume_sums[pos];
+					}
+				return volume + static_cast < Volume > ( budget / priceOf ( m_anchor + pos ) );
+			}
+
+			/* cost_for by walking the levels from begin to end ( best first ), for a map that doesn't keep the sums */
+			template <class Iterator>
+			static Value walkCost ( Iterator begin, Iterator end, Volume volume )
+			{
+				Value value ( 0 );
+				for ( Iterator level = begin; volume > 0 && level != end; ++level )
+				{
+					Volume taken ( std::min ( level->second.total_volume, volume ) );
+					value += F::cost ( level->first, taken );
+					volume -= taken;
+				}
+				return volume > 0 ? F::unknown : value;
+			}
+
+			/* size_for_budget the same way */
+			template <class Iterator>
+			static Volume walkSize ( Iterator begin, Iterator end, Value budget )
+			{
+				Volume volume ( 0 );
+				for ( Iterator level = begin; level != end; ++level )
+				{
+					Value value ( F::cost ( level->first, level->second.total_volume ) );
+					if ( value > budget )
+						return volume + static_cast < Volume > ( budget / level->first );
+					volume += level->second.total_volume;
+					budget -= value;
+				}
+				return volume;
+			}
+
+		private:
+			static constexpr bool f_descending = T() ( 1u, 0u );
+
+			// by key, so best first
+			typedef std::map < uint32_t, Volume > Overflow;
+
+			uint32_t m_window;
+			// key of the first slot
+			uint32_t m_anchor;
+			Volume m_window_volume;
+			Value m_window_value;
+			// per slot, and the Fenwick trees over them ( 1 based )
+			std::vector<Volume> m_volumes;
+			std::vector<Volume> m_volume_sums;
+			std::vector<Value> m_value_sums;
+			Overflow m_overflow;
+
+			/* Keys go up as prices get worse, whichever way the map is ordered */
+			static uint32_t keyOf ( Price price )
+			{
+				return f_descending ? std::numeric_limits<Price>::max() - price : price;
+			}
+
+			static Price priceOf ( uint32_t key )
+			{
+				return static_cast < Price > ( f_descending ? std::numeric_limits<Price>::max() - key : key );
+			}
+
+			/* A quarter of the window in front of key, for prices that come in better later */
+			uint32_t anchorFor ( uint32_t key ) const
+			{
+				uint32_t room ( m_window / 4 );
+				return key > room ? key - room : 0;
+			}
+
+			void change ( uint32_t key, Volume volume, bool add )
+			{
+				if ( key - m_anchor >= m_window )
+				{
+					Volume & level ( m_overflow[key] );
+					assert ( add || level >= volume );
+					level = add ? level + volume : level - volume;
+					if ( level == 0 )
+						m_overflow.erase ( key );
+					return;
+				}
+				size_t slot ( key - m_anchor );
+				Value value ( F::cost ( priceOf ( key ), volume ) );
+				assert ( add || m_volumes[slot] >= volume );
+				m_volumes[slot] = add ? m_volumes[slot] + volume : m_volumes[slot] - volume;
+				m_window_volume = add ? m_window_volume + volume : m_window_volume - volume;
+				m_window_value = add ? m_window_value + value : m_window_value - value;
+				for ( size_t pos = slot + 1; pos <= m_window; pos += pos & ( 0 - pos ) )
+				{
+					m_volume_sums[pos] = add ? m_volume_sums[pos] + volume : m_volume_sums[pos] - volume;
+					m_value_sums[pos] = add ? m_value_sums[pos] + value : m_value_sums[pos] - value;
+				}
+			}
+
+			/* Start the window just before key, and put everything back where it goes now */
+			void slide ( uint32_t key )
+			{
+				std::vector < std::pair < uint32_t, Volume > > levels ( m_overflow.begin(), m_overflow.end() );
+				for ( size_t slot = 0; slot < m_window; slot++ )
+					if ( m_volumes[slot] > 0 )
+						levels.push_back ( std::make_pair ( m_anchor + slot, m_volumes[slot] ) );
+				m_overflow.clear();
+				std::fill ( m_volumes.begin(), m_volumes.end(), 0 );
+				std::fill ( m_volume_sums.begin(), m_volume_sums.end(), 0 );
+				std::fill ( m_value_sums.begin(), m_value_sums.end(), 0 );
+				m_window_volume = 0;
+				m_window_value = 0;
+				m_anchor = anchorFor ( key );
+				for ( size_t i = 0; i < levels.size(); i++ )
+					change ( levels[i].first, levels[i].second, true );
+			}
+		};
+	}
+}
+
+#endif
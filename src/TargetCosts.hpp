@@ -0,0 +1,239 @@
+#ifndef __TARGET_COSTS_HPP__
+#define __TARGET_COSTS_HPP__
+
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "LatencyStats.hpp"
+#include "OrderList.hpp"
+
+namespace RgmInterview {
+	namespace OrderBook {
+
+		/*
+		* What it costs to take out each of a bunch of target volumes, from one side of the book.
+		* T is the map's ordering ( best price first ), F the book's FixedPoint.
+		*
+		* Every target keeps its cost, the last level it needed ( the marginal level ) and how much it takes from that level.
+		* A change beyond the marginal level doesn't touch it. A change before it adjusts the cost by price * volume
+		* and then moves the boundary by however much volume came in or went out, a level at a time, from where it was.
+		* Only when a target runs out of levels do we forget it. Whatever is stale gets recomputed in a single walk of
+		* the levels, smallest target first, every one of them picking up its cost as the running volume passes it.
+		*
+		* The map passed in as levels has to tell us volume_at ( price ), next_better ( price, out ) and next_worse ( price, out ),
+		* for prices that are in the book.
+		*/
+		template <class T, class F>
+		class TargetCosts
+		{
+		public:
+			typedef typename F::price_type Price;
+			typedef typename F::volume_type Volume;
+			typedef typename F::value_type Value;
+
+			static constexpr Value f_unknown = F::unknown;
+
+			TargetCosts ( std::vector<uint32_t> const & target_volumes ) :
+				m_targets ( target_volumes.size() )
+			{
+				assert ( !target_volumes.empty() );
+				for ( size_t i = 0; i < target_volumes.size(); i++ )
+				{
+					// more than the book can hold is never there anyway
+					m_targets[i].volume = static_cast < Volume > ( std::min<uint64_t> ( target_volumes[i], std::numeric_limits<Volume>::max() ) );
+					m_by_volume.push_back ( i );
+				}
+				std::stable_sort ( m_by_volume.begin(), m_by_volume.end(), [&] ( size_t lhs, size_t rhs )
+				{
+					return m_targets[lhs].volume < m_targets[rhs].volume;
+				} );
+			}
+
+			size_t size() const
+			{
+				return m_targets.size();
+			}
+
+			Volume volume ( size_t target ) const
+			{
+				return m_targets[target].volume;
+			}
+
+			size_t bytes() const
+			{
+				return m_targets.capacity() * sizeof ( Target ) + m_by_volume.capacity() * sizeof ( size_t );
+			}
+
+			/*
+			* Volume got added at price ( and the level already has it ),
+			* that only matters to targets that stopped at a worse price. They now get too much before their marginal level.
+			*/
+			template <class Levels>
+			void added ( Price price, Volume volume, Levels const & levels )
+			{
+				for ( Target & target : m_targets )
+				{
+					if ( target.last_level == f_no_level || !T() ( price, target.last_level ) )
+						continue;
+					target.value += F::cost ( price, volume );
+					giveBack ( target, volume, levels );
+				}
+			}
+
+			/*
+			* Volume got taken out at price ( and the level doesn't have it anymore, but is still there if it's empty now ),
+			* that matters to targets that went as far as that price. They have to get it from further down the book.
+			*/
+			template <class Levels>
+			void reduced ( Price price, Volume volume, Levels const & levels )
+			{
+				for ( Target & target : m_targets )
+				{
+					if ( target.last_level == f_no_level )
+						continue;
+					if ( price == target.last_level )
+					{
+						// only what we were taking beyond what's left is gone
+						Volume level_volume ( levels.volume_at ( price ) );
+						if ( level_volume >= target.taken )
+							continue;
+						Volume missing ( target.taken - level_volume );
+						target.value -= F::cost ( price, missing );
+						target.taken = level_volume;
+						take ( target, missing, levels );
+					}
+					else if ( T() ( price, target.last_level ) )
+					{
+						target.value -= F::cost ( price, volume );
+						take ( target, volume, levels );
+					}
+				}
+			}
+
+			/*
+			* Cost of the target, f_unknown if there isn't enough volume. walk ( f ) has to call f ( price, list )
+			* for the levels best first, and stop when f returns false.
+			*/
+			template <class Walk>
+			Value value ( size_t target, Volume total_volume, Walk walk )
+			{
+				if ( total_volume < m_targets[target].volume )
+					return f_unknown;
+				if ( m_targets[target].value == f_unknown )
+					update ( total_volume, walk );
+				return m_targets[target].value;
+			}
+
+		private:
+			// a target that doesn't know its marginal level
+			static constexpr Price f_no_level = std::numeric_limits<Price>::max();
+
+			struct Target
+			{
+				Volume volume;
+				Value value;
+				Price last_level;
+				// how much of the last level we take
+				Volume taken;
+
+				Target() : volume ( 0 ), value ( f_unknown ), last_level ( f_no_level ), taken ( 0 ) {}
+
+				void invalidate()
+				{
+					value = f_unknown;
+					last_level = f_no_level;
+				}
+			};
+
+			std::vector<Target> m_targets;
+			// indexes into m_targets, smallest volume first
+			std::vector<size_t> m_by_volume;
+
+			/* Take volume less, starting at the marginal level and moving to better ones */
+			template <class Levels>
+			void giveBack ( Target & target, Volume volume, Levels const & levels )
+			{
+				while ( volume >= target.taken )
+				{
+					target.value -= F::cost ( target.last_level, target.taken );
+					volume -= target.taken;
+					// it can't run out, the volume that came in is on a better level
+					bool found ( levels.next_better ( target.last_level, target.last_level ) );
+					assert ( found );
+					( void ) found;
+					target.taken = levels.volume_at ( target.last_level );
+					if ( volume == 0 )
+						return;
+				}
+				target.taken -= volume;
+				target.value -= F::cost ( target.last_level, volume );
+			}
+
+			/* Take volume more, starting at the marginal level and moving to worse ones */
+			template <class Levels>
+			void take ( Target & target, Volume volume, Levels const & levels )
+			{
+				for ( ;; )
+				{
+					Volume taken ( std::min<Volume> ( levels.volume_at ( target.last_level ) - target.taken, volume ) );
+					target.taken += taken;
+					target.value += F::cost ( target.last_level, taken );
+					volume -= taken;
+					if ( volume == 0 )
+						return;
+					if ( !levels.next_worse ( target.last_level, target.last_level ) )
+					{
+						target.invalidate();
+						return;
+					}
+					target.taken = 0;
+				}
+			}
+
+			/* Fill in every stale target we have the volume for */
+			template <class Walk>
+			void update ( Volume total_volume, Walk walk )
+			{
+				std::vector<size_t>::const_iterator next ( m_by_volume.begin() );
+				std::vector<size_t>::const_iterator end ( m_by_volume.end() );
+				// skip the ones that are fine, and a target of nothing costs nothing
+				while ( next != end && ( m_targets[*next].value != f_unknown || m_targets[*next].volume == 0 ) )
+				{
+					if ( m_targets[*next].volume == 0 )
+						m_targets[*next].value = 0;
+					++next;
+				}
+				while ( end != next && m_targets[* ( end - 1 )].volume > total_volume )
+					--end;
+				if ( next == end )
+					return;
+				LATENCY_COUNT ( LatencyStats::LEVEL_WALKS );
+				Volume filled ( 0 );
+				Value value ( 0 );
+				walk ( [&] ( Price price, BasicOrderList<F> const & list )
+				{
+					while ( next != end && m_targets[*next].volume - filled <= list.total_volume )
+					{
+						Target & target ( m_targets[*next] );
+						if ( target.value == f_unknown )
+						{
+							target.value = value + F::cost ( price, target.volume - filled );
+							target.last_level = price;
+							target.taken = target.volume - filled;
+						}
+						++next;
+					}
+					value += F::cost ( price, list.total_volume );
+					filled += list.total_volume;
+					return next != end;
+				} );
+				assert ( next == end );
+			}
+		};
+	}
+}
+
+#endif
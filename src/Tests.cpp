@@ -6,6 +6,13 @@
 #include <algorithm>
 #include <limits>
 #include <iomanip>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <zlib.h>
 
 #include <boost/test/unit_test.hpp>
 #include <boost/format.hpp>
@@ -14,6 +21,24 @@
 #include <gperftools/profiler.h>
 #endif
 
+#include "BinaryFeed.hpp"
+#include "BookManager.hpp"
+#include "CpuSet.hpp"
+#include "DecimalParser.hpp"
+#include "DepthPublisher.hpp"
+#include "FeedGenerator.hpp"
+#include "GzipReader.hpp"
+#include "LadderPriceLevelMap.hpp"
+#include "LatencyHistogram.hpp"
+#include "LatencyStats.hpp"
+#include "MemoryStats.hpp"
+#include "OrderIdIndex.hpp"
+#include "OutputWriter.hpp"
+#include "ParallelParser.hpp"
+#include "Pipeline.hpp"
+#include "SlabAllocator.hpp"
+#include "Snapshot.hpp"
+#include "SpscQueue.hpp"
 #include "OrderList.hpp"
 #include "OrderBook.hpp"
 #include "FeedHandler.hpp"
@@ -102,3 +127,1388 @@ BOOST_AUTO_TEST_CASE ( reduceNegativeVolume )
 	handler.processMessage ( "28800744 R b -100", os );
 	BOOST_CHECK_EQUAL ( errors.out_of_bounds_or_weird_numbers, ( size_t ) 1 );
 }
+
+// lines are views into a bigger buffer, fields run right up to the next line
+BOOST_AUTO_TEST_CASE ( processLinesFromBuffer )
+{
+	FeedHandler handler ( 200 );
+	ErrorSummary const & errors ( handler.errors() );
+	std::ostringstream os;
+	std::string buffer ( "28800538 A b S 44.26 100\n28800562 A c S 44.10 100\n28800744 R b 10" );
+	size_t consumed ( handler.processLines ( buffer, os ) );
+	BOOST_CHECK_EQUAL ( consumed, buffer.rfind ( '\n' ) + 1 );
+	BOOST_CHECK_EQUAL ( handler.book().sells().total_volume, ( uint32_t ) 200 );
+	handler.processMessage ( std::string_view ( buffer ).substr ( consumed ), os );
+	BOOST_CHECK_EQUAL ( handler.book().sells().total_volume, ( uint32_t ) 190 );
+	BOOST_CHECK ( errors.empty() );
+}
+
+// the fixed point parser has to accept and reject exactly what strtod/strtoul did, and come up with the same numbers
+BOOST_AUTO_TEST_CASE ( fixedPointParser )
+{
+	const char * prices[] = { "44.26", "44.1", "44.", ".5", "0044.260", "44.2659", "0.001", "4294967.295",
+							  "4294967.296", "0", "0.0", "-44.26", "+44.26", " 44.26", "4.426e1", "44.26a", "AA.26", "", ".", "44..2",
+							  "0.0004", "5000000", "1e16", "9007199254740993", "0.10000000000000000000001",
+							  "0000000000000000000000000000000000000000000000000000000000000000044.26"
+							};
+	for ( const char * price : prices )
+	{
+		uint32_t fast ( 0 ), legacy ( 0 );
+		bool fast_ok ( DecimalParser::parsePrice ( price, strlen ( price ), fast ) );
+		bool legacy_ok ( DecimalParser::parsePriceLegacy ( price, strlen ( price ), legacy ) );
+		BOOST_CHECK_MESSAGE ( fast_ok == legacy_ok, price );
+		if ( fast_ok && legacy_ok )
+			BOOST_CHECK_EQUAL ( fast, legacy );
+	}
+	std::mt19937 random ( 42 );
+	size_t different ( 0 );
+	for ( int i = 0; i < 200000; i++ )
+	{
+		char price[32];
+		int len ( snprintf ( price, sizeof ( price ), "%u.%0*u", unsigned ( random() % 100000 ), int ( i % 4 + 1 ), unsigned ( random() % 10000 ) ) );
+		uint32_t fast ( 0 ), legacy ( 0 );
+		if ( DecimalParser::parsePrice ( price, len, fast ) != DecimalParser::parsePriceLegacy ( price, len, legacy ) || fast != legacy )
+			different++;
+	}
+	BOOST_CHECK_EQUAL ( different, ( size_t ) 0 );
+	uint32_t ticks;
+	BOOST_CHECK ( DecimalParser::parsePrice ( "44.26", 5, ticks ) );
+	BOOST_CHECK_EQUAL ( ticks, ( uint32_t ) 44260 );
+	// strtod + floor comes out a tick short on these
+	BOOST_CHECK ( DecimalParser::parsePrice ( "2.01", 4, ticks ) );
+	BOOST_CHECK_EQUAL ( ticks, ( uint32_t ) 2009 );
+	BOOST_CHECK ( DecimalParser::parsePrice ( "8.12", 4, ticks ) );
+	BOOST_CHECK_EQUAL ( ticks, ( uint32_t ) 8119 );
+	// under a tick, or past uint32_t, still gets through
+	BOOST_CHECK ( DecimalParser::parsePrice ( "0.0004", 6, ticks ) );
+	BOOST_CHECK_EQUAL ( ticks, ( uint32_t ) 0 );
+	BOOST_CHECK ( DecimalParser::parsePrice ( "5000000", 7, ticks ) );
+	BOOST_CHECK_EQUAL ( ticks, ( uint32_t ) 705032704 );
+
+	const char * sizes[] = { "100", "0", "4294967295", "4294967296", "0000000100", "00000000100", "99999999999",
+							 "-100", "+100", "  100", "10a", "", "A"
+						   };
+	for ( const char * size : sizes )
+	{
+		uint32_t fast ( 0 ), legacy ( 0 );
+		bool fast_ok ( DecimalParser::parseSize ( size, strlen ( size ), fast ) );
+		bool legacy_ok ( DecimalParser::parseSizeLegacy ( size, strlen ( size ), legacy ) );
+		BOOST_CHECK_MESSAGE ( fast_ok == legacy_ok, size );
+		if ( fast_ok && legacy_ok )
+			BOOST_CHECK_EQUAL ( fast, legacy );
+	}
+}
+
+// short ids are stored inline, long ones on the side, erasing shifts the probe chains back
+BOOST_AUTO_TEST_CASE ( orderIdIndex )
+{
+	OrderIdIndex<uint32_t> index;
+	std::vector<std::string> ids;
+	for ( uint32_t i = 0; i < 5000; i++ )
+		ids.push_back ( i % 3 ? std::to_string ( i ) : "a-rather-long-order-id-" + std::to_string ( i ) );
+	ids.push_back ( "" );
+	for ( uint32_t i = 0; i < ids.size(); i++ )
+	{
+		std::pair<size_t, bool> entry ( index.insert ( ids[i] ) );
+		BOOST_REQUIRE ( entry.second );
+		index.value ( entry.first ) = i;
+	}
+	BOOST_CHECK ( !index.insert ( ids[42] ).second );
+	BOOST_CHECK ( !index.insert ( ids[43] ).second );
+	BOOST_CHECK_EQUAL ( index.size(), ids.size() );
+	BOOST_CHECK ( index.capacity() * 3 >= index.size() * 4 );
+	for ( uint32_t i = 0; i < ids.size(); i += 2 )
+		BOOST_CHECK ( index.erase ( ids[i] ) );
+	for ( uint32_t i = 0; i < ids.size(); i++ )
+	{
+		size_t pos ( index.find ( ids[i] ) );
+		if ( i % 2 )
+			BOOST_CHECK ( pos != OrderIdIndex<uint32_t>::npos && index.value ( pos ) == i );
+		else
+			BOOST_CHECK ( pos == OrderIdIndex<uint32_t>::npos );
+	}
+	BOOST_CHECK ( index.find ( "1" ) != index.find ( "1 " ) );
+	BOOST_CHECK_EQUAL ( index.size(), ids.size() / 2 );
+}
+
+/*
+* Drive a price level map the way OrderBook does and record the total value after every change
+*/
+template <class Map>
+std::vector<OrderBook::Value> replayLevels ( Map & map, uint32_t seed, size_t target = 0 )
+{
+	std::mt19937 rng ( seed );
+	OrderStore store;
+	std::vector<OrderHandle> orders;
+	std::vector<OrderBook::Value> values;
+	uint32_t mid ( 44000 );
+	for ( size_t i = 0; i < 20000; i++ )
+	{
+		mid += rng() % 3 * 10 - 10;
+		if ( orders.empty() || rng() % 2 )
+		{
+			// now and then an outlier far away from the rest of the book
+			uint32_t price ( rng() % 100 ? mid + rng() % 40 * 10 : 1 + rng() % 100000 );
+			OrderHandle order ( store.allocate ( Order ( OrderSide::BUY, 1 + rng() % 300, price ) ) );
+			map.add ( store, order );
+			orders.push_back ( order );
+		}
+		else
+		{
+			size_t index ( rng() % orders.size() );
+			if ( map.reduce ( store, orders[index], 1 + rng() % 200 ) )
+			{
+				orders[index] = orders.back();
+				orders.pop_back();
+			}
+		}
+		// ask for the other targets too, so the one we record isn't always the one that triggers the walk
+		for ( size_t other = 0; other < map.targets(); other++ )
+			if ( other != target )
+				map.get_total_value ( other );
+		values.push_back ( map.get_total_value ( target ) );
+	}
+	map.clear();
+	return values;
+}
+
+// the ladder has to give the same answers as the tree, also when levels fall outside its window
+BOOST_AUTO_TEST_CASE ( ladderMatchesTree )
+{
+	for ( uint32_t seed = 1; seed < 4; seed++ )
+	{
+		PriceLevelMap < std::greater<uint32_t> > buy_tree ( 200 );
+		LadderPriceLevelMap < std::greater<uint32_t> > buy_ladder ( 200, 128 );
+		std::vector<OrderBook::Value> expected ( replayLevels ( buy_tree, seed ) );
+		std::vector<OrderBook::Value> actual ( replayLevels ( buy_ladder, seed ) );
+		BOOST_CHECK ( expected == actual );
+		PriceLevelMap < std::less<uint32_t> > sell_tree ( 1000 );
+		LadderPriceLevelMap < std::less<uint32_t> > sell_ladder ( 1000, 128 );
+		expected = replayLevels ( sell_tree, seed );
+		actual = replayLevels ( sell_ladder, seed );
+		BOOST_CHECK ( expected == actual );
+	}
+}
+
+// a level is a chain through the order store, oldest first, and released handles get reused
+BOOST_AUTO_TEST_CASE ( orderListFifo )
+{
+	OrderStore store;
+	OrderList list;
+	OrderHandle a ( store.allocate ( Order ( OrderSide::SELL, 100, 44260 ) ) );
+	OrderHandle b ( store.allocate ( Order ( OrderSide::SELL, 200, 44260 ) ) );
+	OrderHandle c ( store.allocate ( Order ( OrderSide::SELL, 300, 44260 ) ) );
+	list.add ( store, a );
+	list.add ( store, b );
+	list.add ( store, c );
+	list.remove ( store, b );
+	store.release ( b );
+	BOOST_CHECK_EQUAL ( list.size(), ( size_t ) 2 );
+	BOOST_CHECK_EQUAL ( list.front(), a );
+	BOOST_CHECK_EQUAL ( store.next ( a ), c );
+	BOOST_CHECK_EQUAL ( store.prev ( c ), a );
+	BOOST_CHECK_EQUAL ( store.next ( c ), OrderStore::f_none );
+	OrderHandle d ( store.allocate ( Order ( OrderSide::BUY, 50, 44100 ) ) );
+	BOOST_CHECK_EQUAL ( d, b );
+	BOOST_CHECK_EQUAL ( store.volume ( d ), ( uint32_t ) 50 );
+	BOOST_CHECK_EQUAL ( store.side ( d ), OrderSide::BUY );
+	list.remove ( store, a );
+	list.remove ( store, c );
+	BOOST_CHECK ( list.empty() );
+	BOOST_CHECK_EQUAL ( list.front(), OrderStore::f_none );
+	BOOST_CHECK_EQUAL ( store.size(), ( size_t ) 3 );
+}
+
+// freed slots get handed out again before we carve new ones, and a chunk is only added when the last one is used up
+BOOST_AUTO_TEST_CASE ( slabAllocator )
+{
+	SlabAllocator<uint64_t> slab ( 0, 64 * sizeof ( uint64_t ) );
+	BOOST_CHECK_EQUAL ( slab.statistics().chunks, ( size_t ) 0 );
+	std::vector<uint64_t *> objects;
+	for ( size_t i = 0; i < 100; i++ )
+	{
+		objects.push_back ( slab.allocate() );
+		*objects.back() = i;
+	}
+	BOOST_CHECK_EQUAL ( slab.statistics().chunks, ( size_t ) 2 );
+	BOOST_CHECK_EQUAL ( slab.statistics().capacity, ( size_t ) 128 );
+	BOOST_CHECK_EQUAL ( slab.statistics().live, ( size_t ) 100 );
+	for ( size_t i = 0; i < 100; i++ )
+		BOOST_CHECK_EQUAL ( *objects[i], ( uint64_t ) i );
+	uint64_t * freed ( objects[10] );
+	slab.deallocate ( freed );
+	BOOST_CHECK_EQUAL ( slab.allocate(), freed );
+	for ( uint64_t * object : objects )
+		slab.deallocate ( object );
+	BOOST_CHECK_EQUAL ( slab.statistics().live, ( size_t ) 0 );
+	BOOST_CHECK_EQUAL ( slab.statistics().high_water_mark, ( size_t ) 100 );
+	slab.reserve ( 1000 );
+	BOOST_CHECK ( slab.statistics().capacity >= 1000 );
+	BOOST_CHECK_EQUAL ( slab.statistics().chunks, ( size_t ) 16 );
+	// single objects through the standard interface come from the slab for their type, arrays don't
+	SlabNodeAllocator<uint32_t> nodes;
+	size_t before ( SlabAllocator<uint32_t>::instance().statistics().live );
+	uint32_t * node ( nodes.allocate ( 1 ) );
+	uint32_t * array ( nodes.allocate ( 8 ) );
+	BOOST_CHECK_EQUAL ( SlabAllocator<uint32_t>::instance().statistics().live, before + 1 );
+	nodes.deallocate ( array, 8 );
+	nodes.deallocate ( node, 1 );
+	BOOST_CHECK_EQUAL ( SlabAllocator<uint32_t>::instance().statistics().live, before );
+	std::map < uint32_t, uint32_t, std::less<uint32_t>, SlabNodeAllocator < std::pair < const uint32_t, uint32_t > > > levels;
+	for ( uint32_t i = 0; i < 500; i++ )
+		levels[i] = i * 2;
+	BOOST_CHECK_EQUAL ( levels.size(), ( size_t ) 500 );
+	BOOST_CHECK_EQUAL ( levels[250], ( uint32_t ) 500 );
+}
+
+// one walk fills in every target, and each has to come out the same as a map that only prices that one
+BOOST_AUTO_TEST_CASE ( multipleTargets )
+{
+	std::vector<uint32_t> targets = { 200, 1, 10000, 0, 200 };
+	std::vector<OrderBook::Value> expected[5];
+	for ( size_t target = 0; target < targets.size(); target++ )
+	{
+		PriceLevelMap < std::greater<uint32_t> > single ( targets[target] );
+		expected[target] = replayLevels ( single, 3 );
+	}
+	for ( size_t target = 0; target < targets.size(); target++ )
+	{
+		PriceLevelMap < std::greater<uint32_t> > tree ( targets );
+		BOOST_CHECK ( replayLevels ( tree, 3, target ) == expected[target] );
+		LadderPriceLevelMap < std::greater<uint32_t> > ladder ( targets, 128 );
+		BOOST_CHECK ( replayLevels ( ladder, 3, target ) == expected[target] );
+	}
+}
+
+/* What it costs to take out target, straight from the levels */
+template <class Map>
+typename Map::Value walkCost ( Map const & map, uint32_t target )
+{
+	if ( map.total_volume < target )
+		return std::numeric_limits<typename Map::Value>::max();
+	typename Map::Value value ( 0 );
+	for ( auto iter = map.begin(); target != 0 && iter != map.end(); ++iter )
+	{
+		uint32_t volume ( std::min ( target, iter->second.total_volume ) );
+		value += static_cast < typename Map::Value > ( iter->first ) * volume;
+		target -= volume;
+	}
+	return value;
+}
+
+// the costs get moved along with every change, they have to stay what a fresh walk of the book says
+BOOST_AUTO_TEST_CASE ( incrementalCosts )
+{
+	std::vector<uint32_t> targets = { 1, 200, 1000, 10000 };
+	std::mt19937 rng ( 11 );
+	OrderStore store;
+	PriceLevelMap < std::less<uint32_t> > tree ( targets );
+	LadderPriceLevelMap < std::less<uint32_t> > ladder ( targets, 64 );
+	std::vector<OrderHandle> tree_orders;
+	std::vector<OrderHandle> ladder_orders;
+	uint32_t mid ( 44000 );
+	size_t mismatches ( 0 );
+	for ( size_t i = 0; i < 20000; i++ )
+	{
+		mid += rng() % 3 * 10 - 10;
+		if ( tree_orders.empty() || rng() % 2 )
+		{
+			uint32_t price ( rng() % 50 ? mid + rng() % 30 * 10 : 1 + rng() % 100000 );
+			uint32_t volume ( 1 + rng() % 300 );
+			tree_orders.push_back ( store.allocate ( Order ( OrderSide::SELL, volume, price ) ) );
+			tree.add ( store, tree_orders.back() );
+			ladder_orders.push_back ( store.allocate ( Order ( OrderSide::SELL, volume, price ) ) );
+			ladder.add ( store, ladder_orders.back() );
+		}
+		else
+		{
+			size_t index ( rng() % tree_orders.size() );
+			uint32_t volume ( rng() % 200 );
+			tree.reduce ( store, tree_orders[index], volume );
+			if ( ladder.reduce ( store, ladder_orders[index], volume ) )
+			{
+				tree_orders[index] = tree_orders.back();
+				tree_orders.pop_back();
+				ladder_orders[index] = ladder_orders.back();
+				ladder_orders.pop_back();
+			}
+		}
+		for ( size_t target = 0; target < targets.size(); target++ )
+		{
+			OrderBook::Value expected ( walkCost ( tree, targets[target] ) );
+			mismatches += tree.get_total_value ( target ) != expected;
+			mismatches += ladder.get_total_value ( target ) != expected;
+		}
+	}
+	BOOST_CHECK_EQUAL ( mismatches, ( size_t ) 0 );
+	tree.clear();
+	ladder.clear();
+}
+
+// the book's output goes to the stream it's handed, with the timestamp the way it came in
+BOOST_AUTO_TEST_CASE ( outputToStream )
+{
+	FeedHandler handler ( 200 );
+	std::ostringstream os;
+	handler.processMessage ( "28800538 A b S 44.26 100", os );
+	handler.processMessage ( "28800562 A c S 44.10 100", os );
+	handler.processMessage ( "28800744 R b 100", os );
+	handler.processMessage ( "28800758 A d B 44.185 200", os );
+	// a book in cents never sees the half cent
+	BOOST_CHECK_EQUAL ( os.str(), BookFixedPoint::decimals == 3 ? "28800562 B 8836.00\n28800744 B NA\n28800758 S 8837.00\n" :
+						"28800562 B 8836.00\n28800744 B NA\n28800758 S 8836.00\n" );
+	// a timestamp has to be a number
+	handler.processMessage ( "2880O758 A e B 44.18 200", os );
+	BOOST_CHECK_EQUAL ( handler.errors().corrupted_messages, ( uint32_t ) 1 );
+	FeedHandler tagged ( std::vector<uint32_t> { 100, 200 } );
+	std::ostringstream tagged_os;
+	tagged.processMessage ( "28800538 A b S 44.26 100", tagged_os );
+	tagged.processMessage ( "28800562 A c S 44.10 100", tagged_os );
+	BOOST_CHECK_EQUAL ( tagged_os.str(), "100 28800538 B 4426.00\n100 28800562 B 4410.00\n200 28800562 B 8836.00\n" );
+}
+
+// costs come out exactly like printf ( "%0.2f" ) made them, and the sink only sees them when the policy says so
+BOOST_AUTO_TEST_CASE ( outputWriter )
+{
+	MemorySink sink;
+	std::string expected;
+	{
+		OutputWriter out ( sink, FlushPolicy::ON_EXIT, 128 );
+		std::mt19937 rng ( 5 );
+		for ( uint32_t i = 0; i < 100000; i++ )
+		{
+			uint32_t value ( i < 50000 ? i : static_cast < uint32_t > ( rng() ) );
+			if ( value == std::numeric_limits<uint32_t>::max() )
+				continue;
+			char line[64];
+			snprintf ( line, sizeof ( line ), "%u B %0.2f\n", i, value / 1000.0 );
+			expected += line;
+			out.writeCost ( i, 'B', value );
+		}
+		out.writeCost ( 1, 'S', OutputWriter::f_no_cost );
+		expected += "1 S NA\n";
+	}
+	BOOST_CHECK ( sink.str() == expected );
+
+	sink.clear();
+	OutputWriter per_message ( sink, FlushPolicy::PER_MESSAGE );
+	per_message.writeCost ( 28800538, 'S', 44260 );
+	BOOST_CHECK ( sink.str().empty() );
+	per_message.endMessage();
+	BOOST_CHECK_EQUAL ( sink.str(), "28800538 S 44.26\n" );
+
+	sink.clear();
+	OutputWriter per_batch ( sink, FlushPolicy::PER_BATCH );
+	per_batch.writeCost ( 200, 28800538, 'B', 8836000 );
+	per_batch.endMessage();
+	BOOST_CHECK ( sink.str().empty() );
+	per_batch.endBatch();
+	BOOST_CHECK_EQUAL ( sink.str(), "200 28800538 B 8836.00\n" );
+
+	sink.clear();
+	OutputWriter on_exit ( sink, FlushPolicy::ON_EXIT );
+	on_exit.writeCost ( 28800538, 'B', 1 );
+	on_exit.endBatch();
+	BOOST_CHECK ( sink.str().empty() );
+	on_exit.flush();
+	BOOST_CHECK_EQUAL ( sink.str(), "28800538 B 0.00\n" );
+}
+
+// timestamps go back out with the digits they came in with, one that isn't a plain number makes the message corrupted
+BOOST_AUTO_TEST_CASE ( timestamps )
+{
+	FeedHandler handler ( 100 );
+	ErrorSummary const & errors ( handler.errors() );
+	std::ostringstream os;
+	handler.processMessage ( "0028800538 A b S 44.26 100", os );
+	handler.processMessage ( "0028800600 R b 100", os );
+	handler.processMessage ( "0000000000000000001 A c S 44.26 100", os );
+	handler.processMessage ( "00000000000000000001 A d S 44.26 100", os );
+	handler.processMessage ( "2880053a A e S 44.26 100", os );
+	handler.processMessage ( "-28800538 A f S 44.26 100", os );
+	handler.processMessage ( "28800538.0 R c 50", os );
+	BOOST_CHECK_EQUAL ( os.str(), "0028800538 B 4426.00\n0028800600 B NA\n0000000000000000001 B 4426.00\n" );
+	BOOST_CHECK_EQUAL ( errors.corrupted_messages, ( size_t ) 4 );
+	BOOST_CHECK_EQUAL ( handler.book().sells().total_volume, ( uint32_t ) 100 );
+
+	MemorySink sink;
+	{
+		OutputWriter out ( sink );
+		out.writeCost ( Timestamp ( 538, 10 ), 'S', 44260 );
+		out.writeCost ( 200, Timestamp ( 28800538, 2 ), 'B', 44260 );
+	}
+	BOOST_CHECK_EQUAL ( sink.str(), "0000000538 S 44.26\n200 28800538 B 44.26\n" );
+}
+
+// everything the producer pushes comes out on the other thread, in order, also when the queue keeps filling up
+BOOST_AUTO_TEST_CASE ( spscQueue )
+{
+	SpscQueue<uint64_t> queue ( 64 );
+	const uint64_t count ( 100000 );
+	uint64_t out_of_order ( 0 );
+	std::thread consumer ( [&]()
+	{
+		uint64_t expected ( 0 );
+		uint64_t value;
+		while ( expected < count )
+		{
+			if ( queue.pop ( value ) )
+				out_of_order += value != expected++;
+			else
+				std::this_thread::yield();
+		}
+	} );
+	for ( uint64_t i = 0; i < count; i++ )
+		while ( !queue.push ( i ) )
+			std::this_thread::yield();
+	consumer.join();
+	BOOST_CHECK_EQUAL ( out_of_order, ( uint64_t ) 0 );
+	BOOST_CHECK ( queue.empty() );
+}
+
+// every symbol gets its own book, and its output is what a handler of its own would have printed
+BOOST_AUTO_TEST_CASE ( bookManager )
+{
+	std::vector<std::string> feeds[2];
+	std::mt19937 rng ( 17 );
+	for ( size_t symbol = 0; symbol < 2; symbol++ )
+		for ( size_t i = 0; i < 2000; i++ )
+		{
+			std::ostringstream line;
+			line << 28800000 + i << " ";
+			if ( i % 3 == 2 )
+				line << "R " << rng() % i << " " << 1 + rng() % 100;
+			else
+				line << "A " << i << " " << ( rng() % 2 ? 'B' : 'S' ) << " 44." << 10 + rng() % 30 << " " << 1 + rng() % 300;
+			feeds[symbol].push_back ( line.str() );
+		}
+	std::string expected[2];
+	for ( size_t symbol = 0; symbol < 2; symbol++ )
+	{
+		FeedHandler handler ( 200 );
+		std::ostringstream os;
+		for ( std::string const & line : feeds[symbol] )
+			handler.processMessage ( line, os );
+		expected[symbol] = os.str();
+	}
+	std::string input;
+	for ( size_t i = 0; i < 2000; i++ )
+		input += "IBM " + feeds[0][i] + "\nMSFT " + feeds[1][i] + "\n";
+	input += "no-symbol-here\n";
+	MemorySink sink;
+	{
+		BookManager manager ( std::vector<uint32_t> ( 1, 200 ), 2, sink );
+		BOOST_CHECK_EQUAL ( manager.routeLines ( input ), input.size() );
+		manager.finish();
+		BOOST_CHECK_EQUAL ( manager.symbols(), ( size_t ) 2 );
+		BOOST_CHECK ( manager.handler ( "IBM" ) != 0 );
+		BOOST_CHECK ( manager.handler ( "GOOG" ) == 0 );
+		BOOST_CHECK_EQUAL ( manager.errors().corrupted_messages, ( uint32_t ) 1 );
+	}
+	std::string actual[2];
+	std::istringstream lines ( sink.str() );
+	std::string line;
+	while ( std::getline ( lines, line ) )
+	{
+		if ( line.compare ( 0, 4, "IBM " ) == 0 )
+			actual[0] += line.substr ( 4 ) + "\n";
+		else if ( line.compare ( 0, 5, "MSFT " ) == 0 )
+			actual[1] += line.substr ( 5 ) + "\n";
+		else
+			BOOST_ERROR ( "line without a symbol: " + line );
+	}
+	BOOST_CHECK ( !expected[0].empty() );
+	BOOST_CHECK ( actual[0] == expected[0] );
+	BOOST_CHECK ( actual[1] == expected[1] );
+}
+
+// threads only go to CPUs we're allowed on, round the set again when there's more threads than CPUs
+BOOST_AUTO_TEST_CASE ( cpuSet )
+{
+	cpu_set_t allowed;
+	BOOST_REQUIRE_EQUAL ( sched_getaffinity ( 0, sizeof ( allowed ), &allowed ), 0 );
+	CpuSet cpus;
+	BOOST_REQUIRE_EQUAL ( cpus.size(), ( size_t ) CPU_COUNT ( &allowed ) );
+	std::atomic<bool> done ( false );
+	std::thread thread ( [&]()
+	{
+		while ( !done )
+			std::this_thread::yield();
+	} );
+	for ( size_t n = 0; n < 2 * cpus.size() + 1; n++ )
+	{
+		BOOST_CHECK ( CPU_ISSET ( cpus.cpu ( n ), &allowed ) );
+		BOOST_CHECK_EQUAL ( cpus.cpu ( n ), cpus.cpu ( n + cpus.size() ) );
+		BOOST_CHECK ( cpus.pin ( thread, n ) );
+		cpu_set_t pinned;
+		BOOST_REQUIRE_EQUAL ( pthread_getaffinity_np ( thread.native_handle(), sizeof ( pinned ), &pinned ), 0 );
+		BOOST_CHECK ( CPU_COUNT ( &pinned ) == 1 && CPU_ISSET ( cpus.cpu ( n ), &pinned ) );
+	}
+	done = true;
+	thread.join();
+
+	// like taskset -c with just our last CPU: everything has to go there
+	int last ( cpus.cpu ( cpus.size() - 1 ) );
+	cpu_set_t one;
+	CPU_ZERO ( &one );
+	CPU_SET ( last, &one );
+	BOOST_REQUIRE_EQUAL ( sched_setaffinity ( 0, sizeof ( one ), &one ), 0 );
+	CpuSet restricted;
+	MemorySink sink;
+	size_t workers_pinned;
+	bool parser_pinned;
+	size_t parsers_pinned;
+	{
+		BookManager manager ( std::vector<uint32_t> ( 1, 200 ), 3, sink );
+		workers_pinned = manager.pinned();
+		FeedHandler handler ( 200 );
+		OutputWriter out ( sink );
+		Pipeline pipeline ( handler, out );
+		parser_pinned = pipeline.pinned();
+		ParallelParser parallel ( handler, out, 2 );
+		parsers_pinned = parallel.pinned();
+	}
+	sched_setaffinity ( 0, sizeof ( allowed ), &allowed );
+	BOOST_CHECK_EQUAL ( restricted.size(), ( size_t ) 1 );
+	BOOST_CHECK_EQUAL ( restricted.cpu ( 5 ), last );
+	BOOST_CHECK_EQUAL ( workers_pinned, ( size_t ) 3 );
+	BOOST_CHECK ( parser_pinned );
+	BOOST_CHECK_EQUAL ( parsers_pinned, ( size_t ) 2 );
+}
+
+// a feed replayed from its binary form prints and counts exactly what the text did
+BOOST_AUTO_TEST_CASE ( binaryFeed )
+{
+	std::string feed ( "28800538 A b S 44.26 100\n"
+					   "28800562 A c S 44.10 100\n"
+					   "28800744 R b 100\n"
+					   "28800758 A d B 44.185 200\n"
+					   "28800759 X d 10\n"
+					   "28800760 R d -10\n"
+					   "28800761 R q 10\n"
+					   "28800762 A c B 44.00 10\n"
+					   "28800796 R d 157\n"
+					   "28800812 A a-rather-long-order-id-1 B 44.19 5\n"
+					   "28800813 R a-rather-long-order-id-1 5\n" );
+	FeedHandler text ( std::vector<uint32_t> { 1, 200 } );
+	MemorySink text_sink;
+	{
+		OutputWriter out ( text_sink );
+		text.processLines ( feed, out );
+	}
+	char path[] = "/tmp/rgm-binary-feed-XXXXXX";
+	int fd ( mkstemp ( path ) );
+	BOOST_REQUIRE ( fd >= 0 );
+	close ( fd );
+	{
+		BinaryFeedWriter writer ( path );
+		Message message;
+		size_t begin ( 0 );
+		for ( size_t end = feed.find ( '\n' ); end != std::string::npos; begin = end + 1, end = feed.find ( '\n', begin ) )
+		{
+			FeedHandler::parseMessage ( std::string_view ( feed ).substr ( begin, end - begin ), message );
+			writer.append ( message );
+		}
+		writer.finish();
+		BOOST_CHECK_EQUAL ( writer.records(), ( uint64_t ) 11 );
+		// the order ids of everything that parsed, once each
+		BOOST_CHECK_EQUAL ( writer.ids(), ( uint64_t ) 5 );
+	}
+	FeedHandler binary ( std::vector<uint32_t> { 1, 200 } );
+	MemorySink binary_sink;
+	{
+		BinaryFeedReader reader ( path );
+		BOOST_CHECK_EQUAL ( reader.size(), ( uint64_t ) 11 );
+		Message message;
+		reader.message ( 9, message );
+		BOOST_CHECK ( message.type == MessageType::ADD );
+		BOOST_CHECK ( message.side == OrderSide::BUY );
+		BOOST_CHECK_EQUAL ( message.order_id, "a-rather-long-order-id-1" );
+		BOOST_CHECK_EQUAL ( message.price, ( uint32_t ) 44190 );
+		BOOST_CHECK_EQUAL ( message.time.value, ( uint64_t ) 28800812 );
+		BOOST_CHECK_EQUAL ( message.time.digits, ( uint32_t ) 8 );
+		OutputWriter out ( binary_sink );
+		reader.replay ( binary, out );
+	}
+	BOOST_CHECK ( !text_sink.str().empty() );
+	BOOST_CHECK_EQUAL ( binary_sink.str(), text_sink.str() );
+	BOOST_CHECK_EQUAL ( binary.errors().corrupted_messages, text.errors().corrupted_messages );
+	BOOST_CHECK_EQUAL ( binary.errors().out_of_bounds_or_weird_numbers, text.errors().out_of_bounds_or_weird_numbers );
+	BOOST_CHECK_EQUAL ( binary.errors().order_modify_on_order_i_dont_know, text.errors().order_modify_on_order_i_dont_know );
+	BOOST_CHECK_EQUAL ( binary.errors().duplicate_order_id, text.errors().duplicate_order_id );
+	// a text feed isn't a binary one
+	{
+		FILE * file ( fopen ( path, "wb" ) );
+		fwrite ( feed.data(), 1, feed.size(), file );
+		fclose ( file );
+	}
+	BOOST_CHECK_THROW ( BinaryFeedReader reader ( path ), std::runtime_error );
+	unlink ( path );
+}
+
+namespace {
+	// every order on one side, best level first and oldest first
+	template <class Map>
+	std::vector<std::pair<uint32_t, uint32_t> > levelOrders ( Map const & map, OrderStore const & orders )
+	{
+		std::vector<std::pair<uint32_t, uint32_t> > result;
+		for ( typename Map::const_iterator level = map.begin(); level != map.end(); ++level )
+			for ( OrderHandle order = level->second.front(); order != OrderStore::f_none; order = orders.next ( order ) )
+				result.push_back ( std::make_pair ( orders.price ( order ), orders.volume ( order ) ) );
+		return result;
+	}
+}
+
+// a restored book carries on exactly like the one that never stopped
+BOOST_AUTO_TEST_CASE ( snapshotRestore )
+{
+	std::mt19937 rng ( 13 );
+	std::vector<std::string> live;
+	std::string feed;
+	char line[128];
+	for ( uint32_t i = 0; i < 20000; i++ )
+	{
+		if ( live.size() < 20 || ( live.size() < 300 && rng() % 2 ) )
+		{
+			// some ids too long to be kept inline
+			live.push_back ( ( i % 7 ? "o" : "a-rather-long-order-id-" ) + std::to_string ( i ) );
+			snprintf ( line, sizeof ( line ), "%u A %s %c 44.%02u %u\n", 28800000 + i, live.back().c_str(),
+					   rng() % 2 ? 'B' : 'S', static_cast < unsigned > ( rng() % 40 ), static_cast < unsigned > ( 1 + rng() % 300 ) );
+		}
+		else
+		{
+			size_t index ( rng() % live.size() );
+			snprintf ( line, sizeof ( line ), "%u R %s %u\n", 28800000 + i, live[index].c_str(), static_cast < unsigned > ( 1 + rng() % 300 ) );
+			if ( rng() % 2 )
+			{
+				live[index] = live.back();
+				live.pop_back();
+			}
+		}
+		feed += line;
+		if ( i % 1000 == 0 )
+			feed += "28800000 R nobody-knows-me 10\n";
+	}
+	size_t middle ( feed.find ( '\n', feed.size() / 2 ) + 1 );
+	std::vector<uint32_t> targets { 1, 200, 1000 };
+	FeedHandler uninterrupted ( targets );
+	MemorySink first_half;
+	{
+		OutputWriter out ( first_half );
+		uninterrupted.processLines ( std::string_view ( feed ).substr ( 0, middle ), out );
+	}
+	char path[] = "/tmp/rgm-snapshot-XXXXXX";
+	int fd ( mkstemp ( path ) );
+	BOOST_REQUIRE ( fd >= 0 );
+	close ( fd );
+	InputPosition position;
+	position.add ( std::string_view ( feed ).substr ( 0, middle ) );
+	Snapshot::save ( uninterrupted, position, path );
+
+	FeedHandler restored ( targets );
+	InputPosition taken ( Snapshot::restore ( restored, path ) );
+	BOOST_CHECK_EQUAL ( taken.unit, ( uint32_t ) InputPosition::TEXT_BYTES );
+	BOOST_CHECK_EQUAL ( taken.offset, ( uint64_t ) middle );
+	BOOST_CHECK_EQUAL ( taken.checksum, position.checksum );
+	BOOST_CHECK ( !restored.book().buys().empty() );
+	BOOST_CHECK ( levelOrders ( restored.book().buys(), restored.book().orders() ) == levelOrders ( uninterrupted.book().buys(), uninterrupted.book().orders() ) );
+	BOOST_CHECK ( levelOrders ( restored.book().sells(), restored.book().orders() ) == levelOrders ( uninterrupted.book().sells(), uninterrupted.book().orders() ) );
+	BOOST_CHECK_EQUAL ( restored.errors().order_modify_on_order_i_dont_know, uninterrupted.errors().order_modify_on_order_i_dont_know );
+	BOOST_CHECK ( restored.errors().order_modify_on_order_i_dont_know > 0 );
+
+	MemorySink expected;
+	MemorySink actual;
+	{
+		OutputWriter expected_out ( expected );
+		OutputWriter actual_out ( actual );
+		uninterrupted.processLines ( std::string_view ( feed ).substr ( middle ), expected_out );
+		restored.processLines ( std::string_view ( feed ).substr ( middle ), actual_out );
+	}
+	BOOST_CHECK ( !expected.str().empty() );
+	BOOST_CHECK ( actual.str() == expected.str() );
+	BOOST_CHECK_EQUAL ( restored.errors().order_modify_on_order_i_dont_know, uninterrupted.errors().order_modify_on_order_i_dont_know );
+	BOOST_CHECK_EQUAL ( restored.errors().duplicate_order_id, uninterrupted.errors().duplicate_order_id );
+
+	// only into a fresh book, for the same targets
+	BOOST_CHECK_THROW ( Snapshot::restore ( restored, path ), std::runtime_error );
+	FeedHandler other ( 200 );
+	BOOST_CHECK_THROW ( Snapshot::restore ( other, path ), std::runtime_error );
+	unlink ( path );
+
+	// it only carries on in the same input, whatever bits it comes in
+	InputPosition same;
+	same.add ( std::string_view ( feed ).substr ( 0, 1000 ) );
+	same.add ( std::string_view ( feed ).substr ( 1000, middle - 1000 ) );
+	BOOST_CHECK_NO_THROW ( same.checkResume ( taken ) );
+	std::string changed ( feed.substr ( 0, middle ) );
+	changed[10] = '9';
+	InputPosition other_input;
+	other_input.add ( changed );
+	BOOST_CHECK_THROW ( other_input.checkResume ( taken ), std::runtime_error );
+	// the same number of messages of a binary feed isn't the same place either
+	InputPosition binary ( InputPosition::BINARY_MESSAGES );
+	binary.add ( std::string_view ( feed ).substr ( 0, middle ), middle );
+	BOOST_CHECK_THROW ( binary.checkResume ( taken ), std::runtime_error );
+	BOOST_CHECK_THROW ( binary.checkUnit ( taken ), std::runtime_error );
+	BOOST_CHECK_NO_THROW ( same.checkUnit ( taken ) );
+	InputPosition short_of_it;
+	short_of_it.add ( std::string_view ( feed ).substr ( 0, middle - 1 ) );
+	BOOST_CHECK_THROW ( short_of_it.checkResume ( taken ), std::runtime_error );
+}
+
+// same seed same feed, every line one the handler takes, and the book stays around the size we asked for
+BOOST_AUTO_TEST_CASE ( feedGenerator )
+{
+	FeedGenerator::Parameters parameters;
+	parameters.seed = 3;
+	parameters.messages = 50000;
+	parameters.orders = 500;
+	parameters.levels = 50;
+	parameters.id_length = 12;
+	std::string feed;
+	FeedGenerator generator ( parameters );
+	while ( generator.next ( feed ) )
+		BOOST_REQUIRE ( generator.live() <= 2 * parameters.orders );
+	BOOST_CHECK_EQUAL ( generator.generated(), parameters.messages );
+	BOOST_CHECK ( generator.live() >= parameters.orders / 2 );
+	std::string again;
+	FeedGenerator same ( parameters );
+	while ( same.next ( again ) );
+	BOOST_CHECK ( feed == again );
+	parameters.seed = 4;
+	std::string other;
+	FeedGenerator different ( parameters );
+	while ( different.next ( other ) );
+	BOOST_CHECK ( feed != other );
+
+	size_t adds ( 0 );
+	Message message;
+	size_t begin ( 0 );
+	for ( size_t end = feed.find ( '\n' ); end != std::string::npos; begin = end + 1, end = feed.find ( '\n', begin ) )
+	{
+		FeedHandler::parseMessage ( std::string_view ( feed ).substr ( begin, end - begin ), message );
+		BOOST_REQUIRE ( message.type == MessageType::ADD || message.type == MessageType::REDUCE );
+		BOOST_REQUIRE_EQUAL ( message.order_id.size(), ( size_t ) 12 );
+		adds += message.type == MessageType::ADD;
+	}
+	BOOST_CHECK ( adds > parameters.messages / 3 && adds < parameters.messages * 2 / 3 );
+	// the book never hears about an order it doesn't know, or the same order twice
+	FeedHandler handler ( 200 );
+	MemorySink sink;
+	{
+		OutputWriter out ( sink );
+		handler.processLines ( feed, out );
+	}
+	BOOST_CHECK ( handler.errors().empty() );
+	BOOST_CHECK_EQUAL ( handler.book().orders().size(), generator.live() );
+
+	// mangled lines get counted as such
+	parameters.error_ratio = 0.1;
+	std::string broken;
+	FeedGenerator mangled ( parameters );
+	while ( mangled.next ( broken ) );
+	FeedHandler broken_handler ( 200 );
+	{
+		OutputWriter out ( sink );
+		broken_handler.processLines ( broken, out );
+	}
+	BOOST_CHECK ( broken_handler.errors().corrupted_messages > parameters.messages / 20 );
+	BOOST_CHECK_EQUAL ( broken_handler.errors().order_modify_on_order_i_dont_know, ( uint32_t ) 0 );
+}
+
+// percentiles come out within a bucket ( 1/16th ) of the real thing, all the way up
+BOOST_AUTO_TEST_CASE ( latencyHistogram )
+{
+	LatencyHistogram histogram;
+	BOOST_CHECK_EQUAL ( histogram.percentile ( 0.5 ), ( uint64_t ) 0 );
+	for ( uint64_t value = 1; value <= 100000; value++ )
+		histogram.record ( value );
+	BOOST_CHECK_EQUAL ( histogram.count(), ( uint64_t ) 100000 );
+	BOOST_CHECK_EQUAL ( histogram.min(), ( uint64_t ) 1 );
+	BOOST_CHECK_EQUAL ( histogram.max(), ( uint64_t ) 100000 );
+	BOOST_CHECK_CLOSE ( histogram.mean(), 50000.5, 0.001 );
+	for ( double share : { 0.01, 0.5, 0.9, 0.99, 0.999 } )
+	{
+		double exact ( share * 100000 );
+		BOOST_CHECK ( histogram.percentile ( share ) >= exact );
+		BOOST_CHECK ( histogram.percentile ( share ) <= exact * 17 / 16 + 1 );
+	}
+	BOOST_CHECK_EQUAL ( histogram.percentile ( 1 ), ( uint64_t ) 100000 );
+	// small values are exact
+	LatencyHistogram small;
+	for ( uint64_t value = 0; value < 16; value++ )
+		small.record ( value );
+	BOOST_CHECK_EQUAL ( small.percentile ( 0.5 ), ( uint64_t ) 7 );
+	small.record ( std::numeric_limits<uint64_t>::max() );
+	BOOST_CHECK_EQUAL ( small.percentile ( 1 ), std::numeric_limits<uint64_t>::max() );
+	histogram += small;
+	BOOST_CHECK_EQUAL ( histogram.count(), ( uint64_t ) 100017 );
+	BOOST_CHECK_EQUAL ( histogram.min(), ( uint64_t ) 0 );
+
+	LatencyStats & stats ( LatencyStats::instance() );
+	stats.clear();
+	stats.record ( LatencyStats::PARSE, 10 );
+	stats.count ( LatencyStats::MESSAGES );
+	BOOST_CHECK_EQUAL ( stats.histogram ( LatencyStats::PARSE ).count(), ( uint64_t ) 1 );
+	BOOST_CHECK_EQUAL ( stats.counter ( LatencyStats::MESSAGES ), ( uint64_t ) 1 );
+	std::ostringstream os;
+	stats.print ( os );
+	BOOST_CHECK ( os.str().find ( "parse" ) != std::string::npos );
+	stats.clear();
+}
+
+// prefetching is only a hint, however the messages are batched the book ends up saying the same
+BOOST_AUTO_TEST_CASE ( batchedMessages )
+{
+	// big enough for the book to bother prefetching
+	FeedGenerator::Parameters parameters;
+	parameters.seed = 5;
+	parameters.messages = 300000;
+	parameters.orders = 100000;
+	parameters.levels = 300;
+	parameters.error_ratio = 0.05;
+	std::string feed;
+	FeedGenerator generator ( parameters );
+	while ( generator.next ( feed ) );
+	std::vector<uint32_t> target_sizes { 1, 200, 5000 };
+	std::string expected;
+	ErrorSummary expected_errors;
+	for ( size_t batch_size : { 1, 7, 32, 1000 } )
+	{
+		FeedHandler handler ( target_sizes );
+		handler.setBatchSize ( batch_size );
+		BOOST_CHECK_EQUAL ( handler.batchSize(), batch_size );
+		MemorySink sink;
+		{
+			OutputWriter out ( sink );
+			handler.processLines ( feed, out );
+		}
+		if ( batch_size == 1 )
+		{
+			expected = sink.str();
+			expected_errors = handler.errors();
+			BOOST_CHECK ( handler.book().orders().size() > 64 * 1024 );
+			BOOST_CHECK ( !expected.empty() );
+			BOOST_CHECK ( expected_errors.corrupted_messages > 0 );
+			continue;
+		}
+		BOOST_CHECK ( sink.str() == expected );
+		BOOST_CHECK_EQUAL ( handler.errors().corrupted_messages, expected_errors.corrupted_messages );
+		BOOST_CHECK_EQUAL ( handler.errors().order_modify_on_order_i_dont_know, expected_errors.order_modify_on_order_i_dont_know );
+		BOOST_CHECK_EQUAL ( handler.errors().duplicate_order_id, expected_errors.duplicate_order_id );
+	}
+	FeedHandler handler ( 200 );
+	handler.setBatchSize ( 0 );
+	BOOST_CHECK_EQUAL ( handler.batchSize(), ( size_t ) 1 );
+}
+
+// parsing on a thread of its own prints the same and counts the same errors, however full the queue gets
+BOOST_AUTO_TEST_CASE ( pipeline )
+{
+	FeedGenerator::Parameters parameters;
+	parameters.seed = 6;
+	parameters.messages = 50000;
+	parameters.orders = 500;
+	parameters.levels = 40;
+	parameters.error_ratio = 0.05;
+	std::string feed;
+	FeedGenerator generator ( parameters );
+	while ( generator.next ( feed ) );
+	// and a last line without a newline
+	feed += "28800000 A last B 44.10 100";
+	std::vector<uint32_t> target_sizes { 1, 200 };
+	FeedHandler expected_handler ( target_sizes );
+	MemorySink expected;
+	{
+		OutputWriter out ( expected );
+		size_t consumed ( expected_handler.processLines ( feed, out ) );
+		expected_handler.processMessage ( std::string_view ( feed ).substr ( consumed ), out );
+	}
+	BOOST_CHECK ( expected_handler.errors().corrupted_messages > 0 );
+	for ( size_t queue_capacity : { 2, 64, 16 * 1024 } )
+	{
+		FeedHandler handler ( target_sizes );
+		MemorySink sink;
+		{
+			OutputWriter out ( sink, FlushPolicy::PER_BATCH );
+			Pipeline pipeline ( handler, out, queue_capacity );
+			// a few pieces, the way stdin comes in
+			std::string_view rest ( feed );
+			while ( rest.size() > 100000 )
+			{
+				size_t consumed ( pipeline.processLines ( rest.substr ( 0, 100000 ) ) );
+				rest = rest.substr ( consumed );
+			}
+			size_t consumed ( pipeline.processLines ( rest ) );
+			pipeline.processMessage ( rest.substr ( consumed ) );
+			BOOST_CHECK_EQUAL ( handler.errors().corrupted_messages, expected_handler.errors().corrupted_messages );
+			BOOST_CHECK_EQUAL ( handler.errors().order_modify_on_order_i_dont_know, expected_handler.errors().order_modify_on_order_i_dont_know );
+			BOOST_CHECK_EQUAL ( handler.book().orders().size(), expected_handler.book().orders().size() );
+		}
+		BOOST_CHECK ( sink.str() == expected.str() );
+	}
+}
+
+// chunks parsed on a pool and handed to the book in order, whatever the chunk size and however many go round the window
+BOOST_AUTO_TEST_CASE ( parallelParser )
+{
+	FeedGenerator::Parameters parameters;
+	parameters.seed = 7;
+	parameters.messages = 50000;
+	parameters.orders = 500;
+	parameters.levels = 40;
+	parameters.error_ratio = 0.05;
+	std::string feed;
+	FeedGenerator generator ( parameters );
+	while ( generator.next ( feed ) );
+	feed += "28800000 A last B 44.10 100";
+	std::vector<uint32_t> target_sizes { 1, 200 };
+	FeedHandler expected_handler ( target_sizes );
+	MemorySink expected;
+	{
+		OutputWriter out ( expected );
+		size_t consumed ( expected_handler.processLines ( feed, out ) );
+		expected_handler.processMessage ( std::string_view ( feed ).substr ( consumed ), out );
+	}
+	for ( size_t threads : { 1, 3 } )
+		for ( size_t chunk_bytes : { 1, 1000, 64 * 1024, 16 * 1024 * 1024 } )
+		{
+			FeedHandler handler ( target_sizes );
+			MemorySink sink;
+			{
+				OutputWriter out ( sink );
+				ParallelParser parser ( handler, out, threads, chunk_bytes );
+				// more than one buffer through the same pool
+				std::string_view rest ( feed );
+				size_t consumed ( parser.processLines ( rest.substr ( 0, rest.size() / 3 ) ) );
+				rest = rest.substr ( consumed );
+				consumed = parser.processLines ( rest );
+				BOOST_CHECK_EQUAL ( parser.processLines ( "no newline" ), ( size_t ) 0 );
+				parser.processMessage ( rest.substr ( consumed ) );
+			}
+			BOOST_CHECK ( sink.str() == expected.str() );
+			BOOST_CHECK_EQUAL ( handler.errors().corrupted_messages, expected_handler.errors().corrupted_messages );
+			BOOST_CHECK_EQUAL ( handler.errors().order_modify_on_order_i_dont_know, expected_handler.errors().order_modify_on_order_i_dont_know );
+			BOOST_CHECK_EQUAL ( handler.errors().duplicate_order_id, expected_handler.errors().duplicate_order_id );
+		}
+}
+
+// costs past 32 bits of the feed's ticks come out right, and a book in cents prices a feed in cents just the same
+BOOST_AUTO_TEST_CASE ( fixedPointBook )
+{
+	FeedHandler handler ( 10000 );
+	std::ostringstream os;
+	handler.processMessage ( "28800538 A b S 500.00 10000", os );
+	handler.processMessage ( "28800562 A c B 499.99 20000", os );
+	BOOST_CHECK_EQUAL ( os.str(), "28800538 B 5000000.00\n28800562 S 4999900.00\n" );
+
+	uint32_t cents ( 0 );
+	BOOST_CHECK ( NarrowFixedPoint::fromFeedPrice ( 44105, cents ) );
+	BOOST_CHECK_EQUAL ( cents, ( uint32_t ) 4410 );
+	// less than a cent is nothing at all
+	BOOST_CHECK ( !NarrowFixedPoint::fromFeedPrice ( 5, cents ) );
+	// a price under the feed's tick is 0 either way, and gets added like it always did
+	BOOST_CHECK ( NarrowFixedPoint::fromFeedPrice ( 0, cents ) );
+	BOOST_CHECK_EQUAL ( cents, ( uint32_t ) 0 );
+	BOOST_CHECK_EQUAL ( NarrowFixedPoint::toFeedValue ( 4410 ), ( uint64_t ) 44100 );
+	BOOST_CHECK_EQUAL ( WideFixedPoint::cost ( 500000, 10000 ), ( uint64_t ) 5000000000ull );
+
+	FeedGenerator::Parameters parameters;
+	parameters.seed = 9;
+	parameters.messages = 50000;
+	parameters.orders = 500;
+	parameters.levels = 40;
+	std::string feed;
+	FeedGenerator generator ( parameters );
+	while ( generator.next ( feed ) );
+	std::vector<uint32_t> target_sizes { 1, 200, 10000 };
+	FeedHandler wide ( target_sizes );
+	MemorySink expected;
+	{
+		OutputWriter out ( expected );
+		wide.processLines ( feed, out );
+	}
+	ErrorSummary errors;
+	BasicOrderBook<NarrowFixedPoint> narrow ( errors, target_sizes );
+	MemorySink sink;
+	{
+		OutputWriter out ( sink );
+		Message message;
+		size_t begin ( 0 );
+		for ( size_t end = feed.find ( '\n' ); end != std::string::npos; begin = end + 1, end = feed.find ( '\n', begin ) )
+		{
+			FeedHandler::parseMessage ( std::string_view ( feed ).substr ( begin, end - begin ), message );
+			uint32_t price;
+			if ( message.type == MessageType::ADD && NarrowFixedPoint::fromFeedPrice ( message.price, price ) )
+				narrow.add ( BasicOrder<NarrowFixedPoint> ( message.side, message.size, price ), message.order_id, message.time, out );
+			else if ( message.type == MessageType::REDUCE )
+				narrow.reduce ( message.order_id, message.size, message.time, out );
+			out.endMessage();
+		}
+	}
+	BOOST_CHECK ( !expected.str().empty() );
+	BOOST_CHECK ( sink.str() == expected.str() );
+	BOOST_CHECK ( errors.empty() );
+}
+
+// the top of the book as another thread sees it: what the book has, and never half of one publish and half of another
+BOOST_AUTO_TEST_CASE ( depthSnapshots )
+{
+	FeedHandler handler ( std::vector<uint32_t> { 1, 200 } );
+	DepthPublisher publisher ( 2, 2 );
+	BookDepth depth ( 2, 2 );
+	BOOST_CHECK ( !publisher.read ( depth ) );
+	handler.setDepthPublisher ( &publisher );
+	std::ostringstream os;
+	handler.processMessage ( "28800538 A b S 44.26 100", os );
+	handler.processMessage ( "28800562 A c S 44.10 100", os );
+	handler.processMessage ( "28800563 A d S 44.10 50", os );
+	handler.processMessage ( "28800564 A e S 45.00 10", os );
+	handler.processMessage ( "28800600 A f B 43.00 300", os );
+	handler.processMessage ( "2880O700 A g B 43.00 300", os );
+	BOOST_REQUIRE ( publisher.read ( depth ) );
+	BOOST_CHECK_EQUAL ( depth.version, ( uint64_t ) 6 );
+	BOOST_CHECK_EQUAL ( publisher.version(), ( uint64_t ) 6 );
+	BOOST_CHECK_EQUAL ( depth.time.value, ( uint64_t ) 28800600 );
+	BOOST_CHECK_EQUAL ( depth.time.digits, ( uint32_t ) 8 );
+	BOOST_REQUIRE_EQUAL ( depth.levels[OrderSide::SELL].size(), ( size_t ) 2 );
+	BOOST_CHECK_EQUAL ( depth.levels[OrderSide::SELL][0].price, ( uint64_t ) 44100 );
+	BOOST_CHECK_EQUAL ( depth.levels[OrderSide::SELL][0].volume, ( uint64_t ) 150 );
+	BOOST_CHECK_EQUAL ( depth.levels[OrderSide::SELL][0].orders, ( uint64_t ) 2 );
+	BOOST_CHECK_EQUAL ( depth.levels[OrderSide::SELL][1].price, ( uint64_t ) 44260 );
+	BOOST_REQUIRE_EQUAL ( depth.levels[OrderSide::BUY].size(), ( size_t ) 1 );
+	BOOST_CHECK_EQUAL ( depth.levels[OrderSide::BUY][0].volume, ( uint64_t ) 300 );
+	BOOST_CHECK_EQUAL ( depth.costs[OrderSide::SELL][0], ( uint64_t ) 44100 );
+	BOOST_CHECK_EQUAL ( depth.costs[OrderSide::SELL][1], ( uint64_t ) 8828000 );
+	BOOST_CHECK_EQUAL ( depth.costs[OrderSide::BUY][0], ( uint64_t ) 43000 );
+	BOOST_CHECK_EQUAL ( depth.costs[OrderSide::BUY][1], ( uint64_t ) 8600000 );
+	handler.processMessage ( "28800700 R f 200", os );
+	BOOST_REQUIRE ( publisher.read ( depth ) );
+	BOOST_CHECK_EQUAL ( depth.costs[OrderSide::BUY][1], OutputWriter::f_no_cost );
+
+	// everything in a publish comes from the same number, a reader has to see them all agree
+	DepthPublisher shared ( 8, 3 );
+	std::atomic<bool> done ( false );
+	std::thread writer ( [&]()
+	{
+		BookDepth out ( 8, 3 );
+		for ( uint64_t n = 1; n <= 200000; n++ )
+		{
+			out.time = n;
+			for ( size_t side = 0; side < 2; side++ )
+			{
+				out.levels[side].resize ( n % 9 );
+				for ( size_t i = 0; i < out.levels[side].size(); i++ )
+					out.levels[side][i] = DepthLevel { n + i, n * 2, side };
+				out.costs[side].assign ( 3, n * 3 );
+			}
+			shared.publish ( out );
+		}
+		done = true;
+	} );
+	BookDepth in ( 8, 3 );
+	size_t reads ( 0 );
+	size_t torn ( 0 );
+	uint64_t last ( 0 );
+	while ( !done || reads == 0 )
+	{
+		if ( !shared.read ( in ) )
+			continue;
+		reads++;
+		uint64_t n ( in.time.value );
+		torn += in.version != n || n < last;
+		last = n;
+		for ( size_t side = 0; side < 2; side++ )
+		{
+			torn += in.levels[side].size() != n % 9;
+			for ( size_t i = 0; i < in.levels[side].size(); i++ )
+				torn += in.levels[side][i].price != n + i || in.levels[side][i].volume != n * 2 || in.levels[side][i].orders != side;
+			for ( uint64_t cost : in.costs[side] )
+				torn += cost != n * 3;
+		}
+	}
+	writer.join();
+	BOOST_CHECK ( reads > 0 );
+	BOOST_CHECK_EQUAL ( torn, ( size_t ) 0 );
+	BOOST_REQUIRE ( shared.read ( in ) );
+	BOOST_CHECK_EQUAL ( in.time.value, ( uint64_t ) 200000 );
+}
+
+/* Random adds and reduces around a moving mid, with outliers, on maps with and without the sums ( in 64 bits, whatever the book has ) */
+template <class T>
+size_t sweepMismatches ( uint32_t seed )
+{
+	typedef PriceLevelMap < T, WideFixedPoint > Tree;
+	typedef LadderPriceLevelMap < T, WideFixedPoint > Ladder;
+	std::mt19937 rng ( seed );
+	typename Tree::OrderStore store;
+	Tree walked ( 200 );
+	Tree tree ( 200 );
+	Ladder ladder ( 200, 64 );
+	// windows about as wide as the book, so they slide and overflow every now and then
+	tree.enable_sweeps ( 512 );
+	std::vector<OrderHandle> orders[3];
+	uint32_t mid ( 44000 );
+	size_t mismatches ( 0 );
+	for ( size_t i = 0; i < 20000; i++ )
+	{
+		if ( i == 5000 )
+			ladder.enable_sweeps ( 128 );
+		mid += rng() % 3 * 10 - 10;
+		if ( orders[0].empty() || rng() % 2 )
+		{
+			// the outliers far out on the worse side, better ones would pin the windows there
+			uint32_t price ( rng() % 50 ? mid + rng() % 30 * 10 : T() ( 1u, 0u ) ? 1 + rng() % 30000 : 60000 + rng() % 100000 );
+			uint32_t volume ( 1 + rng() % 300 );
+			for ( size_t map = 0; map < 3; map++ )
+				orders[map].push_back ( store.allocate ( BasicOrder<WideFixedPoint> ( OrderSide::SELL, volume, price ) ) );
+			walked.add ( store, orders[0].back() );
+			tree.add ( store, orders[1].back() );
+			ladder.add ( store, orders[2].back() );
+		}
+		else
+		{
+			size_t index ( rng() % orders[0].size() );
+			uint32_t volume ( rng() % 200 );
+			walked.reduce ( store, orders[0][index], volume );
+			tree.reduce ( store, orders[1][index], volume );
+			if ( ladder.reduce ( store, orders[2][index], volume ) )
+				for ( size_t map = 0; map < 3; map++ )
+				{
+					orders[map][index] = orders[map].back();
+					orders[map].pop_back();
+				}
+		}
+		// mostly sizes the top of the book has
+		uint32_t size ( rng() % ( rng() % 4 ? 1000 : walked.total_volume + 100 ) );
+		uint64_t expected ( walkCost ( walked, size ) );
+		mismatches += walked.cost_for ( size ) != expected;
+		mismatches += tree.cost_for ( size ) != expected;
+		mismatches += ladder.cost_for ( size ) != expected;
+		uint64_t budget ( rng() % ( rng() % 4 ? 40000000 : 400000000 ) );
+		uint32_t affordable ( walked.size_for_budget ( budget ) );
+		mismatches += tree.size_for_budget ( budget ) != affordable;
+		mismatches += ladder.size_for_budget ( budget ) != affordable;
+		// as much as the budget pays for, and not a share more
+		mismatches += walked.cost_for ( affordable ) > budget;
+		mismatches += affordable < walked.total_volume && walked.cost_for ( affordable + 1 ) <= budget;
+	}
+	walked.clear();
+	tree.clear();
+	ladder.clear();
+	return mismatches;
+}
+
+// any size and any budget, from the sums just like from a walk of the levels, on either side
+BOOST_AUTO_TEST_CASE ( sweepCosts )
+{
+	BOOST_CHECK_EQUAL ( sweepMismatches < std::less<uint32_t> > ( 12 ), ( size_t ) 0 );
+	BOOST_CHECK_EQUAL ( sweepMismatches < std::greater<uint32_t> > ( 13 ), ( size_t ) 0 );
+
+	FeedHandler handler ( 200 );
+	std::ostringstream os;
+	handler.processMessage ( "28800538 A b S 44.26 100", os );
+	handler.processMessage ( "28800562 A c S 44.10 100", os );
+	OrderBook & book ( const_cast < OrderBook & > ( handler.book() ) );
+	book.enableSweeps();
+	BOOST_CHECK_EQUAL ( BookFixedPoint::toFeedValue ( book.sells().cost_for ( 150 ) ), ( uint64_t ) 6623000 );
+	BOOST_CHECK_EQUAL ( book.sells().size_for_budget ( 6623000 / BookFixedPoint::feed_ticks ), ( OrderBook::Volume ) 150 );
+	BOOST_CHECK_EQUAL ( book.sells().cost_for ( 201 ), BookFixedPoint::unknown );
+	BOOST_CHECK_EQUAL ( book.buys().size_for_budget ( 1000000 ), ( OrderBook::Volume ) 0 );
+}
+
+// what the book holds per structure, the most it ever had, and the samples on the way
+BOOST_AUTO_TEST_CASE ( memoryStats )
+{
+	FeedHandler handler ( 200 );
+	std::ostringstream os;
+	std::ostringstream samples;
+	handler.setMemorySampling ( 2, &samples );
+	handler.processMessage ( "28800538 A b S 44.26 100", os );
+	handler.processMessage ( "28800562 A c S 44.10 100", os );
+	handler.processMessage ( "28800563 A an-order-id-too-long-to-fit B 43.00 300", os );
+	MemoryStats stats ( handler.memoryStats() );
+	BOOST_CHECK_EQUAL ( stats.orders, ( size_t ) 3 );
+	BOOST_CHECK_EQUAL ( stats.levels, ( size_t ) 3 );
+	BOOST_CHECK_EQUAL ( stats.order_store.live, 3 * OrderStore::f_order_bytes );
+	BOOST_CHECK ( stats.order_store.bytes >= stats.order_store.live );
+	BOOST_CHECK ( stats.order_ids.bytes >= stats.order_ids.live );
+	BOOST_CHECK ( stats.order_ids.live > 0 );
+	BOOST_CHECK ( stats.buffers.bytes >= FeedHandler::f_default_batch_size * sizeof ( Message ) );
+	BOOST_CHECK ( stats.total().bytes >= stats.total().live );
+	BOOST_CHECK ( stats.bytesPerOrder() > OrderStore::f_order_bytes );
+	BOOST_CHECK ( stats.bytesPerLevel() > 0 );
+	handler.processMessage ( "28800564 R b 100", os );
+	handler.processMessage ( "28800565 R c 100", os );
+	handler.processMessage ( "28800566 R an-order-id-too-long-to-fit 300", os );
+	stats = handler.memoryStats();
+	BOOST_CHECK_EQUAL ( stats.orders, ( size_t ) 0 );
+	BOOST_CHECK_EQUAL ( stats.levels, ( size_t ) 0 );
+	BOOST_CHECK_EQUAL ( stats.most_orders, ( size_t ) 3 );
+	BOOST_CHECK_EQUAL ( stats.most_levels, ( size_t ) 3 );
+	BOOST_CHECK_EQUAL ( stats.order_store.live, ( size_t ) 0 );
+	BOOST_CHECK_EQUAL ( stats.order_ids.live, ( size_t ) 0 );
+	BOOST_CHECK_EQUAL ( stats.bytesPerOrder(), 0 );
+	// one every two messages
+	std::istringstream lines ( samples.str() );
+	std::string line;
+	std::vector<std::string> sampled;
+	while ( std::getline ( lines, line ) )
+		sampled.push_back ( line );
+	BOOST_REQUIRE_EQUAL ( sampled.size(), ( size_t ) 3 );
+	BOOST_CHECK_EQUAL ( sampled[0].find ( "[ MEMORY] After 2 messages: 2 orders, 2 levels, " ), ( size_t ) 0 );
+	BOOST_CHECK_EQUAL ( sampled[2].find ( "[ MEMORY] After 6 messages: 0 orders, 0 levels, " ), ( size_t ) 0 );
+	std::ostringstream summary;
+	handler.printMemorySummary ( summary );
+	BOOST_CHECK_EQUAL ( summary.str().find ( "Memory:\n[ MEMORY] Orders: 0 ( most 3 )" ), ( size_t ) 0 );
+
+	// every slab on the thread counts, for as long as it's around
+	MemoryUsage before ( MemoryUsage::slabs() );
+	{
+		SlabAllocator<uint64_t> slab ( 1000 );
+		uint64_t * object ( slab.allocate() );
+		MemoryUsage with ( MemoryUsage::slabs() );
+		BOOST_CHECK_EQUAL ( with.bytes, before.bytes + slab.statistics().bytes );
+		BOOST_CHECK_EQUAL ( with.live, before.live + sizeof ( uint64_t ) );
+		slab.deallocate ( object );
+	}
+	BOOST_CHECK_EQUAL ( MemoryUsage::slabs().bytes, before.bytes );
+}
+
+struct ReplayedLines
+{
+	FeedHandler & feed;
+	OutputWriter & out;
+
+	size_t processLines ( std::string_view buffer )
+	{
+		return feed.processLines ( buffer, out );
+	}
+
+	void processMessage ( std::string_view line )
+	{
+		feed.processMessage ( line, out );
+	}
+};
+
+// a gzipped feed comes out the same as the text, lines across buffers, streams one after the other and all
+BOOST_AUTO_TEST_CASE ( gzipReader )
+{
+	FeedGenerator::Parameters parameters;
+	parameters.seed = 8;
+	parameters.messages = 20000;
+	parameters.orders = 300;
+	parameters.levels = 30;
+	parameters.error_ratio = 0.05;
+	std::string feed;
+	FeedGenerator generator ( parameters );
+	while ( generator.next ( feed ) );
+	// longer than a whole buffer, and a last line without a newline
+	feed += "28800000 A " + std::string ( 2000, 'x' ) + " B 44.10 100\n";
+	feed += "28800000 A last B 44.10 100";
+	std::vector<uint32_t> target_sizes { 1, 200 };
+	FeedHandler expected_handler ( target_sizes );
+	MemorySink expected;
+	{
+		OutputWriter out ( expected );
+		size_t consumed ( expected_handler.processLines ( feed, out ) );
+		expected_handler.processMessage ( std::string_view ( feed ).substr ( consumed ), out );
+	}
+	char path[] = "/tmp/rgm-gzip-feed-XXXXXX";
+	int fd ( mkstemp ( path ) );
+	BOOST_REQUIRE ( fd >= 0 );
+	close ( fd );
+	BOOST_CHECK ( !GzipReader::isGzip ( path ) );
+	// in two streams, the first one ends halfway through a line
+	size_t half ( feed.size() / 2 );
+	gzFile gz ( gzopen ( path, "wb" ) );
+	gzwrite ( gz, feed.data(), half );
+	gzclose ( gz );
+	gz = gzopen ( path, "ab" );
+	gzwrite ( gz, feed.data() + half, feed.size() - half );
+	gzclose ( gz );
+	BOOST_CHECK ( GzipReader::isGzip ( path ) );
+	for ( size_t buffer_bytes : { 777, 64 * 1024 } )
+	{
+		FeedHandler handler ( target_sizes );
+		MemorySink sink;
+		{
+			OutputWriter out ( sink );
+			ReplayedLines lines = { handler, out };
+			GzipReader reader ( path, 2, buffer_bytes );
+			BOOST_CHECK_EQUAL ( reader.replay ( lines, 0 ), ( uint64_t ) feed.size() );
+		}
+		BOOST_CHECK_EQUAL ( handler.errors().corrupted_messages, expected_handler.errors().corrupted_messages );
+		BOOST_CHECK ( sink.str() == expected.str() );
+	}
+	// from an offset we only see what comes after it
+	{
+		FeedHandler handler ( target_sizes );
+		MemorySink sink;
+		OutputWriter out ( sink );
+		ReplayedLines lines = { handler, out };
+		GzipReader reader ( path, 4, 1000 );
+		BOOST_CHECK_EQUAL ( reader.replay ( lines, feed.size() - 27 ), ( uint64_t ) feed.size() );
+		BOOST_CHECK_EQUAL ( handler.book().orders().size(), ( size_t ) 1 );
+		GzipReader past ( path );
+		BOOST_CHECK_THROW ( past.replay ( lines, feed.size() + 1 ), std::runtime_error );
+	}
+	// cut short, everything up to there still comes out
+	FILE * file ( fopen ( path, "r+" ) );
+	BOOST_REQUIRE ( file );
+	fseek ( file, 0, SEEK_END );
+	BOOST_REQUIRE ( ftruncate ( fileno ( file ), ftell ( file ) - 100 ) == 0 );
+	fclose ( file );
+	{
+		GzipReader reader ( path, 2, 4096 );
+		std::string_view data;
+		size_t read ( 0 );
+		BOOST_CHECK_THROW ( for ( ; reader.next ( data ); reader.release() ) read += data.size(), std::runtime_error );
+		BOOST_CHECK ( read > half );
+	}
+
+	// zeros after the last stream are padding, anything else after it says where it starts
+	gz = gzopen ( path, "wb" );
+	gzwrite ( gz, feed.data(), feed.size() );
+	gzclose ( gz );
+	file = fopen ( path, "a" );
+	BOOST_REQUIRE ( file );
+	fseek ( file, 0, SEEK_END );
+	long compressed ( ftell ( file ) );
+	std::string zeros ( 10000, '\0' );
+	fwrite ( zeros.data(), 1, zeros.size(), file );
+	fclose ( file );
+	{
+		FeedHandler handler ( target_sizes );
+		MemorySink sink;
+		{
+			OutputWriter out ( sink );
+			ReplayedLines lines = { handler, out };
+			GzipReader reader ( path, 2, 4096 );
+			BOOST_CHECK_EQUAL ( reader.replay ( lines, 0 ), ( uint64_t ) feed.size() );
+		}
+		BOOST_CHECK ( sink.str() == expected.str() );
+	}
+	file = fopen ( path, "a" );
+	BOOST_REQUIRE ( file );
+	fputs ( "junk", file );
+	fclose ( file );
+	{
+		GzipReader reader ( path, 2, 4096 );
+		std::string_view data;
+		size_t read ( 0 );
+		std::string error;
+		try
+		{
+			for ( ; reader.next ( data ); reader.release() )
+				read += data.size();
+		}
+		catch ( std::runtime_error & ex )
+		{
+			error = ex.what();
+		}
+		BOOST_CHECK_EQUAL ( read, feed.size() );
+		BOOST_CHECK_EQUAL ( error, "Trailing garbage in gzip input at byte " + std::to_string ( compressed ) );
+	}
+	unlink ( path );
+}